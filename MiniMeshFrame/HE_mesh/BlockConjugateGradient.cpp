@@ -0,0 +1,200 @@
+#include "BlockConjugateGradient.h"
+
+#include <cmath>
+#include <thread>
+
+BlockConjugateGradient::BlockConjugateGradient(void)
+	: matrix_(NULL), preconditioner_(SSOR), tolerance_(1e-8), max_iterations_(5000)
+	, relaxation_(1.2), num_threads_(0), iterations_(0), residual_(0.0)
+{
+}
+
+BlockConjugateGradient::~BlockConjugateGradient(void)
+{
+}
+
+bool BlockConjugateGradient::Compute(const SparseMatrix& matrix)
+{
+	matrix_ = &matrix;
+	inverse_diagonal_.resize(matrix.rows());
+	for (int i = 0; i < matrix.outerSize(); i++)
+	{
+		inverse_diagonal_[i] = 0.0;
+		for (SparseMatrix::InnerIterator it(matrix, i); it; ++it)
+		{
+			if (it.row() == i && it.value() > 0.0)
+			{
+				inverse_diagonal_[i] = 1.0 / it.value();
+			}
+		}
+		if (inverse_diagonal_[i] == 0.0)
+		{
+			return false;
+		}
+	}
+	if (preconditioner_ == INCOMPLETE_CHOLESKY)
+	{
+		cholesky_.compute(matrix);
+		return cholesky_.info() == Eigen::Success;
+	}
+	return true;
+}
+
+void BlockConjugateGradient::Multiply(const Eigen::MatrixX3d& x, Eigen::MatrixX3d& y) const
+{
+	// symmetric, so row i is read down column i
+	const int* outer = matrix_->outerIndexPtr();
+	const int* inner = matrix_->innerIndexPtr();
+	const double* values = matrix_->valuePtr();
+	auto multiply = [&](int first, int last)
+	{
+		for (int i = first; i < last; i++)
+		{
+			double sum[3] = {0.0, 0.0, 0.0};
+			for (int p = outer[i]; p < outer[i + 1]; p++)
+			{
+				int j = inner[p];
+				sum[0] += values[p] * x(j, 0);
+				sum[1] += values[p] * x(j, 1);
+				sum[2] += values[p] * x(j, 2);
+			}
+			y(i, 0) = sum[0];
+			y(i, 1) = sum[1];
+			y(i, 2) = sum[2];
+		}
+	};
+
+	// below this many rows per thread, starting the threads costs more than the product
+	const int kGrain = 1 << 14;
+	int count = static_cast<int>(matrix_->rows());
+	int num_threads = num_threads_ > 0 ? num_threads_ : static_cast<int>(std::thread::hardware_concurrency());
+	int useful = count / kGrain;
+	num_threads = num_threads < useful ? num_threads : useful;
+	num_threads = num_threads > 1 ? num_threads : 1;
+
+	int chunk = (count + num_threads - 1) / num_threads;
+	std::vector<std::thread> workers;
+	for (int t = 1; t < num_threads; t++)
+	{
+		int end = (t + 1) * chunk < count ? (t + 1) * chunk : count;
+		if (t * chunk < end)
+		{
+			workers.push_back(std::thread(multiply, t * chunk, end));
+		}
+	}
+	multiply(0, chunk < count ? chunk : count);
+	for (size_t t = 0; t != workers.size(); t++)
+	{
+		workers[t].join();
+	}
+}
+
+void BlockConjugateGradient::Precondition(const Eigen::MatrixX3d& r, Eigen::MatrixX3d& z) const
+{
+	if (preconditioner_ == JACOBI)
+	{
+		z = inverse_diagonal_.asDiagonal() * r;
+		return;
+	}
+	if (preconditioner_ == INCOMPLETE_CHOLESKY)
+	{
+		z = cholesky_.solve(r);
+		return;
+	}
+
+	// SSOR, (2 - w) / w (D / w + U)^-1 (D / w) (D / w + L)^-1 with U = L^T read down the columns
+	const int* outer = matrix_->outerIndexPtr();
+	const int* inner = matrix_->innerIndexPtr();
+	const double* values = matrix_->valuePtr();
+	int n = static_cast<int>(matrix_->rows());
+	double omega = relaxation_;
+	for (int i = 0; i < n; i++)
+	{
+		double sum[3] = {r(i, 0), r(i, 1), r(i, 2)};
+		for (int p = outer[i]; p < outer[i + 1] && inner[p] < i; p++)
+		{
+			sum[0] -= values[p] * z(inner[p], 0);
+			sum[1] -= values[p] * z(inner[p], 1);
+			sum[2] -= values[p] * z(inner[p], 2);
+		}
+		for (int c = 0; c < 3; c++)
+		{
+			z(i, c) = sum[c] * omega * inverse_diagonal_[i];
+		}
+	}
+	for (int i = n - 1; i >= 0; i--)
+	{
+		double diagonal = 1.0 / (omega * inverse_diagonal_[i]);
+		double sum[3] = {z(i, 0) * diagonal, z(i, 1) * diagonal, z(i, 2) * diagonal};
+		for (int p = outer[i + 1] - 1; p >= outer[i] && inner[p] > i; p--)
+		{
+			sum[0] -= values[p] * z(inner[p], 0);
+			sum[1] -= values[p] * z(inner[p], 1);
+			sum[2] -= values[p] * z(inner[p], 2);
+		}
+		for (int c = 0; c < 3; c++)
+		{
+			z(i, c) = sum[c] * omega * inverse_diagonal_[i];
+		}
+	}
+	z *= (2.0 - omega) / omega;
+}
+
+bool BlockConjugateGradient::Solve(const Eigen::MatrixX3d& rhs, Eigen::MatrixX3d& solution)
+{
+	iterations_ = 0;
+	residual_ = 0.0;
+	if (matrix_ == NULL || rhs.rows() != matrix_->rows() || solution.rows() != rhs.rows())
+	{
+		return false;
+	}
+
+	// one scale for the three coordinates, a flat coordinate has a zero right-hand side
+	double scale = rhs.colwise().norm().maxCoeff();
+	double target = tolerance_ * (scale > 0.0 ? scale : 1.0);
+	int n = static_cast<int>(rhs.rows());
+	Eigen::MatrixX3d r(n, 3), z(n, 3), p(n, 3), q(n, 3);
+	Multiply(solution, q);
+	r = rhs - q;
+	Precondition(r, z);
+	p = z;
+	Eigen::RowVector3d rz = (r.cwiseProduct(z)).colwise().sum();
+	bool active[3];
+	for (int c = 0; c < 3; c++)
+	{
+		active[c] = r.col(c).norm() > target;
+	}
+
+	while (iterations_ < max_iterations_ && (active[0] || active[1] || active[2]))
+	{
+		Multiply(p, q);
+		Eigen::RowVector3d pq = (p.cwiseProduct(q)).colwise().sum();
+		for (int c = 0; c < 3; c++)
+		{
+			if (active[c])
+			{
+				double alpha = pq[c] > 0.0 ? rz[c] / pq[c] : 0.0;
+				solution.col(c) += alpha * p.col(c);
+				r.col(c) -= alpha * q.col(c);
+				active[c] = alpha != 0.0 && r.col(c).norm() > target;
+			}
+		}
+		iterations_++;
+		if (!(active[0] || active[1] || active[2]))
+		{
+			break;
+		}
+		Precondition(r, z);
+		Eigen::RowVector3d next = (r.cwiseProduct(z)).colwise().sum();
+		for (int c = 0; c < 3; c++)
+		{
+			if (active[c])
+			{
+				p.col(c) = z.col(c) + (next[c] / rz[c]) * p.col(c);
+				rz[c] = next[c];
+			}
+		}
+	}
+	residual_ = r.colwise().norm().maxCoeff() / (scale > 0.0 ? scale : 1.0);
+	return residual_ <= tolerance_;
+}
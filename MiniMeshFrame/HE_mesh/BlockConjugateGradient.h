@@ -0,0 +1,76 @@
+#pragma once
+
+#include <vector>
+#include <Eigen/Sparse>
+
+/*!
+*	Preconditioned conjugate gradients for a symmetric positive definite sparse system with
+*	three right-hand sides, x, y and z of the vertices, for the systems too large to factorize.
+*	The three recurrences run side by side, so each product with the matrix reads it once
+*	for the three columns; the product is split over the rows between threads, which needs
+*	both triangles of the matrix to be stored. A column stops moving once its residual is
+*	below the tolerance times the largest norm of the right-hand sides.
+*	The preconditioner is the inverse diagonal (JACOBI), an incomplete Cholesky factor with
+*	limited fill (INCOMPLETE_CHOLESKY) or a forward and a backward Gauss-Seidel sweep
+*	over-relaxed by the relaxation (SSOR). Both triangular solves of the last two are sequential.
+*/
+class BlockConjugateGradient
+{
+public:
+	typedef Eigen::SparseMatrix<double> SparseMatrix;
+
+	enum Preconditioner
+	{
+		JACOBI,
+		INCOMPLETE_CHOLESKY,
+		SSOR
+	};
+
+	BlockConjugateGradient(void);
+	~BlockConjugateGradient(void);
+
+	//! set up the preconditioner, the matrix is kept by reference and must outlive the solves
+	/*!
+	*	\return false if the incomplete factorization failed or a diagonal entry is not positive
+	*/
+	bool Compute(const SparseMatrix& matrix);
+	//! solve the three columns of rhs, starting from the solution given
+	/*!
+	*	\return false if some column did not reach the tolerance within max_iterations
+	*/
+	bool Solve(const Eigen::MatrixX3d& rhs, Eigen::MatrixX3d& solution);
+
+	void set_preconditioner(Preconditioner preconditioner) {preconditioner_ = preconditioner;}
+	Preconditioner preconditioner(void) const {return preconditioner_;}
+	void set_tolerance(double tolerance) {tolerance_ = tolerance;}
+	void set_max_iterations(int n) {max_iterations_ = n;}
+	//! SSOR only, in (0, 2)
+	void set_relaxation(double omega) {relaxation_ = omega;}
+	//! 0 uses every hardware thread
+	void set_num_threads(int n) {num_threads_ = n;}
+
+	//! of the last Solve
+	int iterations(void) const {return iterations_;}
+	//! largest relative residual of the three columns after the last Solve
+	double residual(void) const {return residual_;}
+
+private:
+	//! y = A x, the rows split between the threads
+	void Multiply(const Eigen::MatrixX3d& x, Eigen::MatrixX3d& y) const;
+	//! z = M^-1 r
+	void Precondition(const Eigen::MatrixX3d& r, Eigen::MatrixX3d& z) const;
+
+private:
+	const SparseMatrix	*matrix_;
+	Eigen::VectorXd		inverse_diagonal_;
+	Eigen::IncompleteCholesky<double, Eigen::Lower, Eigen::NaturalOrdering<int> >	cholesky_;
+
+	Preconditioner		preconditioner_;
+	double				tolerance_;
+	int					max_iterations_;
+	double				relaxation_;
+	int					num_threads_;
+
+	int					iterations_;
+	double				residual_;
+};
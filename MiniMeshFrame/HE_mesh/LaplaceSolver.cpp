@@ -0,0 +1,306 @@
+#include "LaplaceSolver.h"
+
+#include <chrono>
+
+namespace
+{
+	double ElapsedMs(const std::chrono::steady_clock::time_point& start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+LaplaceSolver::LaplaceSolver(void)
+	: mesh_(NULL), topology_version_(0), is_factorized_(false)
+	, backend_(AUTOMATIC), direct_limit_(100000), used_backend_(DIRECT), is_converged_(false)
+	, tolerance_(1e-8), is_mixed_precision_(false), max_refinements_(10), is_single_factor_(false)
+	, is_precision_fallback_(false), weights_(LaplacianAssembler::UNIFORM), is_double_analyzed_(false)
+	, is_single_analyzed_(false)
+	, is_factor_reused_(false), factor_ms_(0.0), solve_ms_(0.0)
+{
+}
+
+LaplaceSolver::~LaplaceSolver(void)
+{
+}
+
+void LaplaceSolver::Clear(void)
+{
+	mesh_ = NULL;
+	is_factorized_ = false;
+	is_double_analyzed_ = false;
+	is_single_analyzed_ = false;
+	assembler_.Clear();
+	multigrid_.Clear();
+	laplacian_ = SparseMatrix();
+	std::vector<int>().swap(row_);
+	std::vector<int>().swap(inner_);
+	matrix_ = SparseMatrix();
+}
+
+void LaplaceSolver::set_backend(Backend backend)
+{
+	backend_ = backend;
+	is_factorized_ = is_factorized_ && used_backend_ == ChooseBackend();
+}
+
+void LaplaceSolver::set_direct_limit(int n)
+{
+	direct_limit_ = n;
+	is_factorized_ = is_factorized_ && used_backend_ == ChooseBackend();
+}
+
+void LaplaceSolver::set_preconditioner(BlockConjugateGradient::Preconditioner preconditioner)
+{
+	is_factorized_ = is_factorized_ && (used_backend_ != ITERATIVE || preconditioner == iterative_.preconditioner());
+	iterative_.set_preconditioner(preconditioner);
+}
+
+void LaplaceSolver::set_tolerance(double tolerance)
+{
+	tolerance_ = tolerance;
+	iterative_.set_tolerance(tolerance);
+	multigrid_.set_tolerance(tolerance);
+}
+
+void LaplaceSolver::set_mixed_precision(bool is_mixed)
+{
+	is_mixed_precision_ = is_mixed;
+	is_factorized_ = is_factorized_ && (used_backend_ != DIRECT || is_single_factor_ == is_mixed);
+}
+
+void LaplaceSolver::set_weights(LaplacianAssembler::Weights weights)
+{
+	is_factorized_ = is_factorized_ && weights == weights_;
+	weights_ = weights;
+}
+
+LaplaceSolver::Backend LaplaceSolver::ChooseBackend(void) const
+{
+	if (backend_ != AUTOMATIC)
+	{
+		return backend_;
+	}
+	return num_unknowns() > direct_limit_ ? MULTIGRID : DIRECT;
+}
+
+bool LaplaceSolver::Factorize(Mesh3D* mesh)
+{
+	// the uniform factors fit as long as the connectivity, the cotangent ones are refactored
+	// with the new positions on the same pattern and ordering
+	bool is_same_pattern = is_factorized_ && mesh == mesh_ && mesh->topology_version() == topology_version_;
+	is_factor_reused_ = is_same_pattern && weights_ == LaplacianAssembler::UNIFORM;
+	if (is_factor_reused_)
+	{
+		factor_ms_ = 0.0;
+		return true;
+	}
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	if (is_same_pattern)
+	{
+		assembler_.AssembleLaplacian(mesh, weights_, laplacian_);
+		ReduceLaplacian(used_backend_ == DIRECT);
+		is_factorized_ = FactorizeNumeric();
+		factor_ms_ = ElapsedMs(start);
+		return is_factorized_;
+	}
+	Clear();
+	mesh_ = mesh;
+	topology_version_ = mesh->topology_version();
+
+	// a closed mesh has nothing to solve, found before any assembly
+	assembler_.Build(mesh);
+	const VertexAdjacency& adjacency = assembler_.adjacency();
+	if (adjacency.num_boundary() == 0)
+	{
+		return false;
+	}
+
+	// isolated vertices are kept in place with the boundary
+	int num_vertex = adjacency.num_vertex();
+	row_.assign(num_vertex, -1);
+	for (int i = 0; i < num_vertex; i++)
+	{
+		if (!adjacency.is_boundary(i) && adjacency.degree(i) > 0)
+		{
+			row_[i] = static_cast<int>(inner_.size());
+			inner_.push_back(i);
+		}
+	}
+	if (inner_.empty())
+	{
+		return false;
+	}
+
+	assembler_.AssembleLaplacian(mesh, weights_, laplacian_);
+	used_backend_ = ChooseBackend();
+	is_single_factor_ = used_backend_ == DIRECT && is_mixed_precision_;
+	ReduceLaplacian(used_backend_ == DIRECT);
+	is_factorized_ = FactorizeNumeric();
+	factor_ms_ = ElapsedMs(start);
+	return is_factorized_;
+}
+
+bool LaplaceSolver::FactorizeNumeric(void)
+{
+	if (used_backend_ == ITERATIVE)
+	{
+		return iterative_.Compute(matrix_);
+	}
+	if (used_backend_ == MULTIGRID)
+	{
+		return multigrid_.Compute(matrix_);
+	}
+	if (is_single_factor_)
+	{
+		Eigen::SparseMatrix<float> single = matrix_.cast<float>();
+		if (!is_single_analyzed_)
+		{
+			ldlt_single_.analyzePattern(single);
+			is_single_analyzed_ = true;
+		}
+		ldlt_single_.factorize(single);
+		return ldlt_single_.info() == Eigen::Success || FactorizeDouble();
+	}
+	return FactorizeDouble();
+}
+
+bool LaplaceSolver::FactorizeDouble(void)
+{
+	is_single_factor_ = false;
+	if (!is_double_analyzed_)
+	{
+		ldlt_.analyzePattern(matrix_);
+		is_double_analyzed_ = true;
+	}
+	ldlt_.factorize(matrix_);
+	return ldlt_.info() == Eigen::Success;
+}
+
+bool LaplaceSolver::SolveRefined(const Eigen::MatrixX3d& rhs, Eigen::MatrixX3d& solution)
+{
+	// matrix_ holds the lower triangle for the factorization
+	double scale = rhs.colwise().norm().maxCoeff();
+	scale = scale > 0.0 ? scale : 1.0;
+	Eigen::MatrixX3f correction = ldlt_single_.solve(rhs.cast<float>());
+	solution = correction.cast<double>();
+	for (int k = 0; ; k++)
+	{
+		Eigen::MatrixX3d residual = rhs - matrix_.selfadjointView<Eigen::Lower>() * solution;
+		double norm = residual.colwise().norm().maxCoeff() / scale;
+		bool is_stalled = !(norm == norm) || (k > 0 && norm > 0.5 * refinement_history_.back());
+		refinement_history_.push_back(norm);
+		if (norm <= tolerance_ || is_stalled || k == max_refinements_)
+		{
+			return norm <= tolerance_;
+		}
+		correction = ldlt_single_.solve(residual.cast<float>());
+		solution += correction.cast<double>();
+	}
+}
+
+void LaplaceSolver::ReduceLaplacian(bool lower)
+{
+	// the rows keep the order of the ids, so the columns stay sorted; LDLT reads the lower
+	// triangle, the products of the iterations go through whole columns
+	int n = num_unknowns();
+	const int* outer = laplacian_.outerIndexPtr();
+	const int* inner = laplacian_.innerIndexPtr();
+	const double* values = laplacian_.valuePtr();
+	matrix_.resize(n, n);
+	int* reduced_outer = matrix_.outerIndexPtr();
+	reduced_outer[0] = 0;
+	for (int r = 0; r < n; r++)
+	{
+		int low = lower ? r : 0, count = 0;
+		for (int p = outer[inner_[r]]; p < outer[inner_[r] + 1]; p++)
+		{
+			count += row_[inner[p]] >= low ? 1 : 0;
+		}
+		reduced_outer[r + 1] = reduced_outer[r] + count;
+	}
+	matrix_.resizeNonZeros(reduced_outer[n]);
+	int* reduced_inner = matrix_.innerIndexPtr();
+	double* reduced_values = matrix_.valuePtr();
+	for (int r = 0; r < n; r++)
+	{
+		int low = lower ? r : 0, q = reduced_outer[r];
+		for (int p = outer[inner_[r]]; p < outer[inner_[r] + 1]; p++)
+		{
+			if (row_[inner[p]] >= low)
+			{
+				reduced_inner[q] = row_[inner[p]];
+				reduced_values[q++] = values[p];
+			}
+		}
+	}
+}
+
+bool LaplaceSolver::Solve(Mesh3D* mesh)
+{
+	solve_ms_ = 0.0;
+	if (mesh == NULL || mesh->num_of_vertex_list() == 0 || !Factorize(mesh))
+	{
+		return false;
+	}
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	// the boundary neighbors of each inner vertex, moved to the right; L is symmetric,
+	// so the entries of row i are read down column i
+	const std::vector<HE_vert*>& verts = *(mesh->get_vertex_list());
+	const int* outer = laplacian_.outerIndexPtr();
+	const int* inner = laplacian_.innerIndexPtr();
+	const double* values = laplacian_.valuePtr();
+	Eigen::MatrixX3d rhs = Eigen::MatrixX3d::Zero(num_unknowns(), 3);
+	for (size_t r = 0; r != inner_.size(); r++)
+	{
+		for (int p = outer[inner_[r]]; p < outer[inner_[r] + 1]; p++)
+		{
+			if (row_[inner[p]] < 0)
+			{
+				const Vec3f& position = verts[inner[p]]->position_;
+				rhs(r, 0) -= values[p] * position[0];
+				rhs(r, 1) -= values[p] * position[1];
+				rhs(r, 2) -= values[p] * position[2];
+			}
+		}
+	}
+
+	Eigen::MatrixX3d solution(num_unknowns(), 3);
+	if (isIterative())
+	{
+		for (size_t r = 0; r != inner_.size(); r++)
+		{
+			const Vec3f& position = verts[inner_[r]]->position_;
+			solution.row(r) << position[0], position[1], position[2];
+		}
+		is_converged_ = used_backend_ == MULTIGRID ? multigrid_.Solve(rhs, solution) : iterative_.Solve(rhs, solution);
+	}
+	else
+	{
+		// float factors that cannot refine to the tolerance give way to double ones for good
+		refinement_history_.clear();
+		is_precision_fallback_ = is_single_factor_ && !SolveRefined(rhs, solution);
+		if (is_precision_fallback_ && !FactorizeDouble())
+		{
+			return false;
+		}
+		if (!is_single_factor_)
+		{
+			solution = ldlt_.solve(rhs);
+			if (ldlt_.info() != Eigen::Success)
+			{
+				return false;
+			}
+		}
+		is_converged_ = true;
+	}
+	for (size_t r = 0; r != inner_.size(); r++)
+	{
+		verts[inner_[r]]->set_position(Vec3f(static_cast<float>(solution(r, 0)),
+			static_cast<float>(solution(r, 1)), static_cast<float>(solution(r, 2))));
+	}
+	mesh->MarkGeometryChanged();
+	solve_ms_ = ElapsedMs(start);
+	return true;
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <vector>
+#include <Eigen/Sparse>
+#include "Mesh3D.h"
+#include "BlockConjugateGradient.h"
+#include "LaplacianAssembler.h"
+#include "MultigridSolver.h"
+
+/*!
+*	Direct solve of the global minimal surface: every inner vertex at the average of its
+*	one-ring (uniform Laplacian), the boundary fixed. With cotangent weights it is one
+*	harmonic map step of the Pinkall-Polthier minimal surface, see MinimalSurfaceFlow.
+*	The Laplacian of the whole mesh comes from a LaplacianAssembler, and the boundary vertices
+*	are moved to the right-hand side, which leaves a symmetric positive definite system on the
+*	inner vertices only, the lower triangle of its block copied column by column. It is
+*	factorized by a sparse LDLT with an AMD ordering, and x, y and z are solved together as
+*	three columns.
+*	In mixed precision the factors are computed in float, half the memory and traffic, and
+*	the solution is refined against the double matrix until the tolerance: each step solves
+*	for the residual with the float factors. A step that does not halve the residual means
+*	the float factors are too poor for the system, the matrix is then factorized in double.
+*	Above direct_limit unknowns the factors would not fit in memory, and the AUTOMATIC
+*	backend switches to multigrid V-cycles instead, whose time grows linearly with the mesh;
+*	preconditioned conjugate gradients (ITERATIVE) remain available. Both start from the
+*	current positions of the inner vertices.
+*	The uniform matrix depends on the connectivity alone, so the symbolic and numeric factors,
+*	or the preconditioner, are kept for the mesh and its topology_version: solving again after
+*	moving the boundary, or any vertex, costs two triangular solves. The cotangent matrix
+*	changes with the positions, its values are assembled and factorized again on each Solve,
+*	keeping the pattern and the symbolic analysis.
+*/
+class LaplaceSolver
+{
+public:
+	enum Backend
+	{
+		AUTOMATIC,
+		DIRECT,
+		ITERATIVE,			//!< preconditioned conjugate gradients
+		MULTIGRID
+	};
+
+	LaplaceSolver(void);
+	~LaplaceSolver(void);
+
+	//! move the inner vertices of a mesh to the minimal surface of its boundary
+	/*!
+	*	\return false if the mesh has no boundary or the system is singular (an inner part
+	*	that does not reach the boundary), the mesh is unchanged
+	*/
+	bool Solve(Mesh3D* mesh);
+	//! drop the factors
+	void Clear(void);
+
+	//! the setters drop the factors if they no longer fit
+	void set_backend(Backend backend);
+	//! AUTOMATIC factorizes up to this many unknowns, and iterates above
+	void set_direct_limit(int n);
+	void set_preconditioner(BlockConjugateGradient::Preconditioner preconditioner);
+	void set_tolerance(double tolerance);
+	//! UNIFORM (the default) or COTANGENT, the mean-value weights are not symmetric
+	void set_weights(LaplacianAssembler::Weights weights);
+	//! DIRECT factorizes in float and refines in double
+	void set_mixed_precision(bool is_mixed);
+	void set_max_refinements(int n) {max_refinements_ = n;}
+	//! conjugate gradient iterations or V-cycles
+	void set_max_iterations(int n) {iterative_.set_max_iterations(n); multigrid_.set_max_cycles(n);}
+
+	int num_unknowns(void) const {return static_cast<int>(inner_.size());}
+	//! the last Solve reused the factors of the one before, the cotangent ones never are
+	bool isFactorReused(void) const {return is_factor_reused_;}
+	double factor_ms(void) const {return factor_ms_;}
+	double solve_ms(void) const {return solve_ms_;}
+	//! DIRECT, ITERATIVE or MULTIGRID, the backend of the last Solve
+	Backend used_backend(void) const {return used_backend_;}
+	//! the last Solve iterated, the following are those of the iterations or V-cycles
+	bool isIterative(void) const {return used_backend_ != DIRECT;}
+	int iterations(void) const {return used_backend_ == MULTIGRID ? multigrid_.cycles() : iterative_.iterations();}
+	double residual(void) const {return used_backend_ == MULTIGRID ? multigrid_.residual() : iterative_.residual();}
+	//! the iterations reached the tolerance
+	bool isConverged(void) const {return is_converged_;}
+	//! the last DIRECT Solve used float factors, the relative residual after each refinement
+	bool isMixedPrecision(void) const {return is_single_factor_;}
+	const std::vector<double>& refinement_history(void) const {return refinement_history_;}
+	//! refinement stalled in the last Solve and the double factors replaced the float ones
+	bool isPrecisionFallback(void) const {return is_precision_fallback_;}
+
+private:
+	typedef Eigen::SparseMatrix<double> SparseMatrix;
+
+	//! assemble and factorize the interior system unless the factors fit the mesh
+	bool Factorize(Mesh3D* mesh);
+	//! the inner rows and columns of laplacian_ into matrix_, or their lower triangle
+	void ReduceLaplacian(bool lower);
+	Backend ChooseBackend(void) const;
+	//! refine the float solution of the system, false if it stalls
+	bool SolveRefined(const Eigen::MatrixX3d& rhs, Eigen::MatrixX3d& solution);
+	//! the factors, preconditioner or hierarchy of matrix_, the symbolic analysis once per pattern
+	bool FactorizeNumeric(void);
+	bool FactorizeDouble(void);
+
+private:
+	Mesh3D				*mesh_;					//!< the factors are those of this mesh
+	unsigned int		topology_version_;
+	bool				is_factorized_;
+
+	LaplacianAssembler	assembler_;
+	SparseMatrix		laplacian_;				//!< of all the vertices
+	std::vector<int>	row_;					//!< row of each vertex, -1 on the boundary
+	std::vector<int>	inner_;					//!< vertex of each row
+	SparseMatrix		matrix_;				//!< of the inner vertices
+	Eigen::SimplicialLDLT<SparseMatrix, Eigen::Lower, Eigen::AMDOrdering<int> >	ldlt_;
+	Eigen::SimplicialLDLT<Eigen::SparseMatrix<float>, Eigen::Lower, Eigen::AMDOrdering<int> >	ldlt_single_;
+	BlockConjugateGradient	iterative_;
+	MultigridSolver		multigrid_;
+
+	Backend				backend_;
+	int					direct_limit_;
+	Backend				used_backend_;			//!< of the factors, or the preconditioner or hierarchy
+	bool				is_converged_;
+	double				tolerance_;
+	bool				is_mixed_precision_;
+	int					max_refinements_;
+	bool				is_single_factor_;		//!< the factors are ldlt_single_
+	bool				is_precision_fallback_;
+	std::vector<double>	refinement_history_;
+
+	LaplacianAssembler::Weights	weights_;
+	bool				is_double_analyzed_;	//!< ldlt_ has the ordering of matrix_
+	bool				is_single_analyzed_;
+
+	bool				is_factor_reused_;
+	double				factor_ms_;
+	double				solve_ms_;
+};
@@ -0,0 +1,270 @@
+#include "LaplacianAssembler.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace
+{
+	typedef trimesh::Vec<3, double> Vec3d;
+
+	Vec3d Position(const std::vector<HE_vert*>& verts, int i)
+	{
+		const Vec3f& p = verts[i]->position_;
+		return Vec3d(p[0], p[1], p[2]);
+	}
+
+	//! cotangent of the angle at a in triangle (a, b, c)
+	double Cotangent(const Vec3d& a, const Vec3d& b, const Vec3d& c)
+	{
+		Vec3d u = b - a, v = c - a;
+		double sine = len(u ^ v);
+		return sine > 0.0 ? u.dot(v) / sine : 0.0;
+	}
+
+	//! tangent of half the angle at a in triangle (a, b, c)
+	double HalfTangent(const Vec3d& a, const Vec3d& b, const Vec3d& c)
+	{
+		Vec3d u = b - a, v = c - a;
+		double cosine = len(u) * len(v) + u.dot(v);
+		return cosine > 0.0 ? len(u ^ v) / cosine : 0.0;
+	}
+
+	double Area(const Vec3d& a, const Vec3d& b, const Vec3d& c)
+	{
+		return 0.5 * len((b - a) ^ (c - a));
+	}
+}
+
+double LaplacianAssembler::EdgeWeight(Weights weights, const std::vector<HE_vert*>& verts,
+	int i, int j, int a, int b)
+{
+	if (weights == UNIFORM)
+	{
+		return 1.0;
+	}
+	Vec3d pi = Position(verts, i), pj = Position(verts, j);
+	double w = 0.0;
+	if (weights == COTANGENT)
+	{
+		w += a >= 0 ? Cotangent(Position(verts, a), pi, pj) : 0.0;
+		w += b >= 0 ? Cotangent(Position(verts, b), pi, pj) : 0.0;
+		return 0.5 * w;
+	}
+	double length = dist(pi, pj);
+	if (length <= 0.0)
+	{
+		return 0.0;
+	}
+	w += a >= 0 ? HalfTangent(pi, pj, Position(verts, a)) : 0.0;
+	w += b >= 0 ? HalfTangent(pi, pj, Position(verts, b)) : 0.0;
+	return w / length;
+}
+
+LaplacianAssembler::LaplacianAssembler(void)
+	: mesh_(NULL), topology_version_(0), num_threads_(0)
+{
+}
+
+LaplacianAssembler::~LaplacianAssembler(void)
+{
+}
+
+void LaplacianAssembler::Clear(void)
+{
+	mesh_ = NULL;
+	adjacency_.Clear();
+	std::vector<int>().swap(outer_);
+	std::vector<int>().swap(inner_);
+	std::vector<int>().swap(source_);
+	std::vector<int>().swap(diagonal_outer_);
+	std::vector<int>().swap(diagonal_inner_);
+}
+
+bool LaplacianAssembler::Build(Mesh3D* mesh)
+{
+	if (mesh == NULL || mesh->num_of_vertex_list() == 0)
+	{
+		Clear();
+		return false;
+	}
+	if (mesh == mesh_ && mesh->topology_version() == topology_version_)
+	{
+		return true;
+	}
+	Clear();
+	mesh_ = mesh;
+	topology_version_ = mesh->topology_version();
+	adjacency_.Build(mesh);
+
+	// the one-ring sorted by id, with the diagonal at its place
+	int num_vertex = adjacency_.num_vertex();
+	int num_entries = static_cast<int>(adjacency_.indices().size()) + num_vertex;
+	outer_.reserve(num_vertex + 1);
+	inner_.reserve(num_entries);
+	source_.reserve(num_entries);
+	diagonal_outer_.reserve(num_vertex + 1);
+	diagonal_inner_.reserve(num_vertex);
+	std::vector<std::pair<int, int> > column;
+	outer_.push_back(0);
+	diagonal_outer_.push_back(0);
+	for (int j = 0; j < num_vertex; j++)
+	{
+		const int* ring = adjacency_.neighbors(j);
+		column.clear();
+		column.push_back(std::make_pair(j, -1));
+		for (int k = 0; k < adjacency_.degree(j); k++)
+		{
+			column.push_back(std::make_pair(ring[k], adjacency_.offsets()[j] + k));
+		}
+		std::sort(column.begin(), column.end());
+		for (size_t k = 0; k != column.size(); k++)
+		{
+			inner_.push_back(column[k].first);
+			source_.push_back(column[k].second);
+		}
+		outer_.push_back(static_cast<int>(inner_.size()));
+		diagonal_inner_.push_back(j);
+		diagonal_outer_.push_back(j + 1);
+	}
+	return true;
+}
+
+void LaplacianAssembler::SetPattern(SparseMatrix& matrix, const std::vector<int>& outer, const std::vector<int>& inner)
+{
+	int n = static_cast<int>(outer.size()) - 1;
+	if (matrix.rows() == n && matrix.cols() == n && matrix.isCompressed()
+		&& matrix.nonZeros() == static_cast<int>(inner.size())
+		&& std::equal(outer.begin(), outer.end(), matrix.outerIndexPtr())
+		&& std::equal(inner.begin(), inner.end(), matrix.innerIndexPtr()))
+	{
+		return;
+	}
+	matrix.resize(n, n);
+	matrix.resizeNonZeros(static_cast<int>(inner.size()));
+	std::copy(outer.begin(), outer.end(), matrix.outerIndexPtr());
+	std::copy(inner.begin(), inner.end(), matrix.innerIndexPtr());
+}
+
+template <typename Fill>
+void LaplacianAssembler::ParallelFor(Fill fill) const
+{
+	// below this many vertices per thread, starting the threads costs more than the fill
+	const int kGrain = 1 << 13;
+	int count = num_vertex();
+	int num_threads = num_threads_ > 0 ? num_threads_ : static_cast<int>(std::thread::hardware_concurrency());
+	int useful = count / kGrain;
+	num_threads = num_threads < useful ? num_threads : useful;
+	num_threads = num_threads > 1 ? num_threads : 1;
+
+	int chunk = (count + num_threads - 1) / num_threads;
+	std::vector<std::thread> workers;
+	for (int t = 1; t < num_threads; t++)
+	{
+		int end = (t + 1) * chunk < count ? (t + 1) * chunk : count;
+		if (t * chunk < end)
+		{
+			workers.push_back(std::thread(fill, t * chunk, end));
+		}
+	}
+	fill(0, chunk < count ? chunk : count);
+	for (size_t t = 0; t != workers.size(); t++)
+	{
+		workers[t].join();
+	}
+}
+
+bool LaplacianAssembler::AssembleLaplacian(Mesh3D* mesh, Weights weights, SparseMatrix& matrix)
+{
+	if (!Build(mesh))
+	{
+		return false;
+	}
+	SetPattern(matrix, outer_, inner_);
+
+	// column j holds L(i, j) = -w_ij for its neighbors i, and the row sum of j on the diagonal
+	const std::vector<HE_vert*>& verts = *(mesh->get_vertex_list());
+	const int* indices = adjacency_.indices().data();
+	const int* opposites = adjacency_.opposites(0);
+	double* values = matrix.valuePtr();
+	ParallelFor([&](int first, int last)
+	{
+		for (int j = first; j < last; j++)
+		{
+			double sum = 0.0;
+			int diagonal = -1;
+			for (int p = outer_[j]; p < outer_[j + 1]; p++)
+			{
+				int e = source_[p];
+				if (e < 0)
+				{
+					diagonal = p;
+					continue;
+				}
+				int i = indices[e], a = opposites[2 * e], b = opposites[2 * e + 1];
+				double w = EdgeWeight(weights, verts, j, i, a, b);
+				sum += w;
+				values[p] = weights == MEAN_VALUE ? -EdgeWeight(weights, verts, i, j, a, b) : -w;
+			}
+			values[diagonal] = sum;
+		}
+	});
+	return true;
+}
+
+bool LaplacianAssembler::AssembleMass(Mesh3D* mesh, Mass mass, SparseMatrix& matrix)
+{
+	if (!Build(mesh))
+	{
+		return false;
+	}
+	if (mass == LUMPED)
+	{
+		SetPattern(matrix, diagonal_outer_, diagonal_inner_);
+	}
+	else
+	{
+		SetPattern(matrix, outer_, inner_);
+	}
+
+	// each face around j is counted once, from the half-edge leaving j
+	const std::vector<HE_vert*>& verts = *(mesh->get_vertex_list());
+	const int* indices = adjacency_.indices().data();
+	const int* opposites = adjacency_.opposites(0);
+	double* values = matrix.valuePtr();
+	ParallelFor([&](int first, int last)
+	{
+		for (int j = first; j < last; j++)
+		{
+			Vec3d pj = Position(verts, j);
+			double area = 0.0;
+			int diagonal = -1;
+			for (int p = outer_[j]; p < outer_[j + 1]; p++)
+			{
+				int e = source_[p];
+				if (e < 0)
+				{
+					diagonal = p;
+					continue;
+				}
+				int a = opposites[2 * e], b = opposites[2 * e + 1];
+				Vec3d pi = Position(verts, indices[e]);
+				double left = a >= 0 ? Area(pj, pi, Position(verts, a)) : 0.0;
+				double right = b >= 0 ? Area(pj, pi, Position(verts, b)) : 0.0;
+				area += left;
+				if (mass == GALERKIN)
+				{
+					values[p] = (left + right) / 12.0;
+				}
+			}
+			if (mass == LUMPED)
+			{
+				values[j] = area / 3.0;
+			}
+			else
+			{
+				values[diagonal] = area / 6.0;
+			}
+		}
+	});
+	return true;
+}
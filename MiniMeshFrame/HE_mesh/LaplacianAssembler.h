@@ -0,0 +1,83 @@
+#pragma once
+
+#include <vector>
+#include <Eigen/Sparse>
+#include "Mesh3D.h"
+#include "VertexAdjacency.h"
+
+/*!
+*	Laplacians and mass matrices of a mesh written straight into compressed Eigen storage.
+*	The sparsity pattern is taken from the one-rings, the diagonal and the neighbors of each
+*	vertex in increasing order, and kept with the topology_version of the mesh. Assembling
+*	again after the positions moved only rewrites the values, in parallel over the columns,
+*	with no triplet list to sort and merge; a matrix that already holds the pattern keeps
+*	its index arrays.
+*	The Laplacian is L = D - W, L(i, j) = -w_ij and L(i, i) the sum of the w_ij of row i,
+*	symmetric positive semi-definite for the uniform and cotangent weights. The mean-value
+*	weights take the angles at vertex i and are not symmetric. The angles and areas are those
+*	of the triangles made by an edge and its opposite vertices, the corner triangles of a polygon.
+*/
+class LaplacianAssembler
+{
+public:
+	typedef Eigen::SparseMatrix<double> SparseMatrix;
+
+	enum Weights
+	{
+		UNIFORM,			//!< 1
+		COTANGENT,			//!< (cot a + cot b) / 2, a and b opposite to the edge
+		MEAN_VALUE			//!< (tan(g1 / 2) + tan(g2 / 2)) / |x_j - x_i|, g1 and g2 at vertex i
+	};
+
+	enum Mass
+	{
+		LUMPED,				//!< diagonal, a third of the area of the triangles around the vertex
+		GALERKIN			//!< linear finite elements, area / 6 on the diagonal and / 12 off it
+	};
+
+	LaplacianAssembler(void);
+	~LaplacianAssembler(void);
+
+	//! rebuild the pattern if the mesh or its connectivity changed
+	/*!
+	*	\return false if the mesh is empty
+	*/
+	bool Build(Mesh3D* mesh);
+	void Clear(void);
+
+	//! n x n Laplacian with the current positions, Build is called as needed
+	bool AssembleLaplacian(Mesh3D* mesh, Weights weights, SparseMatrix& matrix);
+	//! n x n mass matrix with the current positions, diagonal for LUMPED
+	bool AssembleMass(Mesh3D* mesh, Mass mass, SparseMatrix& matrix);
+
+	//! w_ij of the edge from i to j, opposite to the vertices a and b (-1 for none)
+	static double EdgeWeight(Weights weights, const std::vector<HE_vert*>& verts, int i, int j, int a, int b);
+
+	//! 0 uses every hardware thread
+	void set_num_threads(int n) {num_threads_ = n;}
+
+	const VertexAdjacency& adjacency(void) const {return adjacency_;}
+	int num_vertex(void) const {return adjacency_.num_vertex();}
+	//! entries of the Laplacian and Galerkin patterns
+	int num_nonzeros(void) const {return outer_.empty() ? 0 : outer_.back();}
+
+private:
+	//! copy a pattern into the matrix unless it already holds it
+	static void SetPattern(SparseMatrix& matrix, const std::vector<int>& outer, const std::vector<int>& inner);
+	//! run fill(first, last) over the vertices, split between the threads
+	template <typename Fill>
+	void ParallelFor(Fill fill) const;
+
+private:
+	Mesh3D				*mesh_;				//!< the pattern is that of this mesh
+	unsigned int		topology_version_;
+	VertexAdjacency		adjacency_;
+
+	std::vector<int>	outer_;				//!< column starts, num_vertex + 1 entries
+	std::vector<int>	inner_;				//!< row of each entry, increasing in a column
+	std::vector<int>	source_;			//!< entry of the adjacency of each entry, -1 on the diagonal
+	std::vector<int>	diagonal_outer_;	//!< the pattern of the lumped mass
+	std::vector<int>	diagonal_inner_;
+
+	int					num_threads_;
+};
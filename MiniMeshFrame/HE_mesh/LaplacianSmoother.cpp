@@ -0,0 +1,235 @@
+#include "LaplacianSmoother.h"
+
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <thread>
+
+namespace
+{
+	//! the threads of one iteration meet here between two colors
+	class SpinBarrier
+	{
+	public:
+		explicit SpinBarrier(int count) : count_(count), waiting_(0), generation_(0) {}
+
+		void Wait(void)
+		{
+			int generation = generation_.load();
+			if (waiting_.fetch_add(1) + 1 == count_)
+			{
+				waiting_.store(0);
+				generation_.fetch_add(1);
+				return;
+			}
+			while (generation_.load() == generation)
+			{
+				std::this_thread::yield();
+			}
+		}
+
+	private:
+		int					count_;
+		std::atomic<int>	waiting_;
+		std::atomic<int>	generation_;
+	};
+}
+
+LaplacianSmoother::LaplacianSmoother(void)
+	: scale_(1.f), method_(GAUSS_SEIDEL), relaxation_(1.f), tolerance_(1e-6f), max_iterations_(3000)
+	, num_threads_(0), iteration_(0), residual_(FLT_MAX)
+{
+}
+
+LaplacianSmoother::~LaplacianSmoother(void)
+{
+}
+
+bool LaplacianSmoother::Initialize(Mesh3D* mesh)
+{
+	adjacency_.Build(mesh);
+	inner_.clear();
+	positions_.clear();
+	residual_history_.clear();
+	iteration_ = 0;
+	residual_ = FLT_MAX;
+	if (adjacency_.num_boundary() == 0)
+	{
+		return false;
+	}
+
+	const std::vector<HE_vert*>& verts = *(mesh->get_vertex_list());
+	positions_.resize(verts.size());
+	Vec3f low(FLT_MAX, FLT_MAX, FLT_MAX), high(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (size_t i = 0; i != verts.size(); i++)
+	{
+		positions_[i] = verts[i]->position_;
+		for (int c = 0; c < 3; c++)
+		{
+			low[c] = positions_[i][c] < low[c] ? positions_[i][c] : low[c];
+			high[c] = positions_[i][c] > high[c] ? positions_[i][c] : high[c];
+		}
+		if (!adjacency_.is_boundary(static_cast<int>(i)) && adjacency_.degree(static_cast<int>(i)) > 0)
+		{
+			inner_.push_back(static_cast<int>(i));
+		}
+	}
+	scale_ = dist(low, high) > 0.f ? dist(low, high) : 1.f;
+	next_ = positions_;
+	ColorVertices();
+	return true;
+}
+
+void LaplacianSmoother::ColorVertices(void)
+{
+	// greedy, in the order of the ids: the smallest color no colored neighbor has
+	int num_vertex = adjacency_.num_vertex();
+	std::vector<int> color(num_vertex, -1);
+	std::vector<int> used;				// used[c] == i if a neighbor of i has color c
+	std::vector<int> counts;
+	for (size_t k = 0; k != inner_.size(); k++)
+	{
+		int i = inner_[k];
+		const int* ring = adjacency_.neighbors(i);
+		for (int j = 0; j < adjacency_.degree(i); j++)
+		{
+			if (color[ring[j]] >= 0)
+			{
+				used[color[ring[j]]] = i;
+			}
+		}
+		int c = 0;
+		while (c < static_cast<int>(used.size()) && used[c] == i)
+		{
+			c++;
+		}
+		if (c == static_cast<int>(used.size()))
+		{
+			used.push_back(-1);
+			counts.push_back(0);
+		}
+		color[i] = c;
+		counts[c]++;
+	}
+
+	color_offsets_.assign(1, 0);
+	for (size_t c = 0; c != counts.size(); c++)
+	{
+		color_offsets_.push_back(color_offsets_.back() + counts[c]);
+	}
+	std::vector<int> fill(color_offsets_.begin(), color_offsets_.end() - 1);
+	color_vertices_.resize(inner_.size());
+	for (size_t k = 0; k != inner_.size(); k++)
+	{
+		color_vertices_[fill[color[inner_[k]]]++] = inner_[k];
+	}
+}
+
+int LaplacianSmoother::ThreadCount(void) const
+{
+	// below this many vertices per thread, starting the threads costs more than the sweep
+	const int kGrain = 1 << 13;
+	int num_threads = num_threads_ > 0 ? num_threads_ : static_cast<int>(std::thread::hardware_concurrency());
+	int useful = static_cast<int>(inner_.size()) / kGrain;
+	num_threads = num_threads < useful ? num_threads : useful;
+	return num_threads > 1 ? num_threads : 1;
+}
+
+double LaplacianSmoother::SweepJacobi(int first, int last)
+{
+	double sum = 0.0;
+	for (int k = first; k < last; k++)
+	{
+		int i = inner_[k];
+		const int* ring = adjacency_.neighbors(i);
+		int degree = adjacency_.degree(i);
+		Vec3f average(0.f, 0.f, 0.f);
+		for (int j = 0; j < degree; j++)
+		{
+			average += positions_[ring[j]];
+		}
+		Vec3f move = average / static_cast<float>(degree) - positions_[i];
+		next_[i] = positions_[i] + move * relaxation_;
+		sum += move.dot(move);
+	}
+	return sum;
+}
+
+double LaplacianSmoother::SweepGaussSeidel(int first, int last)
+{
+	double sum = 0.0;
+	for (int k = first; k < last; k++)
+	{
+		int i = color_vertices_[k];
+		const int* ring = adjacency_.neighbors(i);
+		int degree = adjacency_.degree(i);
+		Vec3f average(0.f, 0.f, 0.f);
+		for (int j = 0; j < degree; j++)
+		{
+			average += positions_[ring[j]];
+		}
+		Vec3f move = average / static_cast<float>(degree) - positions_[i];
+		positions_[i] += move * relaxation_;
+		sum += move.dot(move);
+	}
+	return sum;
+}
+
+bool LaplacianSmoother::Iterate(void)
+{
+	if (iteration_ >= max_iterations_ || inner_.empty() || residual_ <= tolerance_)
+	{
+		return false;
+	}
+
+	int num_threads = ThreadCount();
+	std::vector<double> sums(num_threads, 0.0);
+	SpinBarrier barrier(num_threads);
+	auto sweep = [&](int t)
+	{
+		if (method_ == JACOBI)
+		{
+			int count = static_cast<int>(inner_.size());
+			int chunk = (count + num_threads - 1) / num_threads;
+			int end = (t + 1) * chunk < count ? (t + 1) * chunk : count;
+			sums[t] = t * chunk < end ? SweepJacobi(t * chunk, end) : 0.0;
+			return;
+		}
+		for (int c = 0; c < num_colors(); c++)
+		{
+			int begin = color_offsets_[c], count = color_offsets_[c + 1] - begin;
+			int chunk = (count + num_threads - 1) / num_threads;
+			int end = (t + 1) * chunk < count ? (t + 1) * chunk : count;
+			sums[t] += t * chunk < end ? SweepGaussSeidel(begin + t * chunk, begin + end) : 0.0;
+			if (num_threads > 1)
+			{
+				barrier.Wait();
+			}
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (int t = 1; t < num_threads; t++)
+	{
+		workers.push_back(std::thread(sweep, t));
+	}
+	sweep(0);
+	double sum = 0.0;
+	for (int t = 0; t < num_threads; t++)
+	{
+		if (t > 0)
+		{
+			workers[t - 1].join();
+		}
+		sum += sums[t];
+	}
+	if (method_ == JACOBI)
+	{
+		positions_.swap(next_);
+	}
+
+	residual_ = static_cast<float>(sqrt(sum / inner_.size())) / scale_;
+	residual_history_.push_back(residual_);
+	iteration_++;
+	return iteration_ < max_iterations_ && residual_ > tolerance_;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vector>
+#include "Mesh3D.h"
+#include "SolverThread.h"
+#include "VertexAdjacency.h"
+
+/*!
+*	Uniform Laplacian smoothing with a fixed boundary, the local minimal surface.
+*	Each iteration moves the inner vertices toward the average of their one-ring, either
+*	all at once from the previous positions (JACOBI, damped by the relaxation) or in place
+*	(GAUSS_SEIDEL, over-relaxed above 1 for SOR). Gauss-Seidel sweeps the vertices color by
+*	color of a greedy coloring of the inner vertices, so the vertices of a color have no
+*	common edge and are updated in parallel; the threads wait for each other between two
+*	colors. The iterations run on the CSR one-rings and a contiguous copy of the positions.
+*	The residual is the RMS length of the moves to the one-ring averages divided by the
+*	diagonal of the bounding box, iterations stop once it is below the tolerance.
+*/
+class LaplacianSmoother : public IterativeSolver
+{
+public:
+	enum Method
+	{
+		JACOBI,
+		GAUSS_SEIDEL
+	};
+
+	LaplacianSmoother(void);
+	~LaplacianSmoother(void);
+
+	//! copy the positions and the one-rings of a mesh, color the inner vertices
+	/*!
+	*	\return false if the mesh has no boundary, there is no minimal surface to find
+	*/
+	bool Initialize(Mesh3D* mesh);
+
+	void set_method(Method method) {method_ = method;}
+	//! the fraction of the way to the average moved, 0.3 is the damped Jacobi of the widget
+	void set_relaxation(float omega) {relaxation_ = omega;}
+	void set_tolerance(float tolerance) {tolerance_ = tolerance;}
+	void set_max_iterations(int n) {max_iterations_ = n;}
+	//! 0 uses every hardware thread
+	void set_num_threads(int n) {num_threads_ = n;}
+
+	bool Iterate(void);
+	void GetPositions(std::vector<Vec3f>& positions) const {positions = positions_;}
+	float residual(void) const {return residual_;}
+
+	int iteration(void) const {return iteration_;}
+	//! the residual after each iteration
+	const std::vector<float>& residual_history(void) const {return residual_history_;}
+	int num_colors(void) const {return static_cast<int>(color_offsets_.size()) - 1;}
+
+private:
+	void ColorVertices(void);
+	//! Jacobi over inner_[first, last), returns the sum of the squared moves
+	double SweepJacobi(int first, int last);
+	//! Gauss-Seidel over color_vertices_[first, last)
+	double SweepGaussSeidel(int first, int last);
+	int ThreadCount(void) const;
+
+private:
+	VertexAdjacency		adjacency_;
+	std::vector<int>	inner_;				//!< the vertices that move
+	std::vector<int>	color_offsets_;		//!< the inner vertices by color, in compressed rows
+	std::vector<int>	color_vertices_;
+	std::vector<Vec3f>	positions_;
+	std::vector<Vec3f>	next_;				//!< Jacobi, the boundary is the same in both
+	float				scale_;				//!< diagonal of the bounding box
+
+	Method				method_;
+	float				relaxation_;
+	float				tolerance_;
+	int					max_iterations_;
+	int					num_threads_;
+
+	int					iteration_;
+	float				residual_;
+	std::vector<float>	residual_history_;
+};
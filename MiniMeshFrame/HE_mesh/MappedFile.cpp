@@ -0,0 +1,248 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+MappedFile::MappedFile(void)
+#ifdef _WIN32
+	: hfile_(INVALID_HANDLE_VALUE), hmapping_(NULL)
+#else
+	: fd_(-1)
+#endif
+	, writable_(false), size_(0)
+{
+}
+
+MappedFile::~MappedFile(void)
+{
+	Close();
+}
+
+size_t MappedFile::granularity(void)
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwAllocationGranularity;
+#else
+	return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+bool MappedFile::isOpen(void) const
+{
+#ifdef _WIN32
+	return hfile_ != INVALID_HANDLE_VALUE;
+#else
+	return fd_ >= 0;
+#endif
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const char* name, bool writable)
+{
+	Close();
+	hfile_ = CreateFileA(name, writable ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ,
+		FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hfile_ == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	LARGE_INTEGER size;
+	GetFileSizeEx(hfile_, &size);
+	size_ = static_cast<unsigned long long>(size.QuadPart);
+	writable_ = writable;
+	if (size_ == 0)
+	{
+		return true;
+	}
+	hmapping_ = CreateFileMappingA(hfile_, NULL, writable ? PAGE_READWRITE : PAGE_READONLY, 0, 0, NULL);
+	if (hmapping_ == NULL)
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+bool MappedFile::Create(const char* name, unsigned long long size)
+{
+	Close();
+	hfile_ = CreateFileA(name, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL,
+		OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hfile_ == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	LARGE_INTEGER li;
+	li.QuadPart = static_cast<LONGLONG>(size);
+	if (!SetFilePointerEx(hfile_, li, NULL, FILE_BEGIN) || !SetEndOfFile(hfile_))
+	{
+		Close();
+		return false;
+	}
+	size_ = size;
+	writable_ = true;
+	if (size_ == 0)
+	{
+		return true;
+	}
+	hmapping_ = CreateFileMappingA(hfile_, NULL, PAGE_READWRITE, 0, 0, NULL);
+	if (hmapping_ == NULL)
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::Close(void)
+{
+	if (hmapping_ != NULL)
+	{
+		CloseHandle(hmapping_);
+		hmapping_ = NULL;
+	}
+	if (hfile_ != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(hfile_);
+		hfile_ = INVALID_HANDLE_VALUE;
+	}
+	size_ = 0;
+	writable_ = false;
+}
+
+MappedView MappedFile::Map(unsigned long long offset, size_t length)
+{
+	MappedView view;
+	if (hmapping_ == NULL || length == 0 || offset + length > size_)
+	{
+		return view;
+	}
+	unsigned long long aligned = offset - offset % granularity();
+	size_t extra = static_cast<size_t>(offset - aligned);
+	void *base = MapViewOfFile(hmapping_, writable_ ? FILE_MAP_WRITE : FILE_MAP_READ,
+		static_cast<DWORD>(aligned >> 32), static_cast<DWORD>(aligned & 0xffffffffu), length + extra);
+	if (base == NULL)
+	{
+		return view;
+	}
+	view.base_ = base;
+	view.length_ = length + extra;
+	view.data_ = static_cast<char*>(base) + extra;
+	return view;
+}
+
+void MappedFile::Unmap(MappedView& view)
+{
+	if (view.base_ != NULL)
+	{
+		UnmapViewOfFile(view.base_);
+	}
+	view = MappedView();
+}
+
+void MappedFile::Flush(MappedView& view)
+{
+	if (view.base_ != NULL)
+	{
+		FlushViewOfFile(view.base_, view.length_);
+	}
+}
+
+#else
+
+bool MappedFile::Open(const char* name, bool writable)
+{
+	Close();
+	fd_ = open(name, writable ? O_RDWR : O_RDONLY);
+	if (fd_ < 0)
+	{
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd_, &st) != 0)
+	{
+		Close();
+		return false;
+	}
+	size_ = static_cast<unsigned long long>(st.st_size);
+	writable_ = writable;
+	return true;
+}
+
+bool MappedFile::Create(const char* name, unsigned long long size)
+{
+	Close();
+	fd_ = open(name, O_RDWR | O_CREAT, 0644);
+	if (fd_ < 0)
+	{
+		return false;
+	}
+	if (ftruncate(fd_, static_cast<off_t>(size)) != 0)
+	{
+		Close();
+		return false;
+	}
+	size_ = size;
+	writable_ = true;
+	return true;
+}
+
+void MappedFile::Close(void)
+{
+	if (fd_ >= 0)
+	{
+		close(fd_);
+		fd_ = -1;
+	}
+	size_ = 0;
+	writable_ = false;
+}
+
+MappedView MappedFile::Map(unsigned long long offset, size_t length)
+{
+	MappedView view;
+	if (fd_ < 0 || length == 0 || offset + length > size_)
+	{
+		return view;
+	}
+	unsigned long long aligned = offset - offset % granularity();
+	size_t extra = static_cast<size_t>(offset - aligned);
+	void *base = mmap(NULL, length + extra, writable_ ? (PROT_READ | PROT_WRITE) : PROT_READ,
+		MAP_SHARED, fd_, static_cast<off_t>(aligned));
+	if (base == MAP_FAILED)
+	{
+		return view;
+	}
+	view.base_ = base;
+	view.length_ = length + extra;
+	view.data_ = static_cast<char*>(base) + extra;
+	return view;
+}
+
+void MappedFile::Unmap(MappedView& view)
+{
+	if (view.base_ != NULL)
+	{
+		munmap(view.base_, view.length_);
+	}
+	view = MappedView();
+}
+
+void MappedFile::Flush(MappedView& view)
+{
+	if (view.base_ != NULL)
+	{
+		msync(view.base_, view.length_, MS_SYNC);
+	}
+}
+
+#endif
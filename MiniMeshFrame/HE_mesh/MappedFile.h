@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+
+//! a view of a range of a mapped file
+struct MappedView
+{
+	void	*base_;			//!< start of the mapping, aligned to the allocation granularity
+	size_t	length_;		//!< length of the mapping
+	char	*data_;			//!< the requested offset inside the mapping
+
+	MappedView() : base_(NULL), length_(0), data_(NULL) {}
+	bool isValid(void) const {return data_ != NULL;}
+};
+
+/*!
+*	A file accessed through memory mapping (MapViewOfFile on Windows, mmap elsewhere).
+*	Any range of the file can be mapped; the offset is aligned internally.
+*/
+class MappedFile
+{
+public:
+	MappedFile(void);
+	~MappedFile(void);
+
+	//! open an existing file
+	bool Open(const char* name, bool writable);
+	//! create a file of the given size, or resize an existing one, for reading and writing
+	bool Create(const char* name, unsigned long long size);
+	void Close(void);
+
+	bool isOpen(void) const;
+	bool writable(void) const {return writable_;}
+	unsigned long long size(void) const {return size_;}
+
+	//! map length bytes starting at offset
+	MappedView Map(unsigned long long offset, size_t length);
+	//! release a view, written pages are left to the system to flush
+	void Unmap(MappedView& view);
+	//! write the dirty pages of a view back to disk
+	void Flush(MappedView& view);
+
+	//! alignment required by the system for mapping offsets
+	static size_t granularity(void);
+
+private:
+	MappedFile(const MappedFile&);
+	MappedFile& operator = (const MappedFile&);
+
+private:
+#ifdef _WIN32
+	void				*hfile_;
+	void				*hmapping_;
+#else
+	int					fd_;
+#endif
+	bool				writable_;
+	unsigned long long	size_;
+};
@@ -1,13 +1,61 @@
 #include "Mesh3D.h"
+#include "PolygonTriangulator.h"
+#include "MeshStream.h"
 
 #include <fstream>
+#include <cfloat>
+#include <cstring>
 #include <iostream>
+#include <thread>
 #include <xutility>
 
 #define SWAP(a,b,T) {T tmp=(a); (a)=(b); (b)=tmp;}
 #define min(a,b) a<b?a:b
 #define max(a,b) a>b?a:b
 
+namespace
+{
+	//! whether order holds each id in [0, n) once
+	bool IsPermutation(const std::vector<int>& order, int n)
+	{
+		if (static_cast<int>(order.size()) != n)
+		{
+			return false;
+		}
+		std::vector<bool> seen(n, false);
+		for (size_t i = 0; i != order.size(); i++)
+		{
+			if (order[i] < 0 || order[i] >= n || seen[order[i]])
+			{
+				return false;
+			}
+			seen[order[i]] = true;
+		}
+		return true;
+	}
+
+	//! read a whole line into line, growing it for the lines longer than it
+	bool ReadLine(FILE* pfile, std::vector<char>& line)
+	{
+		size_t length = 0;
+		for (;;)
+		{
+			if (line.size() - length < 2)
+			{
+				line.resize(line.size() * 2);
+			}
+			if (fgets(&line[length], static_cast<int>(line.size() - length), pfile) == NULL)
+			{
+				return length > 0;
+			}
+			length += strlen(&line[length]);
+			if (length > 0 && line[length - 1] == '\n')
+			{
+				return true;
+			}
+		}
+	}
+}
 
 Mesh3D::Mesh3D(void)
 {
@@ -21,6 +69,20 @@ Mesh3D::Mesh3D(void)
 
 	num_components_ = 0;
 	average_edge_length_ = 1.f;
+	triangulate_on_load_ = true;
+
+	topology_version_ = 0;
+	geometry_version_ = 0;
+	dirty_first_ = INT_MAX;
+	dirty_last_ = 0;
+	unique_edges_version_ = topology_version_;
+
+	tex_mapping_ = TEX_FROM_FILE;
+	has_file_texcoords_ = false;
+	has_file_normals_ = false;
+	texcoords_dirty_ = true;
+	texcoords_topology_version_ = 0;
+	texcoords_geometry_version_ = 0;
 }
 
 void Mesh3D::ClearData(void)
@@ -29,9 +91,17 @@ void Mesh3D::ClearData(void)
 	ClearEdges();
 	ClearFaces();
 	edgemap_.clear();
+	unique_edges_.clear();
+	has_file_texcoords_ = false;
+	has_file_normals_ = false;
+	texcoords_dirty_ = true;
 
 	xmax_ = ymax_ = zmax_ = 1.f;
 	xmin_ = ymin_ = zmin_ = -1.f;
+
+	topology_version_++;
+	dirty_first_ = INT_MAX;
+	dirty_last_ = 0;
 }
 
 void Mesh3D::ClearVertex(void)
@@ -218,130 +288,98 @@ bool Mesh3D::LoadFromOBJFile(const char* fins)
 {
 	//	cout << "Loading......." << endl;
 	FILE *pfile = fopen(fins, "r");
-
-	char *tok;
-	//char *tok_tok;
-	char temp[128];
+	if (pfile == NULL)
+	{
+		return false;
+	}
 
 	try
 	{
 		ClearData();
-		//read vertex
-		fseek(pfile, 0, SEEK_SET);
-		char pLine[512];
 
-		while(fgets(pLine, 512, pfile))
+		// one pass: the faces are inserted as they come, except those referring to
+		// vertices further in the file which are kept for the end
+		std::vector<Vec3f> texCoords, normals;
+		std::vector<std::vector<int> > deferred;
+		std::vector<int> corners;
+		std::vector<char> line(8192);
+
+		while(ReadLine(pfile, line))
 		{
-			if(pLine[0] == 'v' && pLine[1] == ' ')
+			char *pLine = &line[0];
+			if (pLine[0] == 'v')
 			{
-				Vec3f nvv;
-				tok = strtok(pLine," ");
-				for (int i=0; i<3; i++) 
+				// "v x y z", "vt u v [w]" or "vn x y z", missing values stay 0
+				Vec3f nvv(0.f, 0.f, 0.f);
+				char *pTmp = pLine + 2;
+				for (int i=0; i<3; i++)
 				{
-					tok = strtok(NULL," ");
-					strcpy(temp, tok);
-					temp[strcspn(temp," ")] = 0;
-					nvv[i] = (float)atof(temp);
+					nvv[i] = (float)strtod(pTmp, &pTmp);
+				}
+				if (pLine[1] == ' ' || pLine[1] == '\t')
+				{
+					InsertVertex(nvv);
+				}
+				else if (pLine[1] == 't')
+				{
+					texCoords.push_back(nvv);
+				}
+				else if (pLine[1] == 'n')
+				{
+					normals.push_back(nvv);
 				}
-				InsertVertex(nvv);
 			}
-		}
-
-		//read facets
-		fseek(pfile, 0, SEEK_SET);
-
-		while(fgets(pLine, 512, pfile))
-		{
-			char *pTmp = pLine;
-			if(pTmp[0] == 'f')
+			else if (pLine[0] == 'f' && (pLine[1] == ' ' || pLine[1] == '\t'))
 			{
-				std::vector<HE_vert* > s_faceid;
-
-				tok = strtok(pLine," ");
-				while ((tok = strtok(NULL," ")) != NULL)
+				// corners are v, v/t, v//n or v/t/n, negative indices count from the end
+				int counts[3] = {num_of_vertex_list(), (int)texCoords.size(), (int)normals.size()};
+				bool later = false;
+				corners.clear();
+				char *pTmp = pLine + 1;
+				for (;;)
 				{
-					strcpy(temp, tok);
-					temp[strcspn(temp, "/")] = 0;
-					int id = (int)strtol(temp, NULL, 10) - 1;
-					HE_vert* hv = get_vertex(id);
-					bool findit = false;
-					for (int i = 0; i <(int) s_faceid.size(); i++)
+					while (*pTmp == ' ' || *pTmp == '\t')
+						pTmp++;
+					if ((*pTmp < '0' || *pTmp > '9') && *pTmp != '-')
+						break;
+					for (int k=0; k<3; k++)
 					{
-						if (hv == s_faceid[i])	//remove redundant vertex id if it exists
+						int id = -1;
+						if (k == 0 || *pTmp == '/')
 						{
-							//	cout << "remove redundant vertex" << endl;
-							findit = true;
-							break;
+							if (k > 0)
+								pTmp++;
+							char *pEnd;
+							long value = strtol(pTmp, &pEnd, 10);
+							if (pEnd != pTmp)
+								id = value < 0 ? counts[k] + (int)value : (int)value - 1;
+							pTmp = pEnd;
 						}
+						corners.push_back(id);
 					}
-					if (findit == false && hv != NULL)
-					{
-						s_faceid.push_back(hv);
-					}
+					later = later || corners[corners.size()-3] >= counts[0];
+					while (*pTmp != 0 && *pTmp != ' ' && *pTmp != '\t' && *pTmp != '\r' && *pTmp != '\n')
+						pTmp++;
 				}
-				if ((int)s_faceid.size() >= 3)
+				if (later)
 				{
-					InsertFace(s_faceid);
+					deferred.push_back(corners);
 				}
-			}
-		}
-
-		//read texture coords
-		fseek(pfile, 0, SEEK_SET);
-		std::vector<Vec3f> texCoordsTemp;
-		while (fscanf(pfile, "%s", pLine) != EOF)
-		{
-			if (pLine[0] == 'v' && pLine[1] == 't')
-			{
-				Vec3f texTemp(0.f, 0.f, 0.f);
-				fscanf(pfile, "%f %f", &texTemp[0], &texTemp[1]);
-				texCoordsTemp.push_back(texTemp);
-			}
-		}
-		//read texture index
-
-		if (texCoordsTemp.size() > 0)
-		{
-			fseek(pfile, 0, SEEK_SET);
-
-			int faceIndex = 0;
-			while (fscanf(pfile, "%s", pLine) != EOF)
-			{
-
-				if (pLine[0] == 'f')
+				else
 				{
-					int v, t;
-					fscanf(pfile, "%s", pLine);
-					if (sscanf(pLine, "%d/%d", &v, &t) == 2)
-					{
-						std::map<int, int> v2tex;
-						v2tex[v - 1] = t - 1;
-
-						fscanf(pfile, "%s", pLine);
-						sscanf(pLine, "%d/%d", &v, &t);
-						v2tex[v - 1] = t - 1;
-
-						fscanf(pfile, "%s", pLine);
-						sscanf(pLine, "%d/%d", &v, &t);
-						v2tex[v - 1] = t - 1;
-
-						HE_edge* edgeTemp = pfaces_list_->at(faceIndex)->pedge_;
-						edgeTemp->texCoord_ = texCoordsTemp.at(v2tex[edgeTemp->pvert_->id_]);	
-						edgeTemp->pvert_->texCoord_ = edgeTemp->texCoord_;
-						edgeTemp = edgeTemp->pnext_;
-						edgeTemp->texCoord_ = texCoordsTemp.at(v2tex[edgeTemp->pvert_->id_]);
-						edgeTemp->pvert_->texCoord_ = edgeTemp->texCoord_;
-						edgeTemp = edgeTemp->pnext_;
-						edgeTemp->texCoord_ = texCoordsTemp.at(v2tex[edgeTemp->pvert_->id_]);
-						edgeTemp->pvert_->texCoord_ = edgeTemp->texCoord_;
-						faceIndex++;
-					}
+					InsertOBJFace(corners, texCoords, normals);
 				}
 			}
 		}
+		for (size_t i=0; i<deferred.size(); i++)
+		{
+			InsertOBJFace(deferred[i], texCoords, normals);
+		}
 
 		//cout << vertex_list->size() << " vertex, " << faces_list->size() << " faces " << endl;
 
+		has_file_texcoords_ = !texCoords.empty();
+		has_file_normals_ = !normals.empty();
 		UpdateMesh();
 		Unify(2.f);
 	}
@@ -360,6 +398,146 @@ bool Mesh3D::LoadFromOBJFile(const char* fins)
 	return isValid();
 }
 
+bool Mesh3D::LoadFromPLYFile(const char* fins)
+{
+	MeshStreamReader reader;
+	if (!reader.Open(fins))
+	{
+		return false;
+	}
+
+	try
+	{
+		ClearData();
+
+		// the corners only have a vertex, the faces naming later vertices are kept for the end
+		std::vector<Vec3f> none;
+		std::vector<std::vector<int> > deferred;
+		std::vector<int> corners;
+		std::vector<int> face;
+		Vec3f v;
+		MeshStreamRecord record;
+		while ((record = reader.Next(v, face)) != MS_END)
+		{
+			if (record == MS_VERTEX)
+			{
+				InsertVertex(v);
+				continue;
+			}
+			bool later = false;
+			corners.clear();
+			for (size_t i=0; i<face.size(); i++)
+			{
+				corners.push_back(face[i]);
+				corners.push_back(-1);
+				corners.push_back(-1);
+				later = later || face[i] >= num_of_vertex_list();
+			}
+			if (later)
+			{
+				deferred.push_back(corners);
+			}
+			else
+			{
+				InsertOBJFace(corners, none, none);
+			}
+		}
+		for (size_t i=0; i<deferred.size(); i++)
+		{
+			InsertOBJFace(deferred[i], none, none);
+		}
+
+		UpdateMesh();
+		Unify(2.f);
+	}
+	catch (...)
+	{
+		ClearData();
+		xmax_ = ymax_ = zmax_ = 1.f;
+		xmin_ = ymin_ = zmin_ = -1.f;
+		return false;
+	}
+
+	return isValid();
+}
+
+void Mesh3D::InsertOBJFace(const std::vector<int>& corners,
+	const std::vector<Vec3f>& texCoords, const std::vector<Vec3f>& normals)
+{
+	// drop the invalid and repeated vertices
+	std::vector<HE_vert* > s_faceid;
+	std::vector<int> s_corner;
+	for (size_t i=0; i+2<corners.size(); i+=3)
+	{
+		HE_vert* hv = get_vertex(corners[i]);
+		bool findit = false;
+		for (int j = 0; j <(int) s_faceid.size(); j++)
+		{
+			if (hv == s_faceid[j])
+			{
+				findit = true;
+				break;
+			}
+		}
+		if (findit == false && hv != NULL)
+		{
+			s_faceid.push_back(hv);
+			s_corner.push_back((int)i);
+		}
+	}
+	int n = (int)s_faceid.size();
+	if (n < 3)
+	{
+		return;
+	}
+
+	std::vector<int> triangles;
+	if (triangulate_on_load_ && n > 3)
+	{
+		std::vector<Vec3f> polygon(n);
+		for (int i=0; i<n; i++)
+		{
+			polygon[i] = s_faceid[i]->position();
+		}
+		TriangulatePolygon(polygon, triangles);
+	}
+	else
+	{
+		for (int i=0; i<n; i++)
+		{
+			triangles.push_back(i);
+		}
+	}
+
+	int size = triangles.size() == (size_t)n ? n : 3;
+	for (size_t t=0; t<triangles.size(); t+=size)
+	{
+		std::vector<HE_vert* > face(size);
+		for (int k=0; k<size; k++)
+		{
+			face[k] = s_faceid[triangles[t+k]];
+		}
+		HE_face* pface = InsertFace(face);
+
+		// the first half-edge of the face ends at its second corner
+		HE_edge* edgeTemp = pface->pedge_;
+		for (int k=0; k<size; k++)
+		{
+			const int* corner = &corners[s_corner[triangles[t+(k+1)%size]]];
+			if (corner[1] >= 0 && corner[1] < (int)texCoords.size())
+			{
+				edgeTemp->texCoord_ = texCoords[corner[1]];
+				edgeTemp->pvert_->texCoord_ = edgeTemp->texCoord_;
+			}
+			if (corner[2] >= 0 && corner[2] < (int)normals.size())
+			{
+				edgeTemp->normal_ = normals[corner[2]];
+			}
+			edgeTemp = edgeTemp->pnext_;
+		}
+	}
+}
+
 void Mesh3D::WriteToOBJFile(const char* fouts)
 {
 	std::ofstream fout(fouts);
@@ -407,6 +585,7 @@ void Mesh3D::UpdateMesh(void)
 		std::cout << "Invalid" << "\n";
 		return;
 	}
+	topology_version_++;
 	SetBoundaryFlag();
 	BoundaryCheck();
 	UpdateNormal();
@@ -452,6 +631,7 @@ void Mesh3D::UpdateNormal(void)
 {
 	ComputeFaceslistNormal();
 	ComputeVertexlistNormal();
+	MarkGeometryChanged();
 }
 
 void Mesh3D::ComputeFaceslistNormal(void)
@@ -600,6 +780,8 @@ void Mesh3D::Unify(float size)
 	{
 		pvertices_list_->at(i)->position_ = (pvertices_list_->at(i)->position_ - centerPos) * scaleV;
 	}
+	ComputeBoundingBox();
+	MarkGeometryChanged();
 }
 
 void Mesh3D::ComputeAvarageEdgeLength(void)
@@ -609,18 +791,207 @@ void Mesh3D::ComputeAvarageEdgeLength(void)
 		average_edge_length_ = 0.f;
 		return;
 	}
+	const std::vector<HE_edge*>& edges = get_unique_edges();
 	float aveEdgeLength = 0.f;
-	for (int i=0; i<num_of_half_edges_list(); i++)
+	for (size_t i=0; i<edges.size(); i++)
 	{
-		HE_edge* edge = get_edges_list()->at(i);
-		HE_vert* v0 = edge->pvert_;
-		HE_vert* v1 = edge->ppair_->pvert_;
+		HE_vert* v0 = edges[i]->pvert_;
+		HE_vert* v1 = edges[i]->ppair_->pvert_;
 		aveEdgeLength += (v0->position() - v1->position()).length();
 	}
-	average_edge_length_ = aveEdgeLength/num_of_half_edges_list();
+	average_edge_length_ = aveEdgeLength/edges.size();
 	//std::cout << "Average_edge_length = " << average_edge_length_ << "\n";
 }
 
+bool Mesh3D::UpdateTexCoords(void)
+{
+	if (!texcoords_dirty_ && texcoords_topology_version_ == topology_version_
+		&& texcoords_geometry_version_ == geometry_version_)
+	{
+		return false;
+	}
+
+	int n = num_of_vertex_list();
+	TexMapping mapping = tex_mapping_;
+	if (mapping == TEX_FROM_FILE && !has_file_texcoords_)
+	{
+		mapping = TEX_SPHERICAL;
+	}
+
+	if (mapping == TEX_FROM_FILE)
+	{
+		// the corners keep what the file said, a vertex takes the value of one of its corners
+		for (int i = 0; i < num_of_half_edges_list(); i++)
+		{
+			HE_edge *edge = (*pedges_list_)[i];
+			if (edge->pface_ != NULL)
+			{
+				edge->pvert_->texCoord_ = edge->texCoord_;
+			}
+		}
+	}
+	else if (n > 0)
+	{
+		// structure of arrays, so the loops below have no dependencies and vectorize
+		std::vector<float> coord(5 * n);
+		float *x = &coord[0], *y = x + n, *z = y + n, *u = z + n, *v = u + n;
+		float lo[3], hi[3];
+		lo[0] = lo[1] = lo[2] = FLT_MAX;
+		hi[0] = hi[1] = hi[2] = -FLT_MAX;
+		for (int i = 0; i < n; i++)
+		{
+			const Vec3f& p = (*pvertices_list_)[i]->position_;
+			x[i] = p[0];
+			y[i] = p[1];
+			z[i] = p[2];
+			for (int k = 0; k < 3; k++)
+			{
+				lo[k] = p[k] < lo[k] ? p[k] : lo[k];
+				hi[k] = p[k] > hi[k] ? p[k] : hi[k];
+			}
+		}
+
+		// order the axes by the extent of the bounding box, the longest first
+		int axis[3] = {0, 1, 2};
+		for (int a = 0; a < 2; a++)
+		{
+			for (int b = a + 1; b < 3; b++)
+			{
+				if (hi[axis[b]] - lo[axis[b]] > hi[axis[a]] - lo[axis[a]])
+				{
+					SWAP(axis[a], axis[b], int);
+				}
+			}
+		}
+		float *c[3] = {x, y, z};
+		float *s = c[axis[0]], *t = c[axis[1]], *w = c[axis[2]];
+		float s0 = (lo[axis[0]] + hi[axis[0]]) * 0.5f, t0 = (lo[axis[1]] + hi[axis[1]]) * 0.5f;
+		float w0 = (lo[axis[2]] + hi[axis[2]]) * 0.5f;
+		float extent = hi[axis[0]] - lo[axis[0]];
+		float inv_extent = extent > 0.f ? 1.f / extent : 0.f;
+		const float inv_pi = 0.318309886f;
+
+		switch (mapping)
+		{
+		case TEX_SPHERICAL:
+			for (int i = 0; i < n; i++)
+			{
+				float ds = s[i] - s0, dt = t[i] - t0, dw = w[i] - w0;
+				float r = sqrt(ds * ds + dt * dt + dw * dw);
+				float cosine = r > 0.f ? ds / r : 1.f;
+				cosine = cosine > 1.f ? 1.f : (cosine < -1.f ? -1.f : cosine);
+				u[i] = atan2(dw, dt) * (0.5f * inv_pi) + 0.5f;
+				v[i] = acos(cosine) * inv_pi;
+			}
+			break;
+		case TEX_CYLINDRICAL:
+			for (int i = 0; i < n; i++)
+			{
+				u[i] = atan2(w[i] - w0, t[i] - t0) * (0.5f * inv_pi) + 0.5f;
+				v[i] = (s[i] - lo[axis[0]]) * inv_extent;
+			}
+			break;
+		default:
+			for (int i = 0; i < n; i++)
+			{
+				u[i] = (s[i] - lo[axis[0]]) * inv_extent;
+				v[i] = (t[i] - lo[axis[1]]) * inv_extent;
+			}
+			break;
+		}
+
+		for (int i = 0; i < n; i++)
+		{
+			Vec3f& tex = (*pvertices_list_)[i]->texCoord_;
+			tex[0] = u[i];
+			tex[1] = v[i];
+			tex[2] = 0.f;
+		}
+	}
+
+	MarkGeometryChanged();
+	texcoords_dirty_ = false;
+	texcoords_topology_version_ = topology_version_;
+	texcoords_geometry_version_ = geometry_version_;
+	return true;
+}
+
+const std::vector<HE_edge*>& Mesh3D::get_unique_edges(void)
+{
+	if (unique_edges_version_ != topology_version_)
+	{
+		BuildUniqueEdges();
+		unique_edges_version_ = topology_version_;
+	}
+	return unique_edges_;
+}
+
+void Mesh3D::BuildUniqueEdges(void)
+{
+	unique_edges_.clear();
+	int num_half_edges = num_of_half_edges_list();
+	if (num_half_edges == 0)
+	{
+		return;
+	}
+	const std::vector<HE_edge*>& edges = *pedges_list_;
+
+	// small meshes are not worth the threads
+	int num_threads = static_cast<int>(std::thread::hardware_concurrency());
+	if (num_threads <= 0 || num_half_edges < (1 << 16))
+	{
+		num_threads = 1;
+	}
+	int chunk = (num_half_edges + num_threads - 1) / num_threads;
+
+	// count the edges owned by each chunk of half-edges, then each chunk fills its slice
+	std::vector<int> offsets(num_threads + 1, 0);
+	std::vector<std::thread> workers;
+	for (int t = 0; t < num_threads; t++)
+	{
+		workers.push_back(std::thread([&, t]()
+		{
+			int end = (t + 1) * chunk < num_half_edges ? (t + 1) * chunk : num_half_edges;
+			int count = 0;
+			for (int i = t * chunk; i < end; i++)
+			{
+				count += edges[i]->id_ < edges[i]->ppair_->id_;
+			}
+			offsets[t + 1] = count;
+		}));
+	}
+	for (size_t t = 0; t < workers.size(); t++)
+	{
+		workers[t].join();
+	}
+	for (int t = 0; t < num_threads; t++)
+	{
+		offsets[t + 1] += offsets[t];
+	}
+
+	unique_edges_.resize(offsets[num_threads]);
+	workers.clear();
+	for (int t = 0; t < num_threads; t++)
+	{
+		workers.push_back(std::thread([&, t]()
+		{
+			int end = (t + 1) * chunk < num_half_edges ? (t + 1) * chunk : num_half_edges;
+			HE_edge **out = unique_edges_.empty() ? NULL : &unique_edges_[0] + offsets[t];
+			for (int i = t * chunk; i < end; i++)
+			{
+				if (edges[i]->id_ < edges[i]->ppair_->id_)
+				{
+					*out++ = edges[i];
+				}
+			}
+		}));
+	}
+	for (size_t t = 0; t < workers.size(); t++)
+	{
+		workers[t].join();
+	}
+}
+
 HE_face* Mesh3D::get_face(int vId0, int vId1, int vId2)
 {
 	HE_vert *v0 = get_vertex(vId0);
@@ -846,6 +1217,72 @@ void Mesh3D::CreateMesh(const std::vector<double>& verts, const std::vector<unsi
 	UpdateMesh();
 }
 
+size_t Mesh3D::EstimateMemoryUsage(void)
+{
+	size_t bytes = sizeof(Mesh3D);
+	int nv = num_of_vertex_list();
+	int ne = num_of_half_edges_list();
+	int nf = num_of_face_list();
+
+	bytes += static_cast<size_t>(nv) * (sizeof(HE_vert) + sizeof(HE_vert*));
+	bytes += static_cast<size_t>(ne) * (sizeof(HE_edge) + sizeof(HE_edge*));
+	bytes += static_cast<size_t>(nf) * (sizeof(HE_face) + sizeof(HE_face*));
+
+	// one red-black tree node per half-edge in edgemap_, and one neighbor id per half-edge
+	bytes += edgemap_.size() * (sizeof(std::pair<PAIR_VERTEX, HE_edge*>) + 4 * sizeof(void*));
+	bytes += static_cast<size_t>(ne) * sizeof(size_t);
+	return bytes;
+}
+
+bool Mesh3D::ReorderVertices(const std::vector<int>& order)
+{
+	if (!IsPermutation(order, num_of_vertex_list()))
+	{
+		return false;
+	}
+	std::vector<HE_vert*> verts(order.size());
+	for (size_t i = 0; i != order.size(); i++)
+	{
+		verts[i] = pvertices_list_->at(order[i]);
+		verts[i]->id_ = static_cast<int>(i);
+	}
+	pvertices_list_->swap(verts);
+
+	// the neighbor lists hold ids, they are renamed in place
+	std::vector<size_t> new_id(order.size());
+	for (size_t i = 0; i != order.size(); i++)
+	{
+		new_id[order[i]] = i;
+	}
+	for (size_t i = 0; i != verts.size(); i++)
+	{
+		std::vector<size_t>& neighbors = (*pvertices_list_)[i]->neighborIdx;
+		for (size_t k = 0; k != neighbors.size(); k++)
+		{
+			neighbors[k] = new_id[neighbors[k]];
+		}
+	}
+	topology_version_++;
+	return true;
+}
+
+bool Mesh3D::ReorderFaces(const std::vector<int>& order)
+{
+	if (!IsPermutation(order, num_of_face_list()))
+	{
+		return false;
+	}
+	std::vector<HE_face*> faces(order.size());
+	for (size_t i = 0; i != order.size(); i++)
+	{
+		faces[i] = pfaces_list_->at(order[i]);
+		faces[i]->id_ = static_cast<int>(i);
+	}
+	pfaces_list_->swap(faces);
+	topology_version_++;
+	return true;
+}
+
 int Mesh3D::GetBoundaryVrtSize()
 {
 	int count = 0;
@@ -2,6 +2,7 @@
 
 #include <vector>
 #include <map>
+#include <climits>
 #include "Vec.h"
 
 
@@ -31,6 +32,15 @@ enum BoundaryTag
 	TO_SPLIT
 };
 
+//! how Mesh3D::UpdateTexCoords fills the texture coordinates of the vertices
+enum TexMapping
+{
+	TEX_FROM_FILE = 0,	//!< the coordinates read from the file, spherical if it had none
+	TEX_SPHERICAL,		//!< longitude and latitude around the center of the bounding box
+	TEX_PLANAR,			//!< projection on the plane of the two longest sides of the bounding box
+	TEX_CYLINDRICAL		//!< angle around and height along the longest side of the bounding box
+};
+
 /*!
 *	The basic vertex class for half-edge structure.
 */
@@ -91,6 +101,7 @@ public:
 	HE_edge		*pnext_;		//!< next half-edge around the face
 	HE_edge		*pprev_;		//!< prev half-edge around the face
 	Vec3f		texCoord_;		//!< texture coordinate of the end vertex
+	Vec3f		normal_;		//!< normal of the end vertex in this face, as read from the file
 	BoundaryTag boundary_flag_;	//!< boundary flag
 
 public:
@@ -144,28 +155,31 @@ public:
 	/*-----------add by wang kang at 2013-10-13-------------*/
 	void face_verts(std::vector<HE_vert *>& verts)
 	{
-		verts.resize(3);
+		verts.clear();
 
 		HE_edge* pedge = pedge_;
-		verts[0] = pedge->pvert_;
-		pedge = pedge->pnext_;
-		verts[1] = pedge->pvert_;
-		pedge = pedge->pnext_;
-		verts[2] = pedge->pvert_;
+		do 
+		{
+			verts.push_back(pedge->pvert_);
+			pedge = pedge->pnext_;
+
+		} while (pedge != pedge_);
 	}
 	point center() 
 	{
 		point center;
 		HE_edge* pedge = pedge_;
+		int count = 0;
 
 		do 
 		{
 			center += pedge->pvert_->position();
 			pedge = pedge->pnext_;
+			count++;
 
 		} while (pedge != pedge_);
 
-		center /= 3.0;
+		center /= static_cast<float>(count);
 		return center;		
 	}
 public:
@@ -204,6 +218,26 @@ private:
 	//! values for the bounding box
 	float xmax_, xmin_, ymax_, ymin_, zmax_, zmin_;
 
+	//! split polygons into triangles when loading a file
+	bool	triangulate_on_load_;
+
+	// change tracking, for the renderers and caches built from the mesh
+	unsigned int	topology_version_;			//!< bumped when the connectivity changes
+	unsigned int	geometry_version_;			//!< bumped when positions or normals change
+	int				dirty_first_, dirty_last_;	//!< vertices changed since the last TakeDirtyRange
+
+	// texture coordinates, see UpdateTexCoords
+	TexMapping		tex_mapping_;
+	bool			has_file_texcoords_;		//!< the loaded file had texture coordinates
+	bool			has_file_normals_;			//!< the loaded file had normals, kept on the half-edges
+	bool			texcoords_dirty_;			//!< the mapping changed since the last update
+	unsigned int	texcoords_topology_version_;
+	unsigned int	texcoords_geometry_version_;
+
+	//! one half-edge of each pair, see get_unique_edges
+	std::vector<HE_edge* >	unique_edges_;
+	unsigned int			unique_edges_version_;	//!< topology version unique_edges_ was built for
+
 public:
 	//! constructor
 	Mesh3D(void);
@@ -229,6 +263,13 @@ public:
 	//! get the total number of edges
 	inline int num_of_edge_list(void) {return num_of_half_edges_list()/2;}
 
+	//! get the undirected edges, one half-edge of each pair
+	/*!
+	*	the half-edge with the smaller id represents the edge; the list is cached and
+	*	rebuilt when the topology version changes
+	*/
+	const std::vector<HE_edge* >& get_unique_edges(void);
+
 	//! get the total number of faces
 	inline int num_of_face_list(void) {return pfaces_list_ ? static_cast<int>(pfaces_list_->size()) : 0;}
 
@@ -294,7 +335,19 @@ public:
 
 	// FILE IO
 	//! load a 3D mesh from an OBJ format file
+	/*!
+	*	The file is read in one pass. Polygons are triangulated unless set_triangulate_on_load(false),
+	*	and the texture coordinates and normals of the corners are stored on the half-edges.
+	*/
 	bool LoadFromOBJFile(const char* fins);
+	//! whether LoadFromOBJFile splits the polygons into triangles, true by default
+	void set_triangulate_on_load(bool b) {triangulate_on_load_ = b;}
+	bool triangulate_on_load(void) const {return triangulate_on_load_;}
+	//! load a 3D mesh from an ascii or binary PLY file, its vertex positions and faces
+	/*!
+	*	The polygons are triangulated as in LoadFromOBJFile; the other properties are skipped.
+	*/
+	bool LoadFromPLYFile(const char* fins);
 	//! export the current mesh to an OBJ format file
 	void WriteToOBJFile(const char* fouts);
 
@@ -312,6 +365,9 @@ public:
 
 	//! compute the bounding box
 	void ComputeBoundingBox(void);
+	//! corners of the box found by the last ComputeBoundingBox
+	Vec3f bounding_box_min(void) const {return Vec3f(xmin_, ymin_, zmin_);}
+	Vec3f bounding_box_max(void) const {return Vec3f(xmax_, ymax_, zmax_);}
 
 	//! get the face with id0, id1, id2 vertices
 	HE_face* get_face(int vId0, int vId1, int vId2);
@@ -338,6 +394,68 @@ public:
 
 	int GetBoundaryVrtSize();
 
+	//! estimate the heap memory held by the half-edge structure, in bytes
+	size_t EstimateMemoryUsage(void);
+
+	//! put the vertices in a new order, vertex i of the new list is the old vertex order[i]
+	/*!
+	*	the ids follow the new order; the topology version is bumped
+	*	\return false if order is not a permutation of the vertex ids, the mesh is unchanged
+	*/
+	bool ReorderVertices(const std::vector<int>& order);
+	//! put the faces in a new order, face i of the new list is the old face order[i]
+	bool ReorderFaces(const std::vector<int>& order);
+
+	//! version of the connectivity, bumped by ClearData and UpdateMesh
+	unsigned int topology_version(void) const {return topology_version_;}
+	//! version of the vertex attributes, bumped by MarkGeometryChanged
+	unsigned int geometry_version(void) const {return geometry_version_;}
+	//! report that the attributes of the vertices [first, last) changed
+	/*!
+	*	call it after moving vertices or editing their normals, texture coordinates or colors
+	*/
+	void MarkGeometryChanged(int first = 0, int last = INT_MAX)
+	{
+		last = last < num_of_vertex_list() ? last : num_of_vertex_list();
+		if (first >= last)
+		{
+			return;
+		}
+		dirty_first_ = first < dirty_first_ ? first : dirty_first_;
+		dirty_last_ = last > dirty_last_ ? last : dirty_last_;
+		geometry_version_++;
+	}
+	//! choose how the texture coordinates are generated, applied by the next UpdateTexCoords
+	void set_tex_mapping(TexMapping mapping)
+	{
+		texcoords_dirty_ = texcoords_dirty_ || mapping != tex_mapping_;
+		tex_mapping_ = mapping;
+	}
+	TexMapping tex_mapping(void) const {return tex_mapping_;}
+	bool has_file_texcoords(void) const {return has_file_texcoords_;}
+	bool has_file_normals(void) const {return has_file_normals_;}
+
+	//! fill the texture coordinates of the vertices with the chosen mapping
+	/*!
+	*	nothing is done unless the mapping, the geometry or the topology changed since the
+	*	last call, so it is cheap to call before every draw
+	*	\return true if the coordinates were recomputed
+	*/
+	bool UpdateTexCoords(void);
+
+	//! get and reset the range of vertices changed since the last call
+	/*!
+	*	\return false if no vertex changed
+	*/
+	bool TakeDirtyRange(int& first, int& last)
+	{
+		first = dirty_first_;
+		last = dirty_last_;
+		dirty_first_ = INT_MAX;
+		dirty_last_ = 0;
+		return first < last;
+	}
+
 
 public:
 	//! clear all the data
@@ -350,6 +468,13 @@ private:
 	//! clear faces
 	void ClearFaces(void);
 
+	//! insert a face read from an OBJ or PLY file, triangulated if requested
+	/*!
+	*	\param corners vertex, texture coordinate and normal index of each corner, -1 if absent
+	*/
+	void InsertOBJFace(const std::vector<int>& corners,
+		const std::vector<Vec3f>& texcoords, const std::vector<Vec3f>& normals);
+
 	//normal computation
 
 	//! compute all the normals of faces
@@ -369,6 +494,9 @@ private:
 	//! compute the average edge length
 	void ComputeAvarageEdgeLength(void);
 
+	//! collect the half-edges representing each edge into unique_edges_
+	void BuildUniqueEdges(void);
+
 	//! set vertex and edge boundary flag
 	void SetBoundaryFlag(void);
 
@@ -407,24 +535,14 @@ private:
 public:
 	void LinearTex()
 	{
-		for (size_t i=0; i != num_of_vertex_list(); ++i)
-			pvertices_list_->at(i)->texCoord_ = pvertices_list_->at(i);
+		set_tex_mapping(TEX_PLANAR);
+		UpdateTexCoords();
 	}
 
 	void SphereTex()
 	{
-		static const float pi = 3.1415926;
-		for (size_t i=0; i != num_of_vertex_list(); ++i)
-		{
-			register HE_vert * vert = pvertices_list_->at(i);
-			point p = vert->position().length()*vert->normal();
-
-
-			float r = sqrt(p[1]*p[1]+p[0]*p[0]);
-
-			vert->texCoord_[0] = asin(p[2])/pi + 0.5;
-			vert->texCoord_[1] = acos(p[0])/(2*pi);
-		}
+		set_tex_mapping(TEX_SPHERICAL);
+		UpdateTexCoords();
 	}
 	/*---------------------------------------------------------*/
 
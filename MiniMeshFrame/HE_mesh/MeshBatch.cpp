@@ -0,0 +1,352 @@
+#include "MeshBatch.h"
+#include "Mesh3D.h"
+
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <dirent.h>
+#endif
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	double SecondsSince(const Clock::time_point& start)
+	{
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	size_t FileSize(const std::string& name)
+	{
+		struct stat st;
+		if (stat(name.c_str(), &st) != 0)
+		{
+			return 0;
+		}
+		return static_cast<size_t>(st.st_size);
+	}
+
+	bool HasObjExtension(const std::string& name)
+	{
+		if (name.size() < 4)
+		{
+			return false;
+		}
+		std::string ext = name.substr(name.size() - 4);
+		for (size_t i = 0; i != ext.size(); ++i)
+			ext[i] = static_cast<char>(tolower(ext[i]));
+		return ext == ".obj";
+	}
+}
+
+MemoryBudget::MemoryBudget(size_t budget)
+	: budget_(budget), in_use_(0), peak_(0)
+{
+}
+
+size_t MemoryBudget::Acquire(size_t bytes)
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	released_.wait(lock, [this, bytes] { return in_use_ == 0 || in_use_ + bytes <= budget_; });
+	in_use_ += bytes;
+	if (in_use_ > peak_)
+	{
+		peak_ = in_use_;
+	}
+	return bytes;
+}
+
+void MemoryBudget::Release(size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	in_use_ = bytes < in_use_ ? in_use_ - bytes : 0;
+	released_.notify_all();
+}
+
+size_t MemoryBudget::Adjust(size_t reserved, size_t actual)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	in_use_ = reserved < in_use_ ? in_use_ - reserved : 0;
+	in_use_ += actual;
+	if (in_use_ > peak_)
+	{
+		peak_ = in_use_;
+	}
+	if (actual < reserved)
+	{
+		released_.notify_all();
+	}
+	return actual;
+}
+
+MeshBatchProcessor::MeshBatchProcessor(void)
+	: num_threads_(static_cast<int>(std::thread::hardware_concurrency()))
+	, queue_capacity_(4), memory_budget_(static_cast<size_t>(2) << 30), next_file_(0)
+{
+	if (num_threads_ <= 0)
+	{
+		num_threads_ = 4;
+	}
+}
+
+MeshBatchProcessor::~MeshBatchProcessor(void)
+{
+}
+
+void MeshBatchProcessor::AddFile(const std::string& input, const std::string& output)
+{
+	MeshBatchFileStats stats;
+	stats.input_ = input;
+	stats.output_ = output;
+	file_stats_.push_back(stats);
+}
+
+int MeshBatchProcessor::AddDirectory(const std::string& in_dir, const std::string& out_dir)
+{
+	std::vector<std::string> names;
+#ifdef _WIN32
+	struct _finddata_t data;
+	intptr_t handle = _findfirst((in_dir + "/*.obj").c_str(), &data);
+	if (handle != -1)
+	{
+		do
+		{
+			if (!(data.attrib & _A_SUBDIR))
+				names.push_back(data.name);
+		} while (_findnext(handle, &data) == 0);
+		_findclose(handle);
+	}
+#else
+	DIR *pdir = opendir(in_dir.c_str());
+	if (pdir != NULL)
+	{
+		struct dirent *entry;
+		while ((entry = readdir(pdir)) != NULL)
+		{
+			if (HasObjExtension(entry->d_name))
+				names.push_back(entry->d_name);
+		}
+		closedir(pdir);
+	}
+#endif
+
+	for (size_t i = 0; i != names.size(); ++i)
+	{
+		AddFile(in_dir + "/" + names[i], out_dir.empty() ? std::string() : out_dir + "/" + names[i]);
+	}
+	return static_cast<int>(names.size());
+}
+
+size_t MeshBatchProcessor::EstimateFromFileSize(size_t file_bytes)
+{
+	// an obj line costs about 30 bytes per vertex and per face, while the half-edge structure
+	// (vertex, six half-edges, two faces and the edge map nodes) needs roughly 1KB per vertex
+	return file_bytes * 16;
+}
+
+const MeshBatchSummary& MeshBatchProcessor::Run(void)
+{
+	summary_ = MeshBatchSummary();
+	next_file_ = 0;
+
+	int nthreads = num_threads_ < 3 ? 3 : num_threads_;
+	int nread = nthreads / 4 > 0 ? nthreads / 4 : 1;
+	int nwrite = nthreads / 4 > 0 ? nthreads / 4 : 1;
+	int nprocess = nthreads - nread - nwrite;
+
+	MemoryBudget budget(memory_budget_);
+	BoundedQueue<Job> loaded(queue_capacity_);
+	BoundedQueue<Job> processed(queue_capacity_);
+
+	Clock::time_point start = Clock::now();
+
+	std::vector<std::thread> readers, processors, writers;
+	for (int i = 0; i < nread; i++)
+		readers.push_back(std::thread(&MeshBatchProcessor::ReadStage, this, std::ref(budget), std::ref(loaded)));
+	for (int i = 0; i < nprocess; i++)
+		processors.push_back(std::thread(&MeshBatchProcessor::ProcessStage, this, std::ref(loaded), std::ref(processed)));
+	for (int i = 0; i < nwrite; i++)
+		writers.push_back(std::thread(&MeshBatchProcessor::WriteStage, this, std::ref(budget), std::ref(processed)));
+
+	// each stage closes its output once all of its threads are done
+	for (size_t i = 0; i != readers.size(); ++i)
+		readers[i].join();
+	loaded.Close();
+	for (size_t i = 0; i != processors.size(); ++i)
+		processors[i].join();
+	processed.Close();
+	for (size_t i = 0; i != writers.size(); ++i)
+		writers[i].join();
+
+	summary_.wall_seconds_ = SecondsSince(start);
+	summary_.num_files_ = static_cast<int>(file_stats_.size());
+	for (size_t i = 0; i != file_stats_.size(); ++i)
+	{
+		const MeshBatchFileStats& stats = file_stats_[i];
+		if (!stats.success_)
+		{
+			summary_.num_failed_++;
+		}
+		summary_.input_bytes_ += stats.input_bytes_;
+		summary_.num_face_ += stats.num_face_;
+	}
+	if (summary_.wall_seconds_ > 0.0)
+	{
+		summary_.files_per_second_ = summary_.num_files_ / summary_.wall_seconds_;
+		summary_.faces_per_second_ = summary_.num_face_ / summary_.wall_seconds_;
+		summary_.megabytes_per_second_ = summary_.input_bytes_ / (1024.0 * 1024.0) / summary_.wall_seconds_;
+	}
+	summary_.peak_reserved_bytes_ = budget.peak();
+	return summary_;
+}
+
+void MeshBatchProcessor::ReadStage(MemoryBudget& budget, BoundedQueue<Job>& out)
+{
+	for (;;)
+	{
+		size_t index;
+		{
+			std::lock_guard<std::mutex> lock(next_mutex_);
+			if (next_file_ >= file_stats_.size())
+			{
+				return;
+			}
+			index = next_file_++;
+		}
+
+		// every thread writes only the stats of its own file
+		MeshBatchFileStats& stats = file_stats_[index];
+		stats.input_bytes_ = FileSize(stats.input_);
+		if (stats.input_bytes_ == 0)
+		{
+			stats.message_ = "cannot open file";
+			continue;
+		}
+
+		Clock::time_point start = Clock::now();
+		Job job;
+		job.index_ = static_cast<int>(index);
+		job.failed_ = false;
+		job.reserved_ = budget.Acquire(EstimateFromFileSize(stats.input_bytes_));
+		stats.wait_seconds_ = SecondsSince(start);
+
+		start = Clock::now();
+		job.pmesh_ = new Mesh3D;
+		// the readers load at the same time, the OBJ parser must keep its state local (no strtok)
+		bool loaded = job.pmesh_->LoadFromOBJFile(stats.input_.c_str());
+		stats.read_seconds_ = SecondsSince(start);
+
+		if (!loaded)
+		{
+			stats.message_ = "invalid mesh";
+			FinishJob(budget, job);
+			continue;
+		}
+		stats.num_vertex_ = job.pmesh_->num_of_vertex_list();
+		stats.num_face_ = job.pmesh_->num_of_face_list();
+		stats.mesh_bytes_ = job.pmesh_->EstimateMemoryUsage();
+		job.reserved_ = budget.Adjust(job.reserved_, stats.mesh_bytes_);
+
+		if (!out.Push(job))
+		{
+			FinishJob(budget, job);
+			return;
+		}
+	}
+}
+
+void MeshBatchProcessor::ProcessStage(BoundedQueue<Job>& in, BoundedQueue<Job>& out)
+{
+	Job job;
+	while (in.Pop(job))
+	{
+		MeshBatchFileStats& stats = file_stats_[job.index_];
+		if (process_)
+		{
+			Clock::time_point start = Clock::now();
+			bool ok = false;
+			try
+			{
+				ok = process_(job.pmesh_);
+			}
+			catch (...)
+			{
+				ok = false;
+			}
+			stats.process_seconds_ = SecondsSince(start);
+			if (!ok)
+			{
+				// the writer still has to free the mesh and its reservation
+				stats.message_ = "process failed";
+				job.failed_ = true;
+			}
+		}
+		if (!out.Push(job))
+		{
+			delete job.pmesh_;
+		}
+	}
+}
+
+void MeshBatchProcessor::WriteStage(MemoryBudget& budget, BoundedQueue<Job>& in)
+{
+	Job job;
+	while (in.Pop(job))
+	{
+		MeshBatchFileStats& stats = file_stats_[job.index_];
+		if (job.failed_)
+		{
+			FinishJob(budget, job);
+			continue;
+		}
+		if (!stats.output_.empty())
+		{
+			Clock::time_point start = Clock::now();
+			job.pmesh_->WriteToOBJFile(stats.output_.c_str());
+			stats.write_seconds_ = SecondsSince(start);
+		}
+		stats.success_ = true;
+		FinishJob(budget, job);
+	}
+}
+
+void MeshBatchProcessor::FinishJob(MemoryBudget& budget, Job& job)
+{
+	delete job.pmesh_;
+	job.pmesh_ = NULL;
+	budget.Release(job.reserved_);
+	job.reserved_ = 0;
+}
+
+bool MeshBatchProcessor::WriteReport(const char* fouts) const
+{
+	std::ofstream fout(fouts);
+	if (!fout)
+	{
+		return false;
+	}
+
+	fout << "input,output,success,message,input_bytes,mesh_bytes,vertices,faces,"
+		"wait_s,read_s,process_s,write_s,faces_per_s\n";
+	for (size_t i = 0; i != file_stats_.size(); ++i)
+	{
+		const MeshBatchFileStats& s = file_stats_[i];
+		double total = s.read_seconds_ + s.process_seconds_ + s.write_seconds_;
+		fout << s.input_ << "," << s.output_ << "," << (s.success_ ? 1 : 0) << "," << s.message_ << ","
+			<< s.input_bytes_ << "," << s.mesh_bytes_ << "," << s.num_vertex_ << "," << s.num_face_ << ","
+			<< s.wait_seconds_ << "," << s.read_seconds_ << "," << s.process_seconds_ << "," << s.write_seconds_ << ","
+			<< (total > 0.0 ? s.num_face_ / total : 0.0) << "\n";
+	}
+
+	fout << "# files " << summary_.num_files_ << ", failed " << summary_.num_failed_
+		<< ", wall " << summary_.wall_seconds_ << " s, " << summary_.files_per_second_ << " files/s, "
+		<< summary_.faces_per_second_ << " faces/s, " << summary_.megabytes_per_second_ << " MB/s, peak reserved "
+		<< summary_.peak_reserved_bytes_ << " bytes\n";
+	fout.close();
+	return true;
+}
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+class Mesh3D;
+
+/*!
+*	A blocking FIFO with a fixed capacity, used to connect the stages of the batch pipeline.
+*	Push blocks while the queue is full, Pop blocks while it is empty. After Close(), Push fails
+*	and Pop drains the remaining items before failing.
+*/
+template <class T>
+class BoundedQueue
+{
+public:
+	explicit BoundedQueue(size_t capacity)
+		: capacity_(capacity > 0 ? capacity : 1), closed_(false)
+	{}
+
+	bool Push(const T& item)
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		not_full_.wait(lock, [this] { return closed_ || items_.size() < capacity_; });
+		if (closed_)
+		{
+			return false;
+		}
+		items_.push_back(item);
+		not_empty_.notify_one();
+		return true;
+	}
+
+	bool Pop(T& item)
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		not_empty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+		if (items_.empty())
+		{
+			return false;
+		}
+		item = items_.front();
+		items_.pop_front();
+		not_full_.notify_one();
+		return true;
+	}
+
+	void Close()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		closed_ = true;
+		not_full_.notify_all();
+		not_empty_.notify_all();
+	}
+
+private:
+	size_t					capacity_;
+	bool					closed_;
+	std::deque<T>			items_;
+	std::mutex				mutex_;
+	std::condition_variable	not_full_;
+	std::condition_variable	not_empty_;
+};
+
+/*!
+*	A global byte budget shared by all the meshes in flight.
+*	Acquire blocks until the request fits; a request larger than the whole budget is
+*	admitted only when nothing else is reserved, so a huge mesh runs alone instead of deadlocking.
+*/
+class MemoryBudget
+{
+public:
+	explicit MemoryBudget(size_t budget);
+
+	//! block until bytes can be reserved, return the amount actually reserved
+	size_t Acquire(size_t bytes);
+	//! give back a reservation
+	void Release(size_t bytes);
+	//! replace a reservation by the measured size, never blocks
+	size_t Adjust(size_t reserved, size_t actual);
+
+	size_t budget(void) const {return budget_;}
+	size_t peak(void) const {return peak_;}
+
+private:
+	size_t					budget_;
+	size_t					in_use_;
+	size_t					peak_;
+	std::mutex				mutex_;
+	std::condition_variable	released_;
+};
+
+//! timing and size information of one file of the batch
+struct MeshBatchFileStats
+{
+	std::string	input_;
+	std::string	output_;
+	bool		success_;
+	std::string	message_;
+	size_t		input_bytes_;
+	size_t		mesh_bytes_;			//!< estimated memory of the loaded mesh
+	int			num_vertex_;
+	int			num_face_;
+	double		wait_seconds_;			//!< time spent waiting for the memory budget
+	double		read_seconds_;
+	double		process_seconds_;
+	double		write_seconds_;
+
+	MeshBatchFileStats()
+		: success_(false), input_bytes_(0), mesh_bytes_(0), num_vertex_(0), num_face_(0)
+		, wait_seconds_(0.0), read_seconds_(0.0), process_seconds_(0.0), write_seconds_(0.0)
+	{}
+};
+
+//! totals of a whole batch run
+struct MeshBatchSummary
+{
+	int		num_files_;
+	int		num_failed_;
+	double	wall_seconds_;
+	size_t	input_bytes_;
+	long long num_face_;
+	double	files_per_second_;
+	double	faces_per_second_;
+	double	megabytes_per_second_;
+	size_t	peak_reserved_bytes_;
+
+	MeshBatchSummary()
+		: num_files_(0), num_failed_(0), wall_seconds_(0.0), input_bytes_(0), num_face_(0)
+		, files_per_second_(0.0), faces_per_second_(0.0), megabytes_per_second_(0.0), peak_reserved_bytes_(0)
+	{}
+};
+
+/*!
+*	Batch driver for many mesh files.
+*	Files are pipelined through read, process and write stages that run on their own threads
+*	and are connected by bounded queues. Every loaded mesh holds a reservation on a global
+*	memory budget until it has been written, so a few huge meshes cannot exhaust the memory.
+*/
+class MeshBatchProcessor
+{
+public:
+	//! the processing stage, return false to mark the file as failed
+	typedef std::function<bool(Mesh3D*)> ProcessFunc;
+
+public:
+	MeshBatchProcessor(void);
+	~MeshBatchProcessor(void);
+
+	//! total number of worker threads, split among the three stages (at least one each)
+	void set_num_threads(int n) {num_threads_ = n;}
+	//! capacity of each queue between two stages
+	void set_queue_capacity(size_t n) {queue_capacity_ = n;}
+	//! upper bound of the memory held by meshes in flight, in bytes
+	void set_memory_budget(size_t bytes) {memory_budget_ = bytes;}
+	//! the operation applied to every mesh; with no function the meshes are only converted
+	void set_process(const ProcessFunc& func) {process_ = func;}
+
+	//! queue one file; an empty output name skips the write stage
+	void AddFile(const std::string& input, const std::string& output);
+	//! queue all the *.obj files of a directory, writing results with the same name into out_dir
+	/*!
+	*	\param out_dir output directory, empty to skip the write stage
+	*	\return the number of files found
+	*/
+	int AddDirectory(const std::string& in_dir, const std::string& out_dir);
+
+	//! run the pipeline over all the queued files, blocks until the batch is done
+	const MeshBatchSummary& Run(void);
+
+	const std::vector<MeshBatchFileStats>& file_stats(void) const {return file_stats_;}
+	const MeshBatchSummary& summary(void) const {return summary_;}
+
+	//! export the per-file statistics as csv
+	bool WriteReport(const char* fouts) const;
+
+private:
+	struct Job
+	{
+		int		index_;
+		Mesh3D	*pmesh_;
+		size_t	reserved_;
+		bool	failed_;
+	};
+
+	void ReadStage(MemoryBudget& budget, BoundedQueue<Job>& out);
+	void ProcessStage(BoundedQueue<Job>& in, BoundedQueue<Job>& out);
+	void WriteStage(MemoryBudget& budget, BoundedQueue<Job>& in);
+	void FinishJob(MemoryBudget& budget, Job& job);
+
+	//! guess the memory of the half-edge mesh from the size of its obj file
+	static size_t EstimateFromFileSize(size_t file_bytes);
+
+private:
+	int								num_threads_;
+	size_t							queue_capacity_;
+	size_t							memory_budget_;
+	ProcessFunc						process_;
+
+	std::vector<MeshBatchFileStats>	file_stats_;
+	MeshBatchSummary				summary_;
+
+	std::mutex						next_mutex_;
+	size_t							next_file_;
+};
@@ -0,0 +1,114 @@
+#include "MeshLOD.h"
+#include "StreamSimplifier.h"
+
+MeshLOD::MeshLOD(void)
+	: min_faces_(100000), mesh_(NULL), mesh_faces_(0), topology_version_(0), geometry_version_(0)
+{
+	fractions_.push_back(0.01f);
+	fractions_.push_back(0.1f);
+}
+
+MeshLOD::~MeshLOD(void)
+{
+	Clear();
+}
+
+void MeshLOD::Clear(void)
+{
+	for (size_t i = 0; i < proxies_.size(); i++)
+	{
+		delete proxies_[i];
+	}
+	proxies_.clear();
+	mesh_ = NULL;
+	mesh_faces_ = 0;
+}
+
+bool MeshLOD::isBuiltFor(const Mesh3D* mesh) const
+{
+	return mesh != NULL && mesh == mesh_ && mesh->topology_version() == topology_version_
+		&& mesh->geometry_version() == geometry_version_;
+}
+
+int MeshLOD::Build(Mesh3D* mesh)
+{
+	Clear();
+	if (mesh == NULL)
+	{
+		return 0;
+	}
+	mesh_ = mesh;
+	mesh_faces_ = mesh->num_of_face_list();
+	topology_version_ = mesh->topology_version();
+	geometry_version_ = mesh->geometry_version();
+	if (mesh_faces_ < min_faces_)
+	{
+		return 0;
+	}
+
+	std::vector<Vec3f> verts(mesh->num_of_vertex_list());
+	for (size_t i = 0; i < verts.size(); i++)
+	{
+		verts[i] = mesh->get_vertex(static_cast<int>(i))->position();
+	}
+	std::vector<int> triangles;
+	triangles.reserve(3 * mesh_faces_);
+	const std::vector<HE_face*>& faces = *(mesh->get_faces_list());
+	for (size_t i = 0; i < faces.size(); i++)
+	{
+		HE_edge *first = faces[i]->pedge_;
+		for (HE_edge *pedge = first->pnext_; pedge->pnext_ != first; pedge = pedge->pnext_)
+		{
+			triangles.push_back(first->pvert_->id_);
+			triangles.push_back(pedge->pvert_->id_);
+			triangles.push_back(pedge->pnext_->pvert_->id_);
+		}
+	}
+
+	StreamSimplifier simplifier;
+	for (size_t i = 0; i < fractions_.size(); i++)
+	{
+		simplifier.set_max_vertices(static_cast<int>(fractions_[i] * verts.size()));
+		if (!simplifier.Run(verts, triangles))
+		{
+			continue;
+		}
+		// a proxy must be cheaper to draw than the next level
+		int faces_below = static_cast<int>(simplifier.triangles().size() / 3);
+		int faces_above = proxies_.empty() ? 0 : proxies_.back()->num_of_face_list();
+		if (faces_below * 2 > mesh_faces_ || faces_below <= faces_above)
+		{
+			continue;
+		}
+		Mesh3D *proxy = new Mesh3D();
+		proxy->CreateMesh(simplifier.vertices(), simplifier.triangles());
+		if (!proxy->isValid())
+		{
+			delete proxy;
+			continue;
+		}
+		proxies_.push_back(proxy);
+	}
+	return static_cast<int>(proxies_.size());
+}
+
+int MeshLOD::SelectLevel(int drawn_level, double frame_ms, double target_ms) const
+{
+	int finest = num_levels() - 1;
+	if (drawn_level < 0 || drawn_level > finest || frame_ms <= 0.0)
+	{
+		return finest;
+	}
+	double ms_per_face = frame_ms / (num_faces(drawn_level) > 0 ? num_faces(drawn_level) : 1);
+
+	// refine only with some margin, so the level does not flicker around the budget
+	for (int i = finest; i > 0; i--)
+	{
+		double budget = i > drawn_level ? 0.7 * target_ms : target_ms;
+		if (num_faces(i) * ms_per_face <= budget)
+		{
+			return i;
+		}
+	}
+	return 0;
+}
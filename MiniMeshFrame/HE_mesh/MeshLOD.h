@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include "Mesh3D.h"
+
+/*!
+*	Simplified proxies of a mesh, drawn in its place while the view is being dragged.
+*	The proxies keep fixed fractions of the vertices of the mesh and are built by vertex
+*	clustering (StreamSimplifier), which takes a fraction of a second even for millions of
+*	faces. Level 0 is the coarsest proxy, the last level is the mesh itself.
+*/
+class MeshLOD
+{
+public:
+	MeshLOD(void);
+	~MeshLOD(void);
+
+	//! the fractions of the vertices kept by the proxies, in increasing order
+	void set_fractions(const std::vector<float>& fractions) {fractions_ = fractions;}
+	//! meshes with fewer faces get no proxy
+	void set_min_faces(int n) {min_faces_ = n;}
+
+	//! build the proxies of a mesh
+	/*!
+	*	\return the number of proxies built
+	*/
+	int Build(Mesh3D* mesh);
+	void Clear(void);
+
+	//! whether the proxies were built from the current state of the mesh
+	bool isBuiltFor(const Mesh3D* mesh) const;
+
+	//! the number of levels, the proxies and the mesh itself
+	int num_levels(void) const {return static_cast<int>(proxies_.size()) + 1;}
+	//! the mesh of a level, level num_levels()-1 is the mesh the proxies were built from
+	Mesh3D* level(int i) const {return i < static_cast<int>(proxies_.size()) ? proxies_[i] : mesh_;}
+	int num_faces(int i) const {return i < static_cast<int>(proxies_.size()) ? proxies_[i]->num_of_face_list() : mesh_faces_;}
+
+	//! choose the finest level that should be drawn within a time budget
+	/*!
+	*	the time per face is estimated from the last frame, which was drawn at drawn_level
+	*	\param frame_ms the time of that frame
+	*	\param target_ms the budget for the next one
+	*/
+	int SelectLevel(int drawn_level, double frame_ms, double target_ms) const;
+
+private:
+	std::vector<float>		fractions_;
+	int						min_faces_;
+
+	Mesh3D					*mesh_;				//!< not owned
+	int						mesh_faces_;
+	unsigned int			topology_version_;	//!< versions of mesh_ when the proxies were built
+	unsigned int			geometry_version_;
+	std::vector<Mesh3D*>	proxies_;
+};
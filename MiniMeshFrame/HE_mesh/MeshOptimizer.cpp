@@ -0,0 +1,380 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+
+namespace
+{
+	//! FIFO cache simulated with time stamps, a vertex is cached if it entered within the last size misses
+	class CacheSimulator
+	{
+	public:
+		CacheSimulator(int num_vertex, int size)
+			: size_(size), time_(size + 1), stamps_(num_vertex, 0)
+		{
+		}
+
+		//! \return true on a miss
+		bool Access(int v)
+		{
+			if (time_ - stamps_[v] <= size_)
+			{
+				return false;
+			}
+			stamps_[v] = time_++;
+			return true;
+		}
+
+		//! evict every vertex
+		void Flush(void) {time_ += size_ + 1;}
+
+	private:
+		int					size_;
+		int					time_;
+		std::vector<int>	stamps_;
+	};
+
+	struct Cluster
+	{
+		int		begin_, end_;		//!< range in the face order
+		float	key_;				//!< faces further out and facing outwards come first
+	};
+
+	bool CompareClusters(const Cluster& a, const Cluster& b)
+	{
+		return a.key_ > b.key_;
+	}
+}
+
+MeshOptimizer::MeshOptimizer(void)
+	: cache_size_(16), overdraw_threshold_(1.05f)
+	, acmr_before_(0.f), acmr_after_(0.f), atvr_before_(0.f), atvr_after_(0.f), num_clusters_(0)
+{
+}
+
+MeshOptimizer::~MeshOptimizer(void)
+{
+}
+
+void MeshOptimizer::MeasureCache(Mesh3D* mesh, int cache_size, float& acmr, float& atvr)
+{
+	acmr = atvr = 0.f;
+	if (mesh == NULL || mesh->num_of_face_list() == 0)
+	{
+		return;
+	}
+	const std::vector<HE_face*>& faces = *(mesh->get_faces_list());
+	CacheSimulator cache(mesh->num_of_vertex_list(), cache_size);
+	std::vector<bool> used(mesh->num_of_vertex_list(), false);
+	long long misses = 0, triangles = 0, vertices = 0;
+	for (size_t i = 0; i != faces.size(); i++)
+	{
+		HE_edge *first = faces[i]->pedge_;
+		HE_edge *pedge = first->pnext_;
+		while (pedge->pnext_ != first)
+		{
+			int tri[3] = {first->pvert_->id_, pedge->pvert_->id_, pedge->pnext_->pvert_->id_};
+			for (int k = 0; k < 3; k++)
+			{
+				misses += cache.Access(tri[k]);
+				if (!used[tri[k]])
+				{
+					used[tri[k]] = true;
+					vertices++;
+				}
+			}
+			triangles++;
+			pedge = pedge->pnext_;
+		}
+	}
+	acmr = triangles > 0 ? static_cast<float>(misses) / triangles : 0.f;
+	atvr = vertices > 0 ? static_cast<float>(misses) / vertices : 0.f;
+}
+
+bool MeshOptimizer::Optimize(Mesh3D* mesh)
+{
+	if (mesh == NULL || mesh->num_of_face_list() == 0)
+	{
+		return false;
+	}
+	MeasureCache(mesh, cache_size_, acmr_before_, atvr_before_);
+
+	BuildAdjacency(mesh);
+	std::vector<int> order, clusters;
+	OrderFaces(order, clusters);
+	SortClusters(mesh, order, clusters);
+
+	// vertices in the order the faces first use them, unused ones at the end
+	int num_vertex = mesh->num_of_vertex_list();
+	std::vector<int> vert_order;
+	std::vector<bool> placed(num_vertex, false);
+	vert_order.reserve(num_vertex);
+	for (size_t i = 0; i != order.size(); i++)
+	{
+		for (int c = face_begin_[order[i]]; c < face_begin_[order[i] + 1]; c++)
+		{
+			int v = face_corners_[c];
+			if (!placed[v])
+			{
+				placed[v] = true;
+				vert_order.push_back(v);
+			}
+		}
+	}
+	for (int v = 0; v < num_vertex; v++)
+	{
+		if (!placed[v])
+		{
+			vert_order.push_back(v);
+		}
+	}
+
+	mesh->ReorderFaces(order);
+	mesh->ReorderVertices(vert_order);
+	MeasureCache(mesh, cache_size_, acmr_after_, atvr_after_);
+
+	std::vector<int>().swap(face_begin_);
+	std::vector<int>().swap(face_corners_);
+	std::vector<int>().swap(vert_begin_);
+	std::vector<int>().swap(vert_faces_);
+	std::vector<int>().swap(live_);
+	std::vector<int>().swap(cache_time_);
+	std::vector<int>().swap(dead_ends_);
+	return true;
+}
+
+void MeshOptimizer::BuildAdjacency(Mesh3D* mesh)
+{
+	const std::vector<HE_face*>& faces = *(mesh->get_faces_list());
+	int num_vertex = mesh->num_of_vertex_list();
+
+	// corners in the order the triangle fans use them
+	face_begin_.assign(1, 0);
+	face_begin_.reserve(faces.size() + 1);
+	face_corners_.clear();
+	face_corners_.reserve(faces.size() * 3);
+	for (size_t i = 0; i != faces.size(); i++)
+	{
+		HE_edge *pedge = faces[i]->pedge_;
+		do
+		{
+			face_corners_.push_back(pedge->pvert_->id_);
+			pedge = pedge->pnext_;
+		} while (pedge != faces[i]->pedge_);
+		face_begin_.push_back(static_cast<int>(face_corners_.size()));
+	}
+
+	vert_begin_.assign(num_vertex + 1, 0);
+	for (size_t c = 0; c != face_corners_.size(); c++)
+	{
+		vert_begin_[face_corners_[c] + 1]++;
+	}
+	for (int v = 0; v < num_vertex; v++)
+	{
+		vert_begin_[v + 1] += vert_begin_[v];
+	}
+	live_.assign(vert_begin_.begin(), vert_begin_.end() - 1);
+	vert_faces_.resize(face_corners_.size());
+	for (size_t f = 0; f + 1 < face_begin_.size(); f++)
+	{
+		for (int c = face_begin_[f]; c < face_begin_[f + 1]; c++)
+		{
+			vert_faces_[live_[face_corners_[c]]++] = static_cast<int>(f);
+		}
+	}
+	for (int v = 0; v < num_vertex; v++)
+	{
+		live_[v] = vert_begin_[v + 1] - vert_begin_[v];
+	}
+	cache_time_.assign(num_vertex, 0);
+	dead_ends_.clear();
+}
+
+int MeshOptimizer::NextVertex(const std::vector<int>& candidates, int time, int& cursor, bool& jumped)
+{
+	// the candidate that stays in the cache while its remaining faces are emitted, oldest first
+	int best = -1, best_priority = -1;
+	for (size_t i = 0; i != candidates.size(); i++)
+	{
+		int v = candidates[i];
+		if (live_[v] > 0)
+		{
+			int priority = 0;
+			if (time - cache_time_[v] + 2 * live_[v] <= cache_size_)
+			{
+				priority = time - cache_time_[v];
+			}
+			if (priority > best_priority)
+			{
+				best_priority = priority;
+				best = v;
+			}
+		}
+	}
+	if (best >= 0)
+	{
+		jumped = false;
+		return best;
+	}
+
+	// dead end, go back to a recent vertex or scan for any vertex with faces left
+	jumped = true;
+	while (!dead_ends_.empty())
+	{
+		int v = dead_ends_.back();
+		dead_ends_.pop_back();
+		if (live_[v] > 0)
+		{
+			return v;
+		}
+	}
+	while (cursor < static_cast<int>(live_.size()))
+	{
+		if (live_[cursor] > 0)
+		{
+			return cursor;
+		}
+		cursor++;
+	}
+	return -1;
+}
+
+void MeshOptimizer::OrderFaces(std::vector<int>& order, std::vector<int>& clusters)
+{
+	int num_face = static_cast<int>(face_begin_.size()) - 1;
+	std::vector<bool> emitted(num_face, false);
+	std::vector<int> candidates;
+	order.clear();
+	order.reserve(num_face);
+	clusters.assign(1, 0);
+
+	int time = cache_size_ + 1;
+	int cursor = 0;
+	bool jumped = false;
+	int v = NextVertex(candidates, time, cursor, jumped);
+	while (v >= 0)
+	{
+		candidates.clear();
+		for (int i = vert_begin_[v]; i < vert_begin_[v + 1]; i++)
+		{
+			int f = vert_faces_[i];
+			if (emitted[f])
+			{
+				continue;
+			}
+			emitted[f] = true;
+			order.push_back(f);
+			for (int c = face_begin_[f]; c < face_begin_[f + 1]; c++)
+			{
+				int u = face_corners_[c];
+				dead_ends_.push_back(u);
+				candidates.push_back(u);
+				live_[u]--;
+				if (time - cache_time_[u] > cache_size_)
+				{
+					cache_time_[u] = time++;
+				}
+			}
+		}
+		v = NextVertex(candidates, time, cursor, jumped);
+		if (jumped && v >= 0 && static_cast<int>(order.size()) > clusters.back())
+		{
+			clusters.push_back(static_cast<int>(order.size()));
+		}
+	}
+}
+
+void MeshOptimizer::SortClusters(Mesh3D* mesh, std::vector<int>& order, std::vector<int>& clusters)
+{
+	const std::vector<HE_vert*>& verts = *(mesh->get_vertex_list());
+	clusters.push_back(static_cast<int>(order.size()));
+
+	// soft boundaries: cut a cluster where restarting the cache keeps its ACMR close to Tipsify's
+	CacheSimulator cache(mesh->num_of_vertex_list(), cache_size_);
+	std::vector<Cluster> pieces;
+	for (size_t h = 0; h + 1 < clusters.size(); h++)
+	{
+		int begin = clusters[h], end = clusters[h + 1];
+		long long misses = 0, triangles = 0;
+		cache.Flush();
+		for (int i = begin; i < end; i++)
+		{
+			int f = order[i];
+			for (int c = face_begin_[f]; c < face_begin_[f + 1]; c++)
+			{
+				misses += cache.Access(face_corners_[c]);
+			}
+			triangles += face_begin_[f + 1] - face_begin_[f] - 2;
+		}
+		float limit = overdraw_threshold_ * misses / (triangles > 0 ? triangles : 1);
+
+		Cluster piece;
+		piece.begin_ = begin;
+		misses = triangles = 0;
+		cache.Flush();
+		for (int i = begin; i < end; i++)
+		{
+			int f = order[i];
+			for (int c = face_begin_[f]; c < face_begin_[f + 1]; c++)
+			{
+				misses += cache.Access(face_corners_[c]);
+			}
+			triangles += face_begin_[f + 1] - face_begin_[f] - 2;
+			if (i + 1 == end || (triangles > 0 && misses <= limit * triangles))
+			{
+				piece.end_ = i + 1;
+				pieces.push_back(piece);
+				piece.begin_ = i + 1;
+				misses = triangles = 0;
+				cache.Flush();
+			}
+		}
+	}
+
+	// area weighted centroid and normal of each cluster, and of the whole mesh
+	std::vector<Vec3f> centroids(pieces.size()), normals(pieces.size());
+	Vec3f mesh_centroid;
+	float mesh_area = 0.f;
+	for (size_t p = 0; p != pieces.size(); p++)
+	{
+		Vec3f centroid, normal;
+		float area = 0.f;
+		for (int i = pieces[p].begin_; i < pieces[p].end_; i++)
+		{
+			int f = order[i];
+			const Vec3f& a = verts[face_corners_[face_begin_[f]]]->position_;
+			for (int c = face_begin_[f] + 1; c + 1 < face_begin_[f + 1]; c++)
+			{
+				const Vec3f& b = verts[face_corners_[c]]->position_;
+				const Vec3f& d = verts[face_corners_[c + 1]]->position_;
+				Vec3f n = (b - a) ^ (d - a);
+				float w = len(n);
+				normal += n;
+				centroid += (a + b + d) * (w / 3.f);
+				area += w;
+			}
+		}
+		mesh_centroid += centroid;
+		mesh_area += area;
+		centroids[p] = area > 0.f ? centroid / area : verts[face_corners_[face_begin_[order[pieces[p].begin_]]]]->position_;
+		normals[p] = normal;
+	}
+	if (mesh_area > 0.f)
+	{
+		mesh_centroid /= mesh_area;
+	}
+	for (size_t p = 0; p != pieces.size(); p++)
+	{
+		float l = len(normals[p]);
+		pieces[p].key_ = l > 0.f ? (centroids[p] - mesh_centroid).dot(normals[p]) / l : 0.f;
+	}
+	std::stable_sort(pieces.begin(), pieces.end(), CompareClusters);
+	num_clusters_ = static_cast<int>(pieces.size());
+
+	std::vector<int> sorted;
+	sorted.reserve(order.size());
+	for (size_t p = 0; p != pieces.size(); p++)
+	{
+		sorted.insert(sorted.end(), order.begin() + pieces[p].begin_, order.begin() + pieces[p].end_);
+	}
+	order.swap(sorted);
+}
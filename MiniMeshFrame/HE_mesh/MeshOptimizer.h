@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vector>
+#include "Mesh3D.h"
+
+/*!
+*	Reordering of the faces and the vertices of a mesh for drawing.
+*	The faces are ordered for the post-transform vertex cache with Tipsify (Sander, Nehab
+*	and Barczak 2007), which walks the faces around recently used vertices. The walk is cut
+*	into clusters wherever the cache can be restarted without raising the ACMR of the cluster
+*	above overdraw_threshold times its Tipsify value, and the clusters are sorted so that the
+*	ones facing away from the center of the mesh come first and hide the others. Last, the
+*	vertices are numbered in the order the faces first use them, so vertex fetches move
+*	forward through memory.
+*	The mesh itself is reordered, the saved files keep the order.
+*/
+class MeshOptimizer
+{
+public:
+	MeshOptimizer(void);
+	~MeshOptimizer(void);
+
+	//! the number of entries of the FIFO vertex cache optimized for
+	void set_cache_size(int n) {cache_size_ = n;}
+	int cache_size(void) const {return cache_size_;}
+	//! allowed ACMR increase for the overdraw clusters, 1 keeps the Tipsify order
+	void set_overdraw_threshold(float lambda) {overdraw_threshold_ = lambda;}
+
+	//! reorder the faces and the vertices of a mesh
+	/*!
+	*	\return false if the mesh has no face
+	*/
+	bool Optimize(Mesh3D* mesh);
+
+	//! average cache miss ratio, the transformed vertices per triangle
+	float acmr_before(void) const {return acmr_before_;}
+	float acmr_after(void) const {return acmr_after_;}
+	//! average transform to vertex ratio, 1 is the best possible
+	float atvr_before(void) const {return atvr_before_;}
+	float atvr_after(void) const {return atvr_after_;}
+	//! the number of clusters sorted for overdraw
+	int num_clusters(void) const {return num_clusters_;}
+
+	//! simulate a FIFO vertex cache on the triangle fans of the faces, as MeshRenderer draws them
+	static void MeasureCache(Mesh3D* mesh, int cache_size, float& acmr, float& atvr);
+
+private:
+	//! flatten the corners of the faces and the faces around each vertex
+	void BuildAdjacency(Mesh3D* mesh);
+	//! Tipsify, the face order and the hard cluster boundaries (where the walk jumped)
+	void OrderFaces(std::vector<int>& order, std::vector<int>& clusters);
+	//! split the clusters at soft boundaries and sort them for overdraw
+	void SortClusters(Mesh3D* mesh, std::vector<int>& order, std::vector<int>& clusters);
+	//! the next vertex of the walk, -1 when every face was emitted
+	int NextVertex(const std::vector<int>& candidates, int time, int& cursor, bool& jumped);
+
+private:
+	int					cache_size_;
+	float				overdraw_threshold_;
+
+	// face corners and vertex to face adjacency, compressed rows
+	std::vector<int>	face_begin_, face_corners_;
+	std::vector<int>	vert_begin_, vert_faces_;
+	std::vector<int>	live_;				//!< faces not emitted yet, per vertex
+	std::vector<int>	cache_time_;		//!< time stamp of the last cache entry, per vertex
+	std::vector<int>	dead_ends_;
+
+	float				acmr_before_, acmr_after_;
+	float				atvr_before_, atvr_after_;
+	int					num_clusters_;
+};
@@ -0,0 +1,512 @@
+#include "MeshStream.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+	const size_t kStreamChunk = 1 << 20;
+
+	inline const char* SkipSpace(const char* p)
+	{
+		while (*p == ' ' || *p == '\t' || *p == '\r')
+			++p;
+		return p;
+	}
+
+	//! decimal number parser, several times faster than strtod for the plain numbers of mesh files
+	double ParseNumber(const char* p, const char** endp)
+	{
+		static const double kPow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+			1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+		const char *start = p = SkipSpace(p);
+		bool negative = false;
+		if (*p == '-' || *p == '+')
+		{
+			negative = *p == '-';
+			++p;
+		}
+		unsigned long long mantissa = 0;
+		int exponent = 0, digits = 0;
+		for (; *p >= '0' && *p <= '9'; ++p, ++digits)
+		{
+			if (mantissa < 100000000000000000ULL)
+				mantissa = mantissa * 10 + (*p - '0');
+			else
+				exponent++;
+		}
+		if (*p == '.')
+		{
+			for (++p; *p >= '0' && *p <= '9'; ++p, ++digits)
+			{
+				if (mantissa < 100000000000000000ULL)
+				{
+					mantissa = mantissa * 10 + (*p - '0');
+					exponent--;
+				}
+			}
+		}
+		if (digits == 0)
+		{
+			// inf, nan and the like
+			char *end;
+			double value = strtod(start, &end);
+			*endp = end;
+			return value;
+		}
+		if (*p == 'e' || *p == 'E')
+		{
+			const char *q = p + 1;
+			bool negative_exp = false;
+			if (*q == '-' || *q == '+')
+			{
+				negative_exp = *q == '-';
+				++q;
+			}
+			if (*q >= '0' && *q <= '9')
+			{
+				int e = 0;
+				for (; *q >= '0' && *q <= '9'; ++q)
+					e = e < 10000 ? e * 10 + (*q - '0') : e;
+				exponent += negative_exp ? -e : e;
+				p = q;
+			}
+		}
+		*endp = p;
+
+		double value = static_cast<double>(mantissa);
+		if (exponent < 0)
+			value = exponent >= -22 ? value / kPow10[-exponent] : value * pow(10.0, exponent);
+		else if (exponent > 0)
+			value = exponent <= 22 ? value * kPow10[exponent] : value * pow(10.0, exponent);
+		return negative ? -value : value;
+	}
+
+	inline bool ParseInteger(const char* p, const char** endp, long& value)
+	{
+		p = SkipSpace(p);
+		bool negative = *p == '-';
+		if (*p == '-' || *p == '+')
+			++p;
+		if (*p < '0' || *p > '9')
+			return false;
+		value = 0;
+		for (; *p >= '0' && *p <= '9'; ++p)
+			value = value * 10 + (*p - '0');
+		if (negative)
+			value = -value;
+		*endp = p;
+		return true;
+	}
+
+	const size_t kPlySize[] = {0, 1, 1, 2, 2, 4, 4, 4, 8};
+
+	bool isLittleEndian(void)
+	{
+		const unsigned short one = 1;
+		return *reinterpret_cast<const unsigned char*>(&one) == 1;
+	}
+}
+
+MeshStreamReader::MeshStreamReader(void)
+	: pfile_(NULL), begin_(0), end_(0), line_(NULL), num_vertex_(0), bytes_read_(0)
+	, format_(OBJ_ASCII), element_(0), remaining_(0)
+{
+}
+
+MeshStreamReader::~MeshStreamReader(void)
+{
+	Close();
+}
+
+bool MeshStreamReader::Open(const char* fins)
+{
+	Close();
+	pfile_ = fopen(fins, "rb");
+	if (pfile_ == NULL)
+	{
+		return false;
+	}
+	buffer_.resize(kStreamChunk + 1);
+	begin_ = end_ = 0;
+	num_vertex_ = 0;
+	bytes_read_ = 0;
+	format_ = OBJ_ASCII;
+	elements_.clear();
+	element_ = 0;
+	remaining_ = 0;
+
+	if (Fill(4) && memcmp(&buffer_[begin_], "ply", 3) == 0
+		&& (buffer_[begin_+3] == '\n' || buffer_[begin_+3] == '\r'))
+	{
+		if (!ReadHeader())
+		{
+			Close();
+			return false;
+		}
+	}
+	return true;
+}
+
+void MeshStreamReader::Close(void)
+{
+	if (pfile_ != NULL)
+	{
+		fclose(pfile_);
+		pfile_ = NULL;
+	}
+	buffer_.clear();
+	begin_ = end_ = 0;
+	elements_.clear();
+}
+
+int MeshStreamReader::num_declared_vertex(void) const
+{
+	for (size_t i = 0; i < elements_.size(); i++)
+	{
+		if (elements_[i].name_ == "vertex")
+		{
+			return static_cast<int>(elements_[i].count_);
+		}
+	}
+	return -1;
+}
+
+bool MeshStreamReader::Fill(size_t n)
+{
+	if (pfile_ == NULL)
+	{
+		return false;
+	}
+	while (end_ - begin_ < n)
+	{
+		size_t rest = end_ - begin_;
+		memmove(&buffer_[0], &buffer_[0] + begin_, rest);
+		begin_ = 0;
+		end_ = rest;
+		if (buffer_.size() - 1 - end_ < kStreamChunk / 2)
+		{
+			buffer_.resize(buffer_.size() * 2);
+		}
+		size_t read = fread(&buffer_[0] + end_, 1, buffer_.size() - 1 - end_, pfile_);
+		if (read == 0)
+		{
+			return false;
+		}
+		end_ += read;
+	}
+	return true;
+}
+
+bool MeshStreamReader::NextLine(void)
+{
+	if (pfile_ == NULL)
+	{
+		return false;
+	}
+	for (;;)
+	{
+		char *start = &buffer_[0] + begin_;
+		char *newline = static_cast<char*>(memchr(start, '\n', end_ - begin_));
+		if (newline != NULL)
+		{
+			*newline = 0;
+			line_ = start;
+			bytes_read_ += newline - start + 1;
+			begin_ = newline - &buffer_[0] + 1;
+			return true;
+		}
+
+		// move the partial line to the front and refill, growing the buffer for long lines
+		size_t rest = end_ - begin_;
+		memmove(&buffer_[0], start, rest);
+		begin_ = 0;
+		end_ = rest;
+		if (buffer_.size() - 1 - end_ < kStreamChunk / 2)
+		{
+			buffer_.resize(buffer_.size() * 2);
+		}
+		size_t n = fread(&buffer_[0] + end_, 1, buffer_.size() - 1 - end_, pfile_);
+		if (n == 0)
+		{
+			if (rest == 0)
+			{
+				return false;
+			}
+			// last line without a newline
+			buffer_[end_] = 0;
+			line_ = &buffer_[0];
+			bytes_read_ += rest;
+			begin_ = end_;
+			return true;
+		}
+		end_ += n;
+	}
+}
+
+bool MeshStreamReader::ReadHeader(void)
+{
+	static const char *kTypeNames[] = {"", "char", "uchar", "short", "ushort", "int", "uint", "float", "double"};
+	static const char *kSizedNames[] = {"", "int8", "uint8", "int16", "uint16", "int32", "uint32", "float32", "float64"};
+
+	NextLine();		// "ply"
+	while (NextLine())
+	{
+		char keyword[64] = {0}, a[64] = {0}, b[64] = {0}, c[64] = {0}, d[64] = {0};
+		int n = sscanf(line_, "%63s %63s %63s %63s %63s", keyword, a, b, c, d);
+		if (n <= 0)
+		{
+			continue;
+		}
+		if (strcmp(keyword, "end_header") == 0)
+		{
+			element_ = 0;
+			remaining_ = elements_.empty() ? 0 : elements_[0].count_;
+			return true;
+		}
+		if (strcmp(keyword, "format") == 0)
+		{
+			if (strcmp(a, "ascii") == 0)
+				format_ = PLY_ASCII;
+			else if (strcmp(a, "binary_little_endian") == 0)
+				format_ = PLY_BINARY_LE;
+			else if (strcmp(a, "binary_big_endian") == 0)
+				format_ = PLY_BINARY_BE;
+			else
+				return false;
+		}
+		else if (strcmp(keyword, "element") == 0 && n >= 3)
+		{
+			PlyElement element;
+			element.name_ = a;
+			element.count_ = atoll(b);
+			element.record_bytes_ = 0;
+			element.record_ = element.name_ == "vertex" ? MS_VERTEX : (element.name_ == "face" ? MS_FACE : MS_END);
+			elements_.push_back(element);
+		}
+		else if (strcmp(keyword, "property") == 0 && !elements_.empty())
+		{
+			bool list = strcmp(a, "list") == 0;
+			const char *type_names[2] = {list ? c : a, b};
+			PlyType types[2] = {PLY_NONE, PLY_NONE};
+			for (int t = 0; t < (list ? 2 : 1); t++)
+				for (int k = 1; k <= PLY_FLOAT64; k++)
+					if (strcmp(type_names[t], kTypeNames[k]) == 0 || strcmp(type_names[t], kSizedNames[k]) == 0)
+						types[t] = static_cast<PlyType>(k);
+			if (types[0] == PLY_NONE || (list && types[1] == PLY_NONE))
+			{
+				return false;
+			}
+
+			PlyProperty property;
+			property.type_ = types[0];
+			property.count_type_ = list ? types[1] : PLY_NONE;
+			property.role_ = ROLE_SKIP;
+			const std::string& owner = elements_.back().name_;
+			const char *name = list ? d : b;
+			if (owner == "vertex" && !list && name[1] == 0 && name[0] >= 'x' && name[0] <= 'z')
+				property.role_ = static_cast<PlyRole>(ROLE_X + (name[0] - 'x'));
+			else if (owner == "face" && list && (strcmp(name, "vertex_indices") == 0 || strcmp(name, "vertex_index") == 0))
+				property.role_ = ROLE_INDICES;
+			PlyElement& element = elements_.back();
+			if (element.properties_.empty() || element.record_bytes_ > 0)
+				element.record_bytes_ = list ? 0 : element.record_bytes_ + kPlySize[types[0]];
+			element.properties_.push_back(property);
+		}
+	}
+	return false;
+}
+
+const char* MeshStreamReader::Take(size_t n)
+{
+	if (!Fill(n))
+	{
+		return NULL;
+	}
+	const char *bytes = &buffer_[begin_];
+	begin_ += n;
+	bytes_read_ += n;
+	return bytes;
+}
+
+double MeshStreamReader::Decode(const char* bytes, PlyType type) const
+{
+	size_t size = kPlySize[type];
+	char swapped[8];
+	if ((format_ == PLY_BINARY_LE) != isLittleEndian())
+	{
+		for (size_t i = 0; i < size; i++)
+			swapped[i] = bytes[size-1-i];
+		bytes = swapped;
+	}
+
+	switch (type)
+	{
+	case PLY_INT8:		return static_cast<signed char>(bytes[0]);
+	case PLY_UINT8:		return static_cast<unsigned char>(bytes[0]);
+	case PLY_INT16:		{ short x; memcpy(&x, bytes, 2); return x; }
+	case PLY_UINT16:	{ unsigned short x; memcpy(&x, bytes, 2); return x; }
+	case PLY_INT32:		{ int x; memcpy(&x, bytes, 4); return x; }
+	case PLY_UINT32:	{ unsigned int x; memcpy(&x, bytes, 4); return x; }
+	case PLY_FLOAT32:	{ float x; memcpy(&x, bytes, 4); return x; }
+	case PLY_FLOAT64:	{ double x; memcpy(&x, bytes, 8); return x; }
+	default:			return 0.0;
+	}
+}
+
+bool MeshStreamReader::ReadAscii(const char*& p, double& value)
+{
+	const char *end;
+	value = ParseNumber(p, &end);
+	if (end == p)
+	{
+		return false;
+	}
+	p = end;
+	return true;
+}
+
+MeshStreamRecord MeshStreamReader::Next(Vec3f& v, std::vector<int>& face)
+{
+	return format_ == OBJ_ASCII ? NextOBJ(v, face) : NextPLY(v, face);
+}
+
+MeshStreamRecord MeshStreamReader::NextOBJ(Vec3f& v, std::vector<int>& face)
+{
+	while (NextLine())
+	{
+		const char *p = SkipSpace(line_);
+		if (p[0] == 'v' && (p[1] == ' ' || p[1] == '\t'))
+		{
+			const char *endp;
+			p += 2;
+			for (int i = 0; i < 3; i++)
+			{
+				v[i] = static_cast<float>(ParseNumber(p, &endp));
+				p = endp;
+			}
+			num_vertex_++;
+			return MS_VERTEX;
+		}
+		if (p[0] == 'f' && (p[1] == ' ' || p[1] == '\t'))
+		{
+			face.clear();
+			p += 2;
+			for (;;)
+			{
+				const char *endp;
+				long id;
+				if (!ParseInteger(p, &endp, id))
+					break;
+				face.push_back(id < 0 ? num_vertex_ + static_cast<int>(id) : static_cast<int>(id) - 1);
+				// skip the texture and normal indices
+				p = endp;
+				while (*p != 0 && *p != ' ' && *p != '\t' && *p != '\r')
+					++p;
+			}
+			if (face.size() >= 3)
+			{
+				return MS_FACE;
+			}
+		}
+	}
+	return MS_END;
+}
+
+MeshStreamRecord MeshStreamReader::NextPLY(Vec3f& v, std::vector<int>& face)
+{
+	for (;;)
+	{
+		while (remaining_ == 0)
+		{
+			if (++element_ >= elements_.size())
+			{
+				element_ = elements_.size();
+				return MS_END;
+			}
+			remaining_ = elements_[element_].count_;
+		}
+		remaining_--;
+
+		const PlyElement& element = elements_[element_];
+		const char *p = NULL;
+		if (format_ == PLY_ASCII)
+		{
+			if (!NextLine())
+				return MS_END;
+			p = line_;
+		}
+		else if (element.record_bytes_ > 0 && (p = Take(element.record_bytes_)) == NULL)
+		{
+			return MS_END;
+		}
+
+		face.clear();
+		for (size_t i = 0; i < element.properties_.size(); i++)
+		{
+			const PlyProperty& property = element.properties_[i];
+			double value;
+			long long count = 1;
+			if (property.count_type_ != PLY_NONE)
+			{
+				if (format_ == PLY_ASCII)
+				{
+					if (!ReadAscii(p, value))
+						return MS_END;
+				}
+				else
+				{
+					if ((p = Take(kPlySize[property.count_type_])) == NULL)
+						return MS_END;
+					value = Decode(p, property.count_type_);
+					if ((p = Take(static_cast<size_t>(value) * kPlySize[property.type_])) == NULL)
+						return MS_END;
+				}
+				count = static_cast<long long>(value);
+			}
+			else if (format_ != PLY_ASCII && element.record_bytes_ == 0 && (p = Take(kPlySize[property.type_])) == NULL)
+			{
+				return MS_END;
+			}
+
+			for (long long k = 0; k < count; k++)
+			{
+				if (format_ == PLY_ASCII)
+				{
+					if (!ReadAscii(p, value))
+						return MS_END;
+				}
+				else
+				{
+					value = Decode(p, property.type_);
+					p += kPlySize[property.type_];
+				}
+				switch (property.role_)
+				{
+				case ROLE_X:
+				case ROLE_Y:
+				case ROLE_Z:
+					v[property.role_ - ROLE_X] = static_cast<float>(value);
+					break;
+				case ROLE_INDICES:
+					face.push_back(static_cast<int>(value));
+					break;
+				default:
+					break;
+				}
+			}
+		}
+
+		if (element.record_ == MS_VERTEX)
+		{
+			num_vertex_++;
+			return MS_VERTEX;
+		}
+		if (element.record_ == MS_FACE && face.size() >= 3)
+		{
+			return MS_FACE;
+		}
+	}
+}
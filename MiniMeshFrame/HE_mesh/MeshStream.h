@@ -0,0 +1,110 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdio>
+#include "Vec.h"
+
+typedef trimesh::vec3  Vec3f;
+
+enum MeshStreamRecord
+{
+	MS_END = 0,			//!< end of file or read error
+	MS_VERTEX,			//!< a vertex position
+	MS_FACE				//!< a polygon, as 0-based vertex indices
+};
+
+/*!
+*	Sequential reader of the vertices and faces of an OBJ or PLY (ascii or binary) file,
+*	one record at a time, for inputs that are too large to be loaded as a whole.
+*	Relative (negative) OBJ indices are resolved; texture and normal indices and the
+*	other PLY properties are skipped.
+*/
+class MeshStreamReader
+{
+public:
+	MeshStreamReader(void);
+	~MeshStreamReader(void);
+
+	//! open a file, PLY files are recognized from their header
+	bool Open(const char* fins);
+	void Close(void);
+
+	//! read the next vertex or face
+	/*!
+	*	\param v receives the position of a vertex record
+	*	\param face receives the vertex indices of a face record
+	*/
+	MeshStreamRecord Next(Vec3f& v, std::vector<int>& face);
+
+	//! the number of vertices read so far
+	int num_vertex(void) const {return num_vertex_;}
+	//! the number of vertices declared in a PLY header, -1 for OBJ files
+	int num_declared_vertex(void) const;
+	//! bytes consumed so far, for progress reports
+	unsigned long long bytes_read(void) const {return bytes_read_;}
+
+private:
+	enum Format
+	{
+		OBJ_ASCII,
+		PLY_ASCII,
+		PLY_BINARY_LE,
+		PLY_BINARY_BE
+	};
+
+	enum PlyType
+	{
+		PLY_NONE,
+		PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16,
+		PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64
+	};
+
+	enum PlyRole
+	{
+		ROLE_SKIP,
+		ROLE_X, ROLE_Y, ROLE_Z,
+		ROLE_INDICES
+	};
+
+	struct PlyProperty
+	{
+		PlyType		type_;
+		PlyType		count_type_;	//!< type of the list length, PLY_NONE for scalars
+		PlyRole		role_;
+	};
+
+	struct PlyElement
+	{
+		std::string					name_;
+		long long					count_;
+		std::vector<PlyProperty>	properties_;
+		size_t						record_bytes_;	//!< binary size of a record, 0 if it has lists
+		MeshStreamRecord			record_;		//!< what a record is returned as, MS_END if skipped
+	};
+
+	bool NextLine(void);
+	//! make at least n unread bytes available in buffer_
+	bool Fill(size_t n);
+	bool ReadHeader(void);
+	MeshStreamRecord NextOBJ(Vec3f& v, std::vector<int>& face);
+	MeshStreamRecord NextPLY(Vec3f& v, std::vector<int>& face);
+	//! consume n bytes of a binary body, NULL at the end of the file
+	const char* Take(size_t n);
+	double Decode(const char* bytes, PlyType type) const;
+	//! read one value of an ascii property from line_
+	bool ReadAscii(const char*& p, double& value);
+
+private:
+	FILE				*pfile_;
+	std::vector<char>	buffer_;
+	size_t				begin_, end_;		//!< unread part of buffer_
+	char				*line_;
+	int					num_vertex_;
+	unsigned long long	bytes_read_;
+
+	Format					format_;
+	std::vector<PlyElement>	elements_;
+	size_t					element_;		//!< the element being read
+	long long				remaining_;		//!< records left in the current element
+};
@@ -0,0 +1,254 @@
+#include "Meshlet.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <thread>
+
+MeshletSet::MeshletSet(void)
+{
+}
+
+MeshletSet::~MeshletSet(void)
+{
+}
+
+void MeshletSet::Clear(void)
+{
+	std::vector<Meshlet>().swap(meshlets_);
+	std::vector<int>().swap(vertices_);
+}
+
+void MeshletSet::Build(Mesh3D* mesh, std::vector<unsigned int>& indices, int max_triangles,
+	const std::vector<int>* corners)
+{
+	Clear();
+	indices.clear();
+	int num_face = mesh == NULL ? 0 : mesh->num_of_face_list();
+	if (num_face == 0)
+	{
+		return;
+	}
+	const std::vector<HE_face*>& faces = *(mesh->get_faces_list());
+	const std::vector<HE_vert*>& verts = *(mesh->get_vertex_list());
+	indices.reserve(static_cast<size_t>(num_face) * 3);
+	vertices_.reserve(static_cast<size_t>(num_face) * 3);
+
+	std::vector<int> owner(num_face, -1);
+	std::vector<int> queue, patch;
+	for (int seed = 0; seed < num_face; seed++)
+	{
+		if (owner[seed] >= 0)
+		{
+			continue;
+		}
+
+		// grow across the edges until the meshlet is full
+		int id = static_cast<int>(meshlets_.size());
+		int num_triangle = 0;
+		size_t head = 0;
+		queue.assign(1, seed);
+		patch.clear();
+		owner[seed] = id;
+		while (head < queue.size() && num_triangle < max_triangles)
+		{
+			HE_face *face = faces[queue[head++]];
+			int valence = 0;
+			HE_edge *pedge = face->pedge_;
+			do
+			{
+				valence++;
+				pedge = pedge->pnext_;
+			} while (pedge != face->pedge_);
+			if (num_triangle > 0 && num_triangle + valence - 2 > max_triangles)
+			{
+				owner[face->id_] = -1;
+				continue;
+			}
+			patch.push_back(face->id_);
+			num_triangle += valence - 2;
+
+			do
+			{
+				HE_face *next = pedge->ppair_ != NULL ? pedge->ppair_->pface_ : NULL;
+				if (next != NULL && owner[next->id_] < 0)
+				{
+					owner[next->id_] = id;
+					queue.push_back(next->id_);
+				}
+				pedge = pedge->pnext_;
+			} while (pedge != face->pedge_);
+		}
+		// the faces reached but not taken go back to the pool
+		for (; head < queue.size(); head++)
+		{
+			owner[queue[head]] = -1;
+		}
+		std::sort(patch.begin(), patch.end());
+
+		Meshlet meshlet;
+		meshlet.first_index_ = static_cast<int>(indices.size());
+		for (size_t i = 0; i != patch.size(); i++)
+		{
+			HE_edge *first = faces[patch[i]]->pedge_;
+			HE_edge *pedge = first->pnext_;
+			while (pedge->pnext_ != first)
+			{
+				// a corner is the half-edge ending at its vertex
+				HE_edge *tri[3] = {first, pedge, pedge->pnext_};
+				for (int k = 0; k < 3; k++)
+				{
+					indices.push_back(corners != NULL ? (*corners)[tri[k]->id_] : tri[k]->pvert_->id_);
+					vertices_.push_back(tri[k]->pvert_->id_);
+				}
+				pedge = pedge->pnext_;
+			}
+		}
+		meshlet.num_index_ = static_cast<int>(indices.size()) - meshlet.first_index_;
+		ComputeBounds(meshlet, verts);
+		meshlets_.push_back(meshlet);
+	}
+}
+
+void MeshletSet::ComputeBounds(Meshlet& meshlet, const std::vector<HE_vert*>& verts) const
+{
+	const int *ids = &vertices_[meshlet.first_index_];
+	Vec3f low(FLT_MAX, FLT_MAX, FLT_MAX), high(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	Vec3f axis;
+	meshlet.min_vertex_ = ids[0];
+	meshlet.max_vertex_ = ids[0];
+	for (int i = 0; i < meshlet.num_index_; i += 3)
+	{
+		const Vec3f *tri[3] = {&verts[ids[i]]->position_, &verts[ids[i + 1]]->position_, &verts[ids[i + 2]]->position_};
+		for (int k = 0; k < 3; k++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				low[c] = (*tri[k])[c] < low[c] ? (*tri[k])[c] : low[c];
+				high[c] = (*tri[k])[c] > high[c] ? (*tri[k])[c] : high[c];
+			}
+		}
+		Vec3f n = (*tri[1] - *tri[0]) ^ (*tri[2] - *tri[0]);
+		float l = len(n);
+		if (l > 0.f)
+		{
+			axis += n / l;
+		}
+	}
+
+	meshlet.center_ = (low + high) * 0.5f;
+	meshlet.radius_ = 0.f;
+	for (int i = 0; i < meshlet.num_index_; i++)
+	{
+		float d = dist(verts[ids[i]]->position_, meshlet.center_);
+		meshlet.radius_ = d > meshlet.radius_ ? d : meshlet.radius_;
+		meshlet.min_vertex_ = ids[i] < meshlet.min_vertex_ ? ids[i] : meshlet.min_vertex_;
+		meshlet.max_vertex_ = ids[i] > meshlet.max_vertex_ ? ids[i] : meshlet.max_vertex_;
+	}
+
+	// the cone holds every triangle normal, it is open if they span a half space
+	float l = len(axis);
+	meshlet.cone_axis_ = l > 0.f ? axis / l : Vec3f(0.f, 0.f, 1.f);
+	float cutoff = l > 0.f ? 1.f : -1.f;
+	for (int i = 0; i < meshlet.num_index_ && cutoff > 0.f; i += 3)
+	{
+		const Vec3f& a = verts[ids[i]]->position_;
+		Vec3f n = (verts[ids[i + 1]]->position_ - a) ^ (verts[ids[i + 2]]->position_ - a);
+		float nl = len(n);
+		float c = nl > 0.f ? meshlet.cone_axis_.dot(n) / nl : -1.f;
+		cutoff = c < cutoff ? c : cutoff;
+	}
+	meshlet.cone_sin_ = cutoff > 0.f ? sqrt(1.f - cutoff * cutoff) : 1.f;
+}
+
+void MeshletSet::Refit(Mesh3D* mesh, int first, int last)
+{
+	// the span of a meshlet is a coarse test, a meshlet it lets through is refitted for nothing
+	const std::vector<HE_vert*>& verts = *(mesh->get_vertex_list());
+	for (size_t i = 0; i != meshlets_.size(); i++)
+	{
+		if (meshlets_[i].min_vertex_ < last && meshlets_[i].max_vertex_ >= first)
+		{
+			ComputeBounds(meshlets_[i], verts);
+		}
+	}
+}
+
+int MeshletSet::Cull(const float mvp[16], const Vec3f& eye, bool frustum, bool backface, std::vector<unsigned char>& visible) const
+{
+	// frustum planes from the rows of the matrix (Gribb and Hartmann), normalized for sphere tests
+	float planes[6][4];
+	for (int p = 0; p < 6; p++)
+	{
+		int row = p / 2;
+		float sign = p % 2 == 0 ? 1.f : -1.f;
+		float length = 0.f;
+		for (int c = 0; c < 4; c++)
+		{
+			planes[p][c] = mvp[c * 4 + 3] + sign * mvp[c * 4 + row];
+			length += c < 3 ? planes[p][c] * planes[p][c] : 0.f;
+		}
+		length = length > 0.f ? sqrt(length) : 1.f;
+		for (int c = 0; c < 4; c++)
+		{
+			planes[p][c] /= length;
+		}
+	}
+
+	int num_meshlet = num_meshlets();
+	visible.resize(num_meshlet);
+	int num_threads = static_cast<int>(std::thread::hardware_concurrency());
+	if (num_threads <= 0 || num_meshlet < (1 << 12))
+	{
+		num_threads = 1;
+	}
+	if (num_threads == 1)
+	{
+		return CullRange(0, num_meshlet, planes, eye, frustum, backface, visible);
+	}
+
+	int chunk = (num_meshlet + num_threads - 1) / num_threads;
+	std::vector<int> counts(num_threads, 0);
+	std::vector<std::thread> workers;
+	for (int t = 0; t < num_threads; t++)
+	{
+		workers.push_back(std::thread([&, t]()
+		{
+			int end = (t + 1) * chunk < num_meshlet ? (t + 1) * chunk : num_meshlet;
+			counts[t] = t * chunk < end ? CullRange(t * chunk, end, planes, eye, frustum, backface, visible) : 0;
+		}));
+	}
+	int count = 0;
+	for (int t = 0; t < num_threads; t++)
+	{
+		workers[t].join();
+		count += counts[t];
+	}
+	return count;
+}
+
+int MeshletSet::CullRange(int first, int last, const float planes[6][4], const Vec3f& eye, bool frustum, bool backface,
+	std::vector<unsigned char>& visible) const
+{
+	int count = 0;
+	for (int i = first; i < last; i++)
+	{
+		const Meshlet& meshlet = meshlets_[i];
+		bool inside = true;
+		for (int p = 0; p < 6 && inside && frustum; p++)
+		{
+			inside = planes[p][0] * meshlet.center_[0] + planes[p][1] * meshlet.center_[1]
+				+ planes[p][2] * meshlet.center_[2] + planes[p][3] >= -meshlet.radius_;
+		}
+		if (inside && backface && meshlet.cone_sin_ < 1.f)
+		{
+			// every direction from the eye into the sphere is within 90 degrees minus the cone
+			// angle of the axis, so every normal of the cone points away from the eye
+			Vec3f view = meshlet.center_ - eye;
+			inside = meshlet.cone_axis_.dot(view) - meshlet.radius_ <= meshlet.cone_sin_ * (len(view) + meshlet.radius_);
+		}
+		visible[i] = inside;
+		count += inside;
+	}
+	return count;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <vector>
+#include "Mesh3D.h"
+
+//! a small connected patch of triangles, with the bounds used to cull it
+struct Meshlet
+{
+	int		first_index_;		//!< range in MeshletSet::indices
+	int		num_index_;
+	Vec3f	center_;			//!< bounding sphere
+	float	radius_;
+	Vec3f	cone_axis_;			//!< average direction of the triangle normals
+	float	cone_sin_;			//!< sine of the half angle of the normal cone, >= 1 if the cone is open
+	int		min_vertex_;		//!< the ids of its vertices are in [min_vertex_, max_vertex_]
+	int		max_vertex_;
+};
+
+/*!
+*	Partition of the triangles of a mesh into meshlets, for culling them by groups.
+*	Meshlets are grown face by face across the edges from seeds taken in the face order,
+*	polygons are split in fans and kept whole. Inside a meshlet the faces keep their order,
+*	so a mesh ordered by MeshOptimizer keeps most of its cache locality.
+*	The bounds are kept, the indices go to the caller (the index buffer of MeshRenderer).
+*	Culling is done in the space of the mesh: a meshlet is dropped if its sphere is outside
+*	a plane of the view frustum, or, with backface culling, if every triangle it can hold
+*	faces away from the eye.
+*/
+class MeshletSet
+{
+public:
+	MeshletSet(void);
+	~MeshletSet(void);
+
+	//! partition the faces of a mesh into meshlets of at most max_triangles triangles
+	/*!
+	*	\param indices receives the triangle indices, meshlet after meshlet
+	*	\param corners the index of each corner by the id of its half-edge, for vertices split
+	*	at attribute seams; NULL to index the vertices of the mesh
+	*/
+	void Build(Mesh3D* mesh, std::vector<unsigned int>& indices, int max_triangles = 128,
+		const std::vector<int>* corners = NULL);
+	void Clear(void);
+	//! fit the bounds of the meshlets with a vertex in [first, last) to the moved vertices
+	void Refit(Mesh3D* mesh, int first, int last);
+
+	const std::vector<Meshlet>& meshlets(void) const {return meshlets_;}
+	int num_meshlets(void) const {return static_cast<int>(meshlets_.size());}
+
+	//! flag the meshlets that may be visible
+	/*!
+	*	\param mvp projection times modelview, column-major as returned by glGetFloatv
+	*	\param eye the eye in the space of the mesh
+	*	\param visible receives one flag per meshlet
+	*	\return the number of visible meshlets
+	*/
+	int Cull(const float mvp[16], const Vec3f& eye, bool frustum, bool backface, std::vector<unsigned char>& visible) const;
+
+private:
+	//! bounding sphere, normal cone and vertex span of a meshlet from the current positions
+	void ComputeBounds(Meshlet& meshlet, const std::vector<HE_vert*>& verts) const;
+	//! cull the meshlets [first, last), planes are normalized (a, b, c, d) with ax+by+cz+d >= 0 inside
+	int CullRange(int first, int last, const float planes[6][4], const Vec3f& eye, bool frustum, bool backface,
+		std::vector<unsigned char>& visible) const;
+
+private:
+	std::vector<Meshlet>	meshlets_;
+	std::vector<int>		vertices_;		//!< vertex of the mesh behind each index
+};
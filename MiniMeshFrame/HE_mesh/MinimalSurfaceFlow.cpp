@@ -0,0 +1,61 @@
+#include "MinimalSurfaceFlow.h"
+
+MinimalSurfaceFlow::MinimalSurfaceFlow(void)
+	: mesh_(NULL), area_threshold_(1e-4), max_iterations_(100), iteration_(0), is_finished_(true)
+{
+	solver_.set_weights(LaplacianAssembler::COTANGENT);
+}
+
+MinimalSurfaceFlow::~MinimalSurfaceFlow(void)
+{
+}
+
+bool MinimalSurfaceFlow::Initialize(Mesh3D* mesh)
+{
+	solver_.Clear();
+	area_history_.clear();
+	iteration_ = 0;
+	mesh_ = mesh;
+	is_finished_ = mesh == NULL || mesh->num_of_face_list() == 0;
+	if (is_finished_)
+	{
+		return false;
+	}
+	area_history_.push_back(SurfaceArea());
+	return true;
+}
+
+bool MinimalSurfaceFlow::Step(void)
+{
+	if (is_finished_)
+	{
+		return false;
+	}
+	if (!solver_.Solve(mesh_))
+	{
+		is_finished_ = true;
+		return false;
+	}
+	iteration_++;
+	double previous = area_history_.back(), area = SurfaceArea();
+	area_history_.push_back(area);
+	is_finished_ = previous - area < area_threshold_ * previous || iteration_ >= max_iterations_;
+	return !is_finished_;
+}
+
+double MinimalSurfaceFlow::SurfaceArea(void) const
+{
+	// the fan of each face from its first vertex
+	double area = 0.0;
+	const std::vector<HE_face*>& faces = *(mesh_->get_faces_list());
+	for (size_t i = 0; i != faces.size(); i++)
+	{
+		HE_edge *pedge = faces[i]->pedge_;
+		const Vec3f& first = pedge->pvert_->position_;
+		for (pedge = pedge->pnext_; pedge->pnext_ != faces[i]->pedge_; pedge = pedge->pnext_)
+		{
+			area += 0.5 * len((pedge->pvert_->position_ - first) ^ (pedge->pnext_->pvert_->position_ - first));
+		}
+	}
+	return area;
+}
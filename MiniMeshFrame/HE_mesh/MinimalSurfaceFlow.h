@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+#include "Mesh3D.h"
+#include "LaplaceSolver.h"
+
+/*!
+*	Minimal surface of Pinkall and Polthier: each step maps the surface to the harmonic map of
+*	its boundary under the cotangent weights of the current surface, which minimizes the
+*	Dirichlet energy and so decreases the area, without the distortion of the uniform weights.
+*	The pattern of the cotangent Laplacian never changes, the solver keeps its symbolic
+*	factorization and only refactors the values. The steps stop once the area decreased by
+*	less than area_threshold of itself, or grew, or after max_iterations.
+*/
+class MinimalSurfaceFlow
+{
+public:
+	MinimalSurfaceFlow(void);
+	~MinimalSurfaceFlow(void);
+
+	//! start from the current surface of a mesh, the steps move its inner vertices
+	/*!
+	*	\return false if the mesh has no faces
+	*/
+	bool Initialize(Mesh3D* mesh);
+	//! one harmonic map step
+	/*!
+	*	\return false once the flow is over, see isFinished, or the solve failed
+	*/
+	bool Step(void);
+
+	void set_area_threshold(double threshold) {area_threshold_ = threshold;}
+	void set_max_iterations(int n) {max_iterations_ = n;}
+	LaplaceSolver& solver(void) {return solver_;}
+
+	int iteration(void) const {return iteration_;}
+	//! area of the surface now, the first entry is that of the initial surface
+	double area(void) const {return area_history_.empty() ? 0.0 : area_history_.back();}
+	const std::vector<double>& area_history(void) const {return area_history_;}
+	bool isFinished(void) const {return is_finished_;}
+
+private:
+	double SurfaceArea(void) const;
+
+private:
+	Mesh3D				*mesh_;
+	LaplaceSolver		solver_;
+	double				area_threshold_;
+	int					max_iterations_;
+
+	int					iteration_;
+	std::vector<double>	area_history_;
+	bool				is_finished_;
+};
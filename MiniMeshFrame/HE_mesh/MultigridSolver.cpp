@@ -0,0 +1,299 @@
+#include "MultigridSolver.h"
+
+#include <cmath>
+#include <thread>
+
+namespace
+{
+	//! run work(first, last) over [0, count), split between the threads
+	template <typename Work>
+	void ParallelFor(int count, int num_threads, Work work)
+	{
+		// below this many rows per thread, starting the threads costs more than the work
+		const int kGrain = 1 << 14;
+		num_threads = num_threads > 0 ? num_threads : static_cast<int>(std::thread::hardware_concurrency());
+		int useful = count / kGrain;
+		num_threads = num_threads < useful ? num_threads : useful;
+		num_threads = num_threads > 1 ? num_threads : 1;
+
+		int chunk = (count + num_threads - 1) / num_threads;
+		std::vector<std::thread> workers;
+		for (int t = 1; t < num_threads; t++)
+		{
+			int end = (t + 1) * chunk < count ? (t + 1) * chunk : count;
+			if (t * chunk < end)
+			{
+				workers.push_back(std::thread(work, t * chunk, end));
+			}
+		}
+		work(0, chunk < count ? chunk : count);
+		for (size_t t = 0; t != workers.size(); t++)
+		{
+			workers[t].join();
+		}
+	}
+}
+
+MultigridSolver::MultigridSolver(void)
+	: matrix_(NULL), tolerance_(1e-8), max_cycles_(200), smoothing_steps_(2), coarse_size_(2000)
+	, num_threads_(0), cycles_(0), residual_(0.0)
+{
+}
+
+MultigridSolver::~MultigridSolver(void)
+{
+}
+
+void MultigridSolver::Clear(void)
+{
+	matrix_ = NULL;
+	std::vector<Level>().swap(levels_);
+}
+
+bool MultigridSolver::SetupSmoother(Level& level, const SparseMatrix& matrix)
+{
+	level.inverse_diagonal_.resize(matrix.rows());
+	for (int i = 0; i < matrix.outerSize(); i++)
+	{
+		double diagonal = matrix.coeff(i, i);
+		if (diagonal <= 0.0)
+		{
+			return false;
+		}
+		level.inverse_diagonal_[i] = 1.0 / diagonal;
+	}
+
+	// the damping 4 / (3 rho), rho of D^-1 A by a few power iterations, 2/3 for a Laplacian;
+	// the row sums would overestimate it a lot once some weights are negative
+	const int kPowerIterations = 15;
+	Eigen::VectorXd v = Eigen::VectorXd::Ones(matrix.rows()) + Eigen::VectorXd::Random(matrix.rows()) * 0.5;
+	double rho = 0.0;
+	for (int k = 0; k < kPowerIterations && v.norm() > 0.0; k++)
+	{
+		v.normalize();
+		Eigen::VectorXd w = level.inverse_diagonal_.asDiagonal() * (matrix * v);
+		rho = v.dot(w) > rho ? v.dot(w) : rho;
+		rho = w.norm() > rho ? w.norm() : rho;
+		v = w;
+	}
+	level.omega_ = 4.0 / (3.0 * (rho > 0.0 ? rho : 1.0));
+	return true;
+}
+
+int MultigridSolver::Cluster(const SparseMatrix& matrix, std::vector<int>& cluster) const
+{
+	// j is a strong neighbor of i if |a_ij| >= theta sqrt(a_ii a_jj), all of the one-ring on the mesh
+	const double kTheta = 0.08;
+	int n = static_cast<int>(matrix.rows());
+	Eigen::VectorXd diagonal = matrix.diagonal();
+	auto strong = [&](const SparseMatrix::InnerIterator& it, int i)
+	{
+		return it.row() != i && fabs(it.value()) >= kTheta * sqrt(diagonal[i] * diagonal[it.row()]);
+	};
+
+	// a vertex none of whose strong neighbors is taken starts a cluster with them
+	cluster.assign(n, -1);
+	int count = 0;
+	for (int i = 0; i < n; i++)
+	{
+		bool is_free = cluster[i] < 0;
+		for (SparseMatrix::InnerIterator it(matrix, i); it && is_free; ++it)
+		{
+			is_free = !strong(it, i) || cluster[it.row()] < 0;
+		}
+		if (!is_free)
+		{
+			continue;
+		}
+		cluster[i] = count;
+		for (SparseMatrix::InnerIterator it(matrix, i); it; ++it)
+		{
+			if (strong(it, i))
+			{
+				cluster[it.row()] = count;
+			}
+		}
+		count++;
+	}
+
+	// the others join the cluster of a strong neighbor from the first pass, or stay alone
+	std::vector<int> first(cluster);
+	for (int i = 0; i < n; i++)
+	{
+		for (SparseMatrix::InnerIterator it(matrix, i); it && cluster[i] < 0; ++it)
+		{
+			if (strong(it, i) && first[it.row()] >= 0)
+			{
+				cluster[i] = first[it.row()];
+			}
+		}
+	}
+	for (int i = 0; i < n; i++)
+	{
+		cluster[i] = cluster[i] < 0 ? count++ : cluster[i];
+	}
+	return count;
+}
+
+bool MultigridSolver::Compute(const SparseMatrix& matrix)
+{
+	Clear();
+	matrix_ = &matrix;
+	levels_.push_back(Level());
+	levels_[0].size_ = static_cast<int>(matrix.rows());
+	if (!SetupSmoother(levels_[0], matrix))
+	{
+		return false;
+	}
+
+	while (levels_.back().size_ > coarse_size_)
+	{
+		int l = num_levels() - 1;
+		const SparseMatrix& fine = LevelMatrix(l);
+		std::vector<int> cluster;
+		int n = levels_[l].size_, size = Cluster(fine, cluster);
+		if (size > n * 3 / 4)
+		{
+			break;
+		}
+
+		// the prolongation (I - omega D^-1 A) P0, P0 the indicator of the clusters
+		RowMatrix tentative(n, size);
+		tentative.resizeNonZeros(n);
+		for (int i = 0; i < n; i++)
+		{
+			tentative.outerIndexPtr()[i] = i;
+			tentative.innerIndexPtr()[i] = cluster[i];
+			tentative.valuePtr()[i] = 1.0;
+		}
+		tentative.outerIndexPtr()[n] = n;
+		Eigen::VectorXd damping = levels_[l].inverse_diagonal_ * levels_[l].omega_;
+		RowMatrix jacobi = damping.asDiagonal() * fine;
+		RowMatrix smoothed = jacobi * tentative;
+		levels_[l].prolongation_ = tentative - smoothed;
+		levels_[l].restriction_ = levels_[l].prolongation_.transpose();
+		RowMatrix product = fine * levels_[l].prolongation_;
+		SparseMatrix coarse = levels_[l].restriction_ * product;
+
+		levels_.push_back(Level());
+		levels_.back().size_ = size;
+		levels_.back().matrix_.swap(coarse);
+		if (!SetupSmoother(levels_.back(), levels_.back().matrix_))
+		{
+			return false;
+		}
+	}
+
+	for (size_t l = 0; l != levels_.size(); l++)
+	{
+		levels_[l].rhs_.setZero(levels_[l].size_, 3);
+		levels_[l].solution_.setZero(levels_[l].size_, 3);
+		levels_[l].residual_.setZero(levels_[l].size_, 3);
+	}
+	coarsest_.compute(LevelMatrix(num_levels() - 1));
+	return coarsest_.info() == Eigen::Success;
+}
+
+void MultigridSolver::Multiply(const int* outer, const int* inner, const double* values, int rows,
+	const Eigen::MatrixX3d& x, const Eigen::MatrixX3d* b, Eigen::MatrixX3d& y) const
+{
+	ParallelFor(rows, num_threads_, [&](int first, int last)
+	{
+		for (int i = first; i < last; i++)
+		{
+			double sum[3] = {0.0, 0.0, 0.0};
+			for (int p = outer[i]; p < outer[i + 1]; p++)
+			{
+				int j = inner[p];
+				sum[0] += values[p] * x(j, 0);
+				sum[1] += values[p] * x(j, 1);
+				sum[2] += values[p] * x(j, 2);
+			}
+			for (int c = 0; c < 3; c++)
+			{
+				y(i, c) = b != NULL ? (*b)(i, c) - sum[c] : sum[c];
+			}
+		}
+	});
+}
+
+void MultigridSolver::Smooth(int l, int steps)
+{
+	// x + omega D^-1 (b - A x) into the residual of the level, then swapped in
+	Level& level = levels_[l];
+	const SparseMatrix& matrix = LevelMatrix(l);
+	const int* outer = matrix.outerIndexPtr();
+	const int* inner = matrix.innerIndexPtr();
+	const double* values = matrix.valuePtr();
+	for (int s = 0; s < steps; s++)
+	{
+		const Eigen::MatrixX3d& x = level.solution_;
+		ParallelFor(level.size_, num_threads_, [&](int first, int last)
+		{
+			for (int i = first; i < last; i++)
+			{
+				double sum[3] = {level.rhs_(i, 0), level.rhs_(i, 1), level.rhs_(i, 2)};
+				for (int p = outer[i]; p < outer[i + 1]; p++)
+				{
+					int j = inner[p];
+					sum[0] -= values[p] * x(j, 0);
+					sum[1] -= values[p] * x(j, 1);
+					sum[2] -= values[p] * x(j, 2);
+				}
+				double damping = level.omega_ * level.inverse_diagonal_[i];
+				for (int c = 0; c < 3; c++)
+				{
+					level.residual_(i, c) = x(i, c) + damping * sum[c];
+				}
+			}
+		});
+		level.solution_.swap(level.residual_);
+	}
+}
+
+void MultigridSolver::Cycle(int l)
+{
+	Level& level = levels_[l];
+	if (l == num_levels() - 1)
+	{
+		level.solution_ = coarsest_.solve(level.rhs_);
+		return;
+	}
+	Smooth(l, smoothing_steps_);
+	Multiply(LevelMatrix(l), level.solution_, &level.rhs_, level.residual_);
+	Level& coarse = levels_[l + 1];
+	Multiply(level.restriction_, level.residual_, NULL, coarse.rhs_);
+	coarse.solution_.setZero();
+	Cycle(l + 1);
+	Multiply(level.prolongation_, coarse.solution_, NULL, level.residual_);
+	level.solution_ += level.residual_;
+	Smooth(l, smoothing_steps_);
+}
+
+bool MultigridSolver::Solve(const Eigen::MatrixX3d& rhs, Eigen::MatrixX3d& solution)
+{
+	cycles_ = 0;
+	residual_ = 0.0;
+	if (matrix_ == NULL || levels_.empty() || rhs.rows() != matrix_->rows() || solution.rows() != rhs.rows())
+	{
+		return false;
+	}
+
+	// one scale for the three coordinates, as in BlockConjugateGradient
+	double scale = rhs.colwise().norm().maxCoeff();
+	scale = scale > 0.0 ? scale : 1.0;
+	Level& fine = levels_[0];
+	fine.rhs_ = rhs;
+	fine.solution_.swap(solution);
+	Multiply(*matrix_, fine.solution_, &fine.rhs_, fine.residual_);
+	residual_ = fine.residual_.colwise().norm().maxCoeff() / scale;
+	while (cycles_ < max_cycles_ && residual_ > tolerance_)
+	{
+		Cycle(0);
+		cycles_++;
+		Multiply(*matrix_, fine.solution_, &fine.rhs_, fine.residual_);
+		residual_ = fine.residual_.colwise().norm().maxCoeff() / scale;
+	}
+	solution.swap(fine.solution_);
+	return residual_ <= tolerance_;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vector>
+#include <Eigen/Sparse>
+
+/*!
+*	Multigrid V-cycles for a symmetric positive definite system on the vertices of a mesh, with
+*	three right-hand sides, whose time per cycle and number of cycles do not grow with the mesh.
+*	The hierarchy clusters the vertices: a vertex and its one-ring make a coarse vertex, the
+*	vertices left over join a neighboring cluster, until coarse_size vertices remain. The
+*	prolongation spreads each coarse value over its cluster and smooths it by one damped Jacobi
+*	step (smoothed aggregation), the restriction is its transpose and the coarse matrix P^T A P.
+*	The coarsest system is factorized. A cycle smooths by damped Jacobi before and after the
+*	correction from the coarser level; the smoothing and all the products are split over the
+*	rows between threads, which needs both triangles of every matrix to be stored.
+*/
+class MultigridSolver
+{
+public:
+	typedef Eigen::SparseMatrix<double> SparseMatrix;
+	typedef Eigen::SparseMatrix<double, Eigen::RowMajor> RowMatrix;
+
+	MultigridSolver(void);
+	~MultigridSolver(void);
+
+	//! build the hierarchy, the matrix is kept by reference and must outlive the solves
+	/*!
+	*	\return false if a diagonal entry is not positive or the coarsest system is singular
+	*/
+	bool Compute(const SparseMatrix& matrix);
+	//! V-cycles from the solution given until the tolerance or max_cycles
+	/*!
+	*	\return false if some column did not reach the tolerance
+	*/
+	bool Solve(const Eigen::MatrixX3d& rhs, Eigen::MatrixX3d& solution);
+	void Clear(void);
+
+	//! residual relative to the largest norm of the right-hand sides
+	void set_tolerance(double tolerance) {tolerance_ = tolerance;}
+	void set_max_cycles(int n) {max_cycles_ = n;}
+	//! damped Jacobi sweeps before and after the coarse correction
+	void set_smoothing_steps(int n) {smoothing_steps_ = n;}
+	//! the hierarchy stops at this many vertices, next Compute
+	void set_coarse_size(int n) {coarse_size_ = n;}
+	//! 0 uses every hardware thread
+	void set_num_threads(int n) {num_threads_ = n;}
+
+	int num_levels(void) const {return static_cast<int>(levels_.size());}
+	int level_size(int level) const {return levels_[level].size_;}
+	//! of the last Solve
+	int cycles(void) const {return cycles_;}
+	double residual(void) const {return residual_;}
+
+private:
+	struct Level
+	{
+		int				size_;
+		SparseMatrix	matrix_;				//!< empty on the finest level, the input is used
+		RowMatrix		prolongation_;			//!< to this level from the next coarser one
+		RowMatrix		restriction_;
+		Eigen::VectorXd	inverse_diagonal_;
+		double			omega_;					//!< damping of the Jacobi steps
+		Eigen::MatrixX3d	rhs_;
+		Eigen::MatrixX3d	solution_;
+		Eigen::MatrixX3d	residual_;
+	};
+
+	const SparseMatrix& LevelMatrix(int level) const {return level == 0 ? *matrix_ : levels_[level].matrix_;}
+	//! the inverse diagonal and the Jacobi damping of a level
+	bool SetupSmoother(Level& level, const SparseMatrix& matrix);
+	//! cluster the vertices of a matrix graph, returns the number of clusters
+	int Cluster(const SparseMatrix& matrix, std::vector<int>& cluster) const;
+	void Cycle(int level);
+	void Smooth(int level, int steps);
+
+	//! y = M x, or y = b - M x with b, M in compressed rows; symmetric matrices pass as their columns
+	void Multiply(const int* outer, const int* inner, const double* values, int rows,
+		const Eigen::MatrixX3d& x, const Eigen::MatrixX3d* b, Eigen::MatrixX3d& y) const;
+	template <typename Matrix>
+	void Multiply(const Matrix& matrix, const Eigen::MatrixX3d& x, const Eigen::MatrixX3d* b, Eigen::MatrixX3d& y) const
+	{
+		Multiply(matrix.outerIndexPtr(), matrix.innerIndexPtr(), matrix.valuePtr(), static_cast<int>(matrix.outerSize()), x, b, y);
+	}
+
+private:
+	const SparseMatrix	*matrix_;
+	std::vector<Level>	levels_;
+	Eigen::SimplicialLDLT<SparseMatrix>	coarsest_;
+
+	double				tolerance_;
+	int					max_cycles_;
+	int					smoothing_steps_;
+	int					coarse_size_;
+	int					num_threads_;
+
+	int					cycles_;
+	double				residual_;
+};
@@ -0,0 +1,807 @@
+#include "OutOfCoreMesh.h"
+#include "Mesh3D.h"
+#include "MeshStream.h"
+
+#include <map>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <cfloat>
+#include <algorithm>
+#include <unordered_map>
+
+namespace
+{
+	const char kOOCMagic[4] = {'O', 'O', 'C', '1'};
+	const int kOOCVersion = 1;
+	const size_t kOOCTableOffset = 64;
+	//! clusters start on multiples of the largest allocation granularity, to map them directly
+	const unsigned long long kOOCAlignment = 65536;
+	const size_t kOOCDefaultCap = size_t(256) << 20;
+
+	struct OOCHeader
+	{
+		char		magic_[4];
+		int			version_;
+		long long	num_vertex_;
+		long long	num_face_;
+		int			num_cluster_;
+		int			reserved_;
+		float		bbox_[6];
+	};
+
+	inline unsigned long long AlignUp(unsigned long long x, unsigned long long a)
+	{
+		return (x + a - 1) / a * a;
+	}
+
+	inline size_t ClusterBytes(long long nv, long long nf)
+	{
+		return static_cast<size_t>(nv * (3 * sizeof(float) * 2 + sizeof(unsigned int) + 1)
+			+ nf * 3 * sizeof(unsigned int));
+	}
+
+	//! lay the arrays of a cluster out on its block
+	void BindCluster(OOCCluster& c, char* data)
+	{
+		c.positions_ = reinterpret_cast<float*>(data);
+		c.normals_ = c.positions_ + 3 * c.num_vertex_;
+		c.global_ids_ = reinterpret_cast<unsigned int*>(c.normals_ + 3 * c.num_vertex_);
+		c.faces_ = c.global_ids_ + c.num_vertex_;
+		c.flags_ = reinterpret_cast<const unsigned char*>(c.faces_ + 3 * c.num_face_);
+	}
+
+	inline unsigned int SpreadBits(unsigned int x)
+	{
+		x &= 0x3ff;
+		x = (x | (x << 16)) & 0x030000ff;
+		x = (x | (x << 8)) & 0x0300f00f;
+		x = (x | (x << 4)) & 0x030c30c3;
+		x = (x | (x << 2)) & 0x09249249;
+		return x;
+	}
+
+	inline unsigned long long EdgeKey(unsigned int a, unsigned int b)
+	{
+		return a < b ? (static_cast<unsigned long long>(a) << 32) | b
+			: (static_cast<unsigned long long>(b) << 32) | a;
+	}
+
+	void ExpandBox(float bbox[6], const float* p)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			bbox[k] = std::min(bbox[k], p[k]);
+			bbox[k+3] = std::max(bbox[k+3], p[k]);
+		}
+	}
+
+	void EmptyBox(float bbox[6])
+	{
+		bbox[0] = bbox[1] = bbox[2] = FLT_MAX;
+		bbox[3] = bbox[4] = bbox[5] = -FLT_MAX;
+	}
+
+	/*!
+	*	Build the clustered file from flat temporary files of positions (3 floats per vertex)
+	*	and triangles (3 vertex ids per face). Every pass streams over mapped files, so the
+	*	memory used is bounded by one cluster and the seam edges, not by the mesh.
+	*/
+	class OOCBuilder
+	{
+	public:
+		OOCBuilder(const std::string& fouts, int faces_per_cluster)
+			: fouts_(fouts), faces_per_cluster_(std::max(faces_per_cluster, 256))
+			, num_vertex_(0), num_face_(0)
+		{
+			EmptyBox(bbox_);
+		}
+
+		std::string verts_name(void) const {return fouts_ + ".verts.tmp";}
+		std::string tris_name(void) const {return fouts_ + ".tris.tmp";}
+
+		void set_counts(long long nv, long long nf, const float bbox[6])
+		{
+			num_vertex_ = nv;
+			num_face_ = nf;
+			memcpy(bbox_, bbox, sizeof(bbox_));
+		}
+
+		bool Run(void)
+		{
+			bool ok = num_vertex_ > 0 && num_face_ > 0
+				&& verts_.Open(verts_name().c_str(), false)
+				&& tris_.Open(tris_name().c_str(), false);
+			if (ok)
+			{
+				vview_ = verts_.Map(0, static_cast<size_t>(num_vertex_ * 3 * sizeof(float)));
+				tview_ = tris_.Map(0, static_cast<size_t>(num_face_ * 3 * sizeof(unsigned int)));
+				ok = vview_.isValid() && tview_.isValid();
+			}
+			ok = ok && Partition() && Bucket() && CountReferences() && FindSeams() && Write();
+
+			verts_.Unmap(vview_);
+			tris_.Unmap(tview_);
+			bucket_.Unmap(bview_);
+			refs_.Unmap(rview_);
+			verts_.Close();
+			tris_.Close();
+			bucket_.Close();
+			refs_.Close();
+			remove(verts_name().c_str());
+			remove(tris_name().c_str());
+			remove((fouts_ + ".bucket.tmp").c_str());
+			remove((fouts_ + ".refs.tmp").c_str());
+			return ok;
+		}
+
+	private:
+		const float* position(unsigned int v) const
+		{
+			return reinterpret_cast<const float*>(vview_.data_) + 3 * static_cast<size_t>(v);
+		}
+		const unsigned int* triangle(long long f) const
+		{
+			return reinterpret_cast<const unsigned int*>(tview_.data_) + 3 * f;
+		}
+
+		//! Morton code of the grid cell of the centroid of a triangle
+		unsigned int CellOf(const unsigned int* tri) const
+		{
+			unsigned int c[3];
+			for (int k = 0; k < 3; k++)
+			{
+				float x = (position(tri[0])[k] + position(tri[1])[k] + position(tri[2])[k]) / 3.0f;
+				float t = (x - bbox_[k]) * inv_cell_[k];
+				int i = static_cast<int>(t);
+				c[k] = static_cast<unsigned int>(std::min(std::max(i, 0), resolution_ - 1));
+			}
+			return SpreadBits(c[0]) | (SpreadBits(c[1]) << 1) | (SpreadBits(c[2]) << 2);
+		}
+
+		//! group the cells of a fine grid along the Morton curve into clusters of balanced size
+		bool Partition(void)
+		{
+			// a surface crosses about resolution^2 cells, aim at 16 cells per cluster
+			long long cells = std::max(num_face_ / faces_per_cluster_, 1LL) * 16;
+			resolution_ = 1;
+			while (resolution_ < 1024 && static_cast<long long>(resolution_) * resolution_ < cells)
+				resolution_ *= 2;
+			for (int k = 0; k < 3; k++)
+			{
+				float extent = bbox_[k+3] - bbox_[k];
+				inv_cell_[k] = extent > 0.0f ? resolution_ / extent : 0.0f;
+			}
+
+			std::map<unsigned int, long long> cell_faces;
+			for (long long f = 0; f < num_face_; f++)
+				cell_faces[CellOf(triangle(f))]++;
+
+			long long acc = 0;
+			for (std::map<unsigned int, long long>::iterator it = cell_faces.begin(); it != cell_faces.end(); ++it)
+			{
+				if (cluster_faces_.empty() || (acc > 0 && acc + it->second > faces_per_cluster_))
+				{
+					cluster_faces_.push_back(0);
+					acc = 0;
+				}
+				acc += it->second;
+				cluster_faces_.back() += it->second;
+				cell_cluster_[it->first] = static_cast<int>(cluster_faces_.size()) - 1;
+			}
+			return true;
+		}
+
+		//! copy the triangles to a temporary file, sorted by cluster
+		bool Bucket(void)
+		{
+			std::string name = fouts_ + ".bucket.tmp";
+			if (!bucket_.Create(name.c_str(), num_face_ * 3 * sizeof(unsigned int)))
+				return false;
+			bview_ = bucket_.Map(0, static_cast<size_t>(num_face_ * 3 * sizeof(unsigned int)));
+			if (!bview_.isValid())
+				return false;
+
+			cluster_first_.resize(cluster_faces_.size() + 1);
+			cluster_first_[0] = 0;
+			for (size_t c = 0; c < cluster_faces_.size(); c++)
+				cluster_first_[c+1] = cluster_first_[c] + cluster_faces_[c];
+
+			std::vector<long long> cursor(cluster_first_.begin(), cluster_first_.end() - 1);
+			unsigned int *out = reinterpret_cast<unsigned int*>(bview_.data_);
+			for (long long f = 0; f < num_face_; f++)
+			{
+				const unsigned int *tri = triangle(f);
+				int c = cell_cluster_[CellOf(tri)];
+				memcpy(out + 3 * cursor[c]++, tri, 3 * sizeof(unsigned int));
+			}
+			tris_.Unmap(tview_);
+			tris_.Close();
+			return true;
+		}
+
+		const unsigned int* cluster_triangles(int c) const
+		{
+			return reinterpret_cast<const unsigned int*>(bview_.data_) + 3 * cluster_first_[c];
+		}
+
+		void ClusterVertices(int c, std::vector<unsigned int>& ids) const
+		{
+			const unsigned int *tris = cluster_triangles(c);
+			ids.assign(tris, tris + 3 * cluster_faces_[c]);
+			std::sort(ids.begin(), ids.end());
+			ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+		}
+
+		//! count the clusters referencing each vertex, saturated at 2
+		bool CountReferences(void)
+		{
+			std::string name = fouts_ + ".refs.tmp";
+			if (!refs_.Create(name.c_str(), num_vertex_))
+				return false;
+			rview_ = refs_.Map(0, static_cast<size_t>(num_vertex_));
+			if (!rview_.isValid())
+				return false;
+			unsigned char *refs = reinterpret_cast<unsigned char*>(rview_.data_);
+			memset(refs, 0, static_cast<size_t>(num_vertex_));
+
+			std::vector<unsigned int> ids;
+			cluster_verts_.resize(cluster_faces_.size());
+			for (int c = 0; c < static_cast<int>(cluster_faces_.size()); c++)
+			{
+				ClusterVertices(c, ids);
+				cluster_verts_[c] = static_cast<long long>(ids.size());
+				for (size_t i = 0; i < ids.size(); i++)
+					if (refs[ids[i]] < 2)
+						refs[ids[i]]++;
+			}
+			return true;
+		}
+
+		bool isShared(unsigned int v) const
+		{
+			return reinterpret_cast<const unsigned char*>(rview_.data_)[v] >= 2;
+		}
+
+		//! edges used by a single triangle of a cluster
+		void OpenEdges(int c, std::vector<unsigned long long>& open) const
+		{
+			const unsigned int *tris = cluster_triangles(c);
+			std::vector<unsigned long long> edges;
+			edges.reserve(static_cast<size_t>(3 * cluster_faces_[c]));
+			for (long long f = 0; f < cluster_faces_[c]; f++)
+				for (int k = 0; k < 3; k++)
+					edges.push_back(EdgeKey(tris[3*f+k], tris[3*f+(k+1)%3]));
+			std::sort(edges.begin(), edges.end());
+			open.clear();
+			for (size_t i = 0; i < edges.size(); )
+			{
+				size_t j = i + 1;
+				while (j < edges.size() && edges[j] == edges[i])
+					++j;
+				if (j - i == 1)
+					open.push_back(edges[i]);
+				i = j;
+			}
+		}
+
+		//! open edges between shared vertices may be inner edges cut by the partition
+		bool FindSeams(void)
+		{
+			std::vector<unsigned long long> open;
+			for (int c = 0; c < static_cast<int>(cluster_faces_.size()); c++)
+			{
+				OpenEdges(c, open);
+				for (size_t i = 0; i < open.size(); i++)
+					if (isShared(static_cast<unsigned int>(open[i] >> 32)) && isShared(static_cast<unsigned int>(open[i])))
+						seam_count_[open[i]]++;
+			}
+			return true;
+		}
+
+		bool Write(void)
+		{
+			int nc = static_cast<int>(cluster_faces_.size());
+			std::vector<OOCClusterInfo> table(nc);
+			unsigned long long offset = AlignUp(kOOCTableOffset + nc * sizeof(OOCClusterInfo), kOOCAlignment);
+			for (int c = 0; c < nc; c++)
+			{
+				table[c].offset_ = offset;
+				table[c].bytes_ = ClusterBytes(cluster_verts_[c], cluster_faces_[c]);
+				table[c].num_vertex_ = static_cast<int>(cluster_verts_[c]);
+				table[c].num_face_ = static_cast<int>(cluster_faces_[c]);
+				offset = AlignUp(offset + table[c].bytes_, kOOCAlignment);
+			}
+
+			MappedFile out;
+			if (!out.Create(fouts_.c_str(), offset))
+				return false;
+
+			std::vector<unsigned int> ids;
+			std::vector<unsigned long long> open;
+			for (int c = 0; c < nc; c++)
+			{
+				MappedView view = out.Map(table[c].offset_, static_cast<size_t>(table[c].bytes_));
+				if (!view.isValid())
+					return false;
+				OOCCluster cluster;
+				cluster.id_ = c;
+				cluster.num_vertex_ = table[c].num_vertex_;
+				cluster.num_face_ = table[c].num_face_;
+				BindCluster(cluster, view.data_);
+
+				ClusterVertices(c, ids);
+				unsigned char *flags = const_cast<unsigned char*>(cluster.flags_);
+				EmptyBox(table[c].bbox_);
+				for (size_t i = 0; i < ids.size(); i++)
+				{
+					memcpy(cluster.positions_ + 3 * i, position(ids[i]), 3 * sizeof(float));
+					ExpandBox(table[c].bbox_, cluster.positions_ + 3 * i);
+					flags[i] = isShared(ids[i]) ? OOC_SHARED : 0;
+				}
+				memset(cluster.normals_, 0, 3 * sizeof(float) * ids.size());
+				memcpy(const_cast<unsigned int*>(cluster.global_ids_), &ids[0], sizeof(unsigned int) * ids.size());
+
+				const unsigned int *tris = cluster_triangles(c);
+				unsigned int *faces = const_cast<unsigned int*>(cluster.faces_);
+				for (long long k = 0; k < 3 * cluster_faces_[c]; k++)
+					faces[k] = static_cast<unsigned int>(std::lower_bound(ids.begin(), ids.end(), tris[k]) - ids.begin());
+
+				OpenEdges(c, open);
+				for (size_t i = 0; i < open.size(); i++)
+				{
+					std::unordered_map<unsigned long long, int>::const_iterator it = seam_count_.find(open[i]);
+					if (it != seam_count_.end() && it->second > 1)
+						continue;
+					unsigned int a = static_cast<unsigned int>(open[i] >> 32), b = static_cast<unsigned int>(open[i]);
+					flags[std::lower_bound(ids.begin(), ids.end(), a) - ids.begin()] |= OOC_BOUNDARY;
+					flags[std::lower_bound(ids.begin(), ids.end(), b) - ids.begin()] |= OOC_BOUNDARY;
+				}
+				out.Unmap(view);
+			}
+
+			MappedView head = out.Map(0, kOOCTableOffset + nc * sizeof(OOCClusterInfo));
+			if (!head.isValid())
+				return false;
+			OOCHeader header;
+			memset(&header, 0, sizeof(header));
+			memcpy(header.magic_, kOOCMagic, 4);
+			header.version_ = kOOCVersion;
+			header.num_vertex_ = num_vertex_;
+			header.num_face_ = num_face_;
+			header.num_cluster_ = nc;
+			memcpy(header.bbox_, bbox_, sizeof(bbox_));
+			memcpy(head.data_, &header, sizeof(header));
+			if (nc > 0)
+				memcpy(head.data_ + kOOCTableOffset, &table[0], nc * sizeof(OOCClusterInfo));
+			out.Flush(head);
+			out.Unmap(head);
+			return true;
+		}
+
+	private:
+		std::string					fouts_;
+		long long					faces_per_cluster_;
+		long long					num_vertex_;
+		long long					num_face_;
+		float						bbox_[6];
+
+		MappedFile					verts_, tris_, bucket_, refs_;
+		MappedView					vview_, tview_, bview_, rview_;
+
+		int							resolution_;
+		float						inv_cell_[3];
+		std::unordered_map<unsigned int, int>	cell_cluster_;
+		std::vector<long long>		cluster_faces_;
+		std::vector<long long>		cluster_first_;
+		std::vector<long long>		cluster_verts_;
+		std::unordered_map<unsigned long long, int>	seam_count_;
+	};
+}
+
+OutOfCoreMesh::OutOfCoreMesh(void)
+	: memory_cap_(kOOCDefaultCap), memory_in_use_(0), num_loads_(0), num_vertex_(0), num_face_(0)
+{
+	EmptyBox(bbox_);
+}
+
+OutOfCoreMesh::~OutOfCoreMesh(void)
+{
+	Close();
+}
+
+bool OutOfCoreMesh::BuildFromOBJFile(const char* fins, const char* fouts, int faces_per_cluster)
+{
+	MeshStreamReader reader;
+	if (!reader.Open(fins))
+	{
+		return false;
+	}
+	OOCBuilder builder(fouts, faces_per_cluster);
+	FILE *pverts = fopen(builder.verts_name().c_str(), "wb");
+	FILE *ptris = fopen(builder.tris_name().c_str(), "wb");
+	if (pverts == NULL || ptris == NULL)
+	{
+		if (pverts != NULL) fclose(pverts);
+		if (ptris != NULL) fclose(ptris);
+		return false;
+	}
+
+	float bbox[6];
+	EmptyBox(bbox);
+	long long nf = 0;
+	Vec3f v;
+	std::vector<int> face;
+	MeshStreamRecord record;
+	while ((record = reader.Next(v, face)) != MS_END)
+	{
+		if (record == MS_VERTEX)
+		{
+			fwrite(v.data(), sizeof(float), 3, pverts);
+			ExpandBox(bbox, v.data());
+			continue;
+		}
+		// only backward references, as the vertices are written as they come
+		bool valid = true;
+		for (size_t i = 0; i < face.size(); i++)
+			valid = valid && face[i] >= 0 && face[i] < reader.num_vertex();
+		if (!valid)
+			continue;
+		for (size_t i = 1; i + 1 < face.size(); i++)
+		{
+			unsigned int tri[3] = {static_cast<unsigned int>(face[0]),
+				static_cast<unsigned int>(face[i]), static_cast<unsigned int>(face[i+1])};
+			if (tri[0] == tri[1] || tri[1] == tri[2] || tri[2] == tri[0])
+				continue;
+			fwrite(tri, sizeof(unsigned int), 3, ptris);
+			nf++;
+		}
+	}
+	fclose(pverts);
+	fclose(ptris);
+
+	builder.set_counts(reader.num_vertex(), nf, bbox);
+	return builder.Run();
+}
+
+bool OutOfCoreMesh::BuildFromMesh(Mesh3D* mesh, const char* fouts, int faces_per_cluster)
+{
+	if (mesh == NULL || !mesh->isValid())
+	{
+		return false;
+	}
+	OOCBuilder builder(fouts, faces_per_cluster);
+	FILE *pverts = fopen(builder.verts_name().c_str(), "wb");
+	FILE *ptris = fopen(builder.tris_name().c_str(), "wb");
+	if (pverts == NULL || ptris == NULL)
+	{
+		if (pverts != NULL) fclose(pverts);
+		if (ptris != NULL) fclose(ptris);
+		return false;
+	}
+
+	float bbox[6];
+	EmptyBox(bbox);
+	std::vector<HE_vert*>& verts = *(mesh->get_vertex_list());
+	for (size_t i = 0; i < verts.size(); i++)
+	{
+		Vec3f p = verts[i]->position();
+		fwrite(p.data(), sizeof(float), 3, pverts);
+		ExpandBox(bbox, p.data());
+	}
+
+	long long nf = 0;
+	std::vector<HE_face*>& faces = *(mesh->get_faces_list());
+	for (size_t i = 0; i < faces.size(); i++)
+	{
+		HE_edge *first = faces[i]->pedge_;
+		HE_edge *pedge = first->pnext_;
+		while (pedge->pnext_ != first)
+		{
+			unsigned int tri[3] = {static_cast<unsigned int>(first->pvert_->id()),
+				static_cast<unsigned int>(pedge->pvert_->id()), static_cast<unsigned int>(pedge->pnext_->pvert_->id())};
+			fwrite(tri, sizeof(unsigned int), 3, ptris);
+			nf++;
+			pedge = pedge->pnext_;
+		}
+	}
+	fclose(pverts);
+	fclose(ptris);
+
+	builder.set_counts(static_cast<long long>(verts.size()), nf, bbox);
+	return builder.Run();
+}
+
+bool OutOfCoreMesh::Open(const char* fins, bool writable)
+{
+	Close();
+	if (!file_.Open(fins, writable))
+	{
+		return false;
+	}
+	OOCHeader header;
+	MappedView view = file_.Map(0, sizeof(OOCHeader));
+	if (!view.isValid())
+	{
+		file_.Close();
+		return false;
+	}
+	memcpy(&header, view.data_, sizeof(header));
+	file_.Unmap(view);
+	if (memcmp(header.magic_, kOOCMagic, 4) != 0 || header.version_ != kOOCVersion || header.num_cluster_ < 0)
+	{
+		file_.Close();
+		return false;
+	}
+
+	table_view_ = file_.Map(0, kOOCTableOffset + header.num_cluster_ * sizeof(OOCClusterInfo));
+	if (!table_view_.isValid())
+	{
+		file_.Close();
+		return false;
+	}
+	const OOCClusterInfo *table = reinterpret_cast<const OOCClusterInfo*>(table_view_.data_ + kOOCTableOffset);
+	clusters_.assign(table, table + header.num_cluster_);
+	slots_.resize(clusters_.size());
+	for (size_t i = 0; i < slots_.size(); i++)
+	{
+		slots_[i].pins_ = 0;
+		slots_[i].loaded_ = false;
+	}
+	num_vertex_ = header.num_vertex_;
+	num_face_ = header.num_face_;
+	memcpy(bbox_, header.bbox_, sizeof(bbox_));
+	num_loads_ = 0;
+	return true;
+}
+
+void OutOfCoreMesh::Close(void)
+{
+	for (int i = 0; i < static_cast<int>(slots_.size()); i++)
+	{
+		if (slots_[i].loaded_)
+		{
+			UnloadCluster(i);
+		}
+	}
+	if (table_view_.isValid())
+	{
+		file_.Unmap(table_view_);
+	}
+	file_.Close();
+	clusters_.clear();
+	slots_.clear();
+	lru_.clear();
+	memory_in_use_ = 0;
+	num_vertex_ = num_face_ = 0;
+	EmptyBox(bbox_);
+}
+
+void OutOfCoreMesh::UnloadCluster(int id)
+{
+	CacheSlot& slot = slots_[id];
+	memory_in_use_ -= slot.view_.length_;
+	file_.Unmap(slot.view_);
+	lru_.erase(slot.lru_it_);
+	slot.loaded_ = false;
+	slot.pins_ = 0;
+}
+
+void OutOfCoreMesh::EvictFor(size_t bytes)
+{
+	std::list<int>::iterator it = lru_.end();
+	while (memory_in_use_ + bytes > memory_cap_ && it != lru_.begin())
+	{
+		--it;
+		int id = *it;
+		if (slots_[id].pins_ > 0)
+		{
+			continue;
+		}
+		// erasing invalidates it, restart from the element after it
+		std::list<int>::iterator next = it;
+		++next;
+		UnloadCluster(id);
+		it = next;
+	}
+}
+
+OOCCluster* OutOfCoreMesh::AcquireCluster(int id)
+{
+	if (id < 0 || id >= num_cluster())
+	{
+		return NULL;
+	}
+	std::lock_guard<std::mutex> lock(cache_mutex_);
+	CacheSlot& slot = slots_[id];
+	if (slot.loaded_)
+	{
+		slot.pins_++;
+		lru_.splice(lru_.begin(), lru_, slot.lru_it_);
+		return &slot.cluster_;
+	}
+
+	const OOCClusterInfo& info = clusters_[id];
+	EvictFor(static_cast<size_t>(info.bytes_));
+	slot.view_ = file_.Map(info.offset_, static_cast<size_t>(info.bytes_));
+	if (!slot.view_.isValid())
+	{
+		return NULL;
+	}
+	slot.cluster_.id_ = id;
+	slot.cluster_.num_vertex_ = info.num_vertex_;
+	slot.cluster_.num_face_ = info.num_face_;
+	BindCluster(slot.cluster_, slot.view_.data_);
+	slot.loaded_ = true;
+	slot.pins_ = 1;
+	lru_.push_front(id);
+	slot.lru_it_ = lru_.begin();
+	memory_in_use_ += slot.view_.length_;
+	num_loads_++;
+	return &slot.cluster_;
+}
+
+void OutOfCoreMesh::ReleaseCluster(int id)
+{
+	std::lock_guard<std::mutex> lock(cache_mutex_);
+	if (id >= 0 && id < num_cluster() && slots_[id].pins_ > 0)
+	{
+		slots_[id].pins_--;
+	}
+}
+
+void OutOfCoreMesh::ForEachCluster(const ClusterFunc& func)
+{
+	for (int i = 0; i < num_cluster(); i++)
+	{
+		OOCCluster *cluster = AcquireCluster(i);
+		if (cluster == NULL)
+		{
+			continue;
+		}
+		func(*cluster);
+		ReleaseCluster(i);
+	}
+}
+
+void OutOfCoreMesh::ComputeBoundingBox(void)
+{
+	EmptyBox(bbox_);
+	ForEachCluster([this](OOCCluster& c)
+	{
+		float *box = clusters_[c.id_].bbox_;
+		EmptyBox(box);
+		for (int i = 0; i < c.num_vertex_; i++)
+			ExpandBox(box, c.positions_ + 3 * i);
+		ExpandBox(bbox_, box);
+		ExpandBox(bbox_, box + 3);
+	});
+
+	if (file_.writable() && num_cluster() > 0)
+	{
+		OOCHeader *header = reinterpret_cast<OOCHeader*>(table_view_.data_);
+		memcpy(header->bbox_, bbox_, sizeof(bbox_));
+		memcpy(table_view_.data_ + kOOCTableOffset, &clusters_[0], clusters_.size() * sizeof(OOCClusterInfo));
+	}
+}
+
+bool OutOfCoreMesh::ComputeVertexNormals(void)
+{
+	if (!file_.writable())
+	{
+		return false;
+	}
+
+	// sum the face normals per cluster, collecting the partial sums of the seam vertices
+	std::unordered_map<unsigned int, Vec3f> shared;
+	ForEachCluster([&shared](OOCCluster& c)
+	{
+		Vec3f *pos = reinterpret_cast<Vec3f*>(c.positions_);
+		Vec3f *nor = reinterpret_cast<Vec3f*>(c.normals_);
+		for (int i = 0; i < c.num_vertex_; i++)
+			nor[i] = Vec3f(0.0f, 0.0f, 0.0f);
+		for (int f = 0; f < c.num_face_; f++)
+		{
+			const unsigned int *tri = c.faces_ + 3 * f;
+			Vec3f n = (pos[tri[1]] - pos[tri[0]]) ^ (pos[tri[2]] - pos[tri[0]]);
+			for (int k = 0; k < 3; k++)
+				nor[tri[k]] += n;
+		}
+		for (int i = 0; i < c.num_vertex_; i++)
+			if (c.flags_[i] & OOC_SHARED)
+				shared[c.global_ids_[i]] += nor[i];
+	});
+
+	ForEachCluster([&shared](OOCCluster& c)
+	{
+		Vec3f *nor = reinterpret_cast<Vec3f*>(c.normals_);
+		for (int i = 0; i < c.num_vertex_; i++)
+		{
+			if (c.flags_[i] & OOC_SHARED)
+				nor[i] = shared[c.global_ids_[i]];
+			float len = nor[i].length();
+			if (len > 0.0f)
+				nor[i] /= len;
+		}
+	});
+	return true;
+}
+
+bool OutOfCoreMesh::LaplacianSmooth(int iterations, float lambda)
+{
+	if (!file_.writable())
+	{
+		return false;
+	}
+
+	struct SeamSum
+	{
+		Vec3f	sum_;
+		int		count_;
+		bool	fixed_;
+
+		SeamSum() : sum_(0.0f, 0.0f, 0.0f), count_(0), fixed_(false) {}
+	};
+
+	std::unordered_map<unsigned int, SeamSum> shared;
+	std::vector<Vec3f> sum;
+	std::vector<int> count;
+	for (int iter = 0; iter < iterations; iter++)
+	{
+		shared.clear();
+
+		// every inner edge is seen from its two triangles, so the umbrella of a vertex is
+		// the sum over its triangles of the two other corners
+		ForEachCluster([&](OOCCluster& c)
+		{
+			Vec3f *pos = reinterpret_cast<Vec3f*>(c.positions_);
+			sum.assign(c.num_vertex_, Vec3f(0.0f, 0.0f, 0.0f));
+			count.assign(c.num_vertex_, 0);
+			for (int f = 0; f < c.num_face_; f++)
+			{
+				const unsigned int *tri = c.faces_ + 3 * f;
+				for (int k = 0; k < 3; k++)
+				{
+					sum[tri[k]] += pos[tri[(k+1)%3]] + pos[tri[(k+2)%3]];
+					count[tri[k]] += 2;
+				}
+			}
+			for (int i = 0; i < c.num_vertex_; i++)
+			{
+				if (c.flags_[i] & OOC_SHARED)
+				{
+					// seam vertices are moved once all their clusters are summed
+					SeamSum& s = shared[c.global_ids_[i]];
+					s.sum_ += sum[i];
+					s.count_ += count[i];
+					s.fixed_ = s.fixed_ || (c.flags_[i] & OOC_BOUNDARY) != 0;
+				}
+				else if (!(c.flags_[i] & OOC_BOUNDARY) && count[i] > 0)
+				{
+					sum[i] = pos[i] + lambda * (sum[i] / static_cast<float>(count[i]) - pos[i]);
+				}
+				else
+				{
+					sum[i] = pos[i];
+				}
+			}
+			for (int i = 0; i < c.num_vertex_; i++)
+				if (!(c.flags_[i] & OOC_SHARED))
+					pos[i] = sum[i];
+		});
+
+		ForEachCluster([&shared, lambda](OOCCluster& c)
+		{
+			Vec3f *pos = reinterpret_cast<Vec3f*>(c.positions_);
+			for (int i = 0; i < c.num_vertex_; i++)
+			{
+				if (!(c.flags_[i] & OOC_SHARED))
+					continue;
+				const SeamSum& s = shared[c.global_ids_[i]];
+				if (!s.fixed_ && s.count_ > 0)
+					pos[i] += lambda * (s.sum_ / static_cast<float>(s.count_) - pos[i]);
+			}
+		});
+	}
+	return true;
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <vector>
+#include <list>
+#include <mutex>
+#include <functional>
+#include "MappedFile.h"
+
+class Mesh3D;
+
+enum OOCVertexFlag
+{
+	OOC_SHARED = 1,			//!< the vertex is also stored in other clusters
+	OOC_BOUNDARY = 2		//!< the vertex is on the boundary of the whole mesh
+};
+
+//! entry of the cluster table
+struct OOCClusterInfo
+{
+	unsigned long long	offset_;		//!< position of the cluster block in the file
+	unsigned long long	bytes_;			//!< size of the block
+	int					num_vertex_;
+	int					num_face_;
+	float				bbox_[6];		//!< xmin, ymin, zmin, xmax, ymax, zmax
+};
+
+/*!
+*	A cluster loaded in memory. The arrays point into the mapped file, so writing
+*	positions_ or normals_ writes the file when the mesh was opened writable.
+*/
+struct OOCCluster
+{
+	int					id_;
+	int					num_vertex_;
+	int					num_face_;
+	float				*positions_;	//!< 3 floats per vertex
+	float				*normals_;		//!< 3 floats per vertex
+	const unsigned int	*global_ids_;	//!< index of each local vertex in the whole mesh
+	const unsigned int	*faces_;		//!< 3 local vertex indices per triangle
+	const unsigned char	*flags_;		//!< OOCVertexFlag bits per vertex
+};
+
+/*!
+*	Out-of-core triangle mesh for meshes larger than the memory.
+*	The mesh is partitioned spatially into clusters of about the same number of triangles;
+*	each cluster is a page-aligned block of a memory-mapped file holding its vertices (with
+*	their global ids), normals and local triangles. Vertices on cluster seams are duplicated
+*	and flagged OOC_SHARED. Clusters are mapped on demand through an LRU cache whose total
+*	size is bounded by a memory cap, and algorithms stream over the clusters one at a time.
+*/
+class OutOfCoreMesh
+{
+public:
+	typedef std::function<void(OOCCluster&)> ClusterFunc;
+
+public:
+	OutOfCoreMesh(void);
+	~OutOfCoreMesh(void);
+
+	//! build a clustered file from an OBJ file without loading it in memory
+	/*!
+	*	\param faces_per_cluster the targeted number of triangles per cluster
+	*	\return false if a file cannot be read or written
+	*/
+	static bool BuildFromOBJFile(const char* fins, const char* fouts, int faces_per_cluster = 65536);
+	//! build a clustered file from a mesh in memory, polygons are split into fans
+	static bool BuildFromMesh(Mesh3D* mesh, const char* fouts, int faces_per_cluster = 65536);
+
+	//! open a clustered file, writable to let algorithms update positions and normals
+	bool Open(const char* fins, bool writable);
+	void Close(void);
+
+	//! upper bound of the mapped cluster data, in bytes
+	void set_memory_cap(size_t bytes) {memory_cap_ = bytes;}
+	size_t memory_cap(void) const {return memory_cap_;}
+	size_t memory_in_use(void) const {return memory_in_use_;}
+	//! number of clusters mapped from the file since Open
+	long long num_cluster_loads(void) const {return num_loads_;}
+
+	int num_cluster(void) const {return static_cast<int>(clusters_.size());}
+	long long num_vertex(void) const {return num_vertex_;}
+	long long num_face(void) const {return num_face_;}
+	const OOCClusterInfo& cluster_info(int id) const {return clusters_[id];}
+	const float* bounding_box(void) const {return bbox_;}
+
+	//! map a cluster and pin it in the cache until ReleaseCluster
+	OOCCluster* AcquireCluster(int id);
+	void ReleaseCluster(int id);
+
+	//! call func on every cluster, one at a time
+	void ForEachCluster(const ClusterFunc& func);
+
+	//! recompute the bounding boxes of the clusters and of the whole mesh
+	void ComputeBoundingBox(void);
+	//! compute area weighted vertex normals, consistent across cluster seams
+	/*!
+	*	\return false if the file is opened read-only
+	*/
+	bool ComputeVertexNormals(void);
+	//! uniform Laplacian smoothing with fixed boundary, in Jacobi style
+	/*!
+	*	\param lambda the fraction of the Laplacian added per iteration
+	*	\return false if the file is opened read-only
+	*/
+	bool LaplacianSmooth(int iterations, float lambda);
+
+private:
+	struct CacheSlot
+	{
+		MappedView				view_;
+		OOCCluster				cluster_;
+		int						pins_;
+		bool					loaded_;
+		std::list<int>::iterator lru_it_;
+	};
+
+	//! unmap unpinned clusters, least recently used first, until bytes more fit in the cap
+	void EvictFor(size_t bytes);
+	void UnloadCluster(int id);
+
+private:
+	MappedFile					file_;
+	MappedView					table_view_;		//!< header and cluster table, mapped for the whole session
+	std::vector<OOCClusterInfo>	clusters_;
+	std::vector<CacheSlot>		slots_;
+	std::list<int>				lru_;				//!< loaded clusters, most recently used first
+	std::mutex					cache_mutex_;
+
+	size_t						memory_cap_;
+	size_t						memory_in_use_;
+	long long					num_loads_;
+	long long					num_vertex_;
+	long long					num_face_;
+	float						bbox_[6];
+};
@@ -0,0 +1,118 @@
+#include "PolygonTriangulator.h"
+
+#include <cmath>
+
+namespace
+{
+	struct Point2
+	{
+		double x_, y_;
+	};
+
+	inline double Cross(const Point2& a, const Point2& b, const Point2& c)
+	{
+		return (b.x_ - a.x_) * (c.y_ - a.y_) - (b.y_ - a.y_) * (c.x_ - a.x_);
+	}
+
+	//! whether p is inside or on the counterclockwise triangle abc
+	inline bool isInside(const Point2& p, const Point2& a, const Point2& b, const Point2& c)
+	{
+		return Cross(a, b, p) >= 0.0 && Cross(b, c, p) >= 0.0 && Cross(c, a, p) >= 0.0;
+	}
+
+	void Fan(int n, std::vector<int>& triangles)
+	{
+		for (int i = 1; i + 1 < n; i++)
+		{
+			triangles.push_back(0);
+			triangles.push_back(i);
+			triangles.push_back(i + 1);
+		}
+	}
+}
+
+void TriangulatePolygon(const std::vector<Vec3f>& polygon, std::vector<int>& triangles)
+{
+	triangles.clear();
+	int n = static_cast<int>(polygon.size());
+	if (n < 3)
+	{
+		return;
+	}
+	if (n == 3)
+	{
+		Fan(n, triangles);
+		return;
+	}
+
+	// Newell normal, then drop its dominant axis
+	double normal[3] = {0.0, 0.0, 0.0};
+	for (int i = 0; i < n; i++)
+	{
+		const Vec3f& a = polygon[i];
+		const Vec3f& b = polygon[(i + 1) % n];
+		normal[0] += (a[1] - b[1]) * (a[2] + b[2]);
+		normal[1] += (a[2] - b[2]) * (a[0] + b[0]);
+		normal[2] += (a[0] - b[0]) * (a[1] + b[1]);
+	}
+	int axis = 2;
+	if (fabs(normal[0]) > fabs(normal[1]) && fabs(normal[0]) > fabs(normal[2]))
+		axis = 0;
+	else if (fabs(normal[1]) > fabs(normal[2]))
+		axis = 1;
+	int u = (axis + 1) % 3, v = (axis + 2) % 3;
+	// keep the projection counterclockwise
+	double sign = normal[axis] < 0.0 ? -1.0 : 1.0;
+
+	std::vector<Point2> points(n);
+	for (int i = 0; i < n; i++)
+	{
+		points[i].x_ = polygon[i][u];
+		points[i].y_ = sign * polygon[i][v];
+	}
+
+	bool convex = true;
+	for (int i = 0; i < n && convex; i++)
+		convex = Cross(points[(i + n - 1) % n], points[i], points[(i + 1) % n]) >= 0.0;
+	if (convex)
+	{
+		Fan(n, triangles);
+		return;
+	}
+
+	// ear clipping
+	std::vector<int> ring(n);
+	for (int i = 0; i < n; i++)
+		ring[i] = i;
+	int misses = 0;
+	for (int i = 0; ring.size() > 3; )
+	{
+		int m = static_cast<int>(ring.size());
+		int prev = ring[(i + m - 1) % m], cur = ring[i % m], next = ring[(i + 1) % m];
+		bool ear = Cross(points[prev], points[cur], points[next]) > 0.0;
+		for (int k = 0; k < m && ear; k++)
+		{
+			int p = ring[k];
+			if (p != prev && p != cur && p != next && isInside(points[p], points[prev], points[cur], points[next]))
+				ear = false;
+		}
+		if (ear || misses >= m)
+		{
+			// no ear left means a self-intersecting polygon, cut the corner anyway
+			triangles.push_back(prev);
+			triangles.push_back(cur);
+			triangles.push_back(next);
+			ring.erase(ring.begin() + i % m);
+			i = (i % m + m - 1) % (m - 1);
+			misses = 0;
+		}
+		else
+		{
+			i = (i + 1) % m;
+			misses++;
+		}
+	}
+	triangles.push_back(ring[0]);
+	triangles.push_back(ring[1]);
+	triangles.push_back(ring[2]);
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <vector>
+#include "Vec.h"
+
+typedef trimesh::vec3  Vec3f;
+
+//! split a polygon into triangles
+/*!
+*	Convex polygons are split into a fan; concave ones by ear clipping, in the plane
+*	that best fits the polygon. The triangles keep the orientation of the polygon.
+*	\param polygon the corners of the polygon, in order
+*	\param triangles receives 3 indices into polygon per triangle
+*/
+void TriangulatePolygon(const std::vector<Vec3f>& polygon, std::vector<int>& triangles);
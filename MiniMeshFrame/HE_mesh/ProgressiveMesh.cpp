@@ -0,0 +1,600 @@
+#include "ProgressiveMesh.h"
+#include "Quadric.h"
+
+#include <queue>
+#include <cstring>
+#include <algorithm>
+#include <sys/stat.h>
+
+namespace
+{
+	const char kPMMagic[4] = {'P', 'M', 'F', '1'};
+	//! the header, and the least a vertex split takes: parent, position and the two counts
+	const long long kPMHeaderBytes = 4 + 5 * sizeof(int);
+	const long long kPMSplitBytes = 4 * sizeof(int) + 3 * sizeof(float);
+
+	struct Collapse
+	{
+		double	cost_;
+		int		from_, to_;
+		int		stamp_from_, stamp_to_;
+
+		bool operator < (const Collapse& c) const { return cost_ > c.cost_; }
+	};
+
+	//! a recorded half-edge collapse from_ -> to_, in original indices
+	struct CollapseRecord
+	{
+		int					from_, to_;
+		std::vector<int>	moved_faces_;
+		std::vector<int>	removed_faces_;
+		std::vector<int>	removed_corners_;	//!< corners of the removed faces before the collapse
+	};
+
+	/*!
+	*	Half-edge collapse simplification of an indexed triangle mesh.
+	*/
+	class PMSimplifier
+	{
+	public:
+		PMSimplifier(const std::vector<Vec3f>& verts, const std::vector<int>& faces)
+			: verts_(verts), faces_(faces)
+		{
+			int nv = static_cast<int>(verts_.size());
+			int nf = static_cast<int>(faces_.size()) / 3;
+			vert_alive_.assign(nv, true);
+			face_alive_.assign(nf, true);
+			stamps_.assign(nv, 0);
+			vert_faces_.resize(nv);
+			for (int f = 0; f < nf; f++)
+				for (int k = 0; k < 3; k++)
+					vert_faces_[faces_[3*f+k]].push_back(f);
+			num_alive_faces_ = nf;
+			InitQuadrics();
+		}
+
+		void Run(int target_faces, std::vector<CollapseRecord>& records)
+		{
+			for (int v = 0; v < static_cast<int>(verts_.size()); v++)
+				PushCandidates(v);
+
+			while (!heap_.empty() && num_alive_faces_ > target_faces)
+			{
+				Collapse c = heap_.top();
+				heap_.pop();
+				if (!vert_alive_[c.from_] || !vert_alive_[c.to_]
+					|| stamps_[c.from_] != c.stamp_from_ || stamps_[c.to_] != c.stamp_to_)
+				{
+					continue;
+				}
+				if (!IsValid(c.from_, c.to_))
+				{
+					continue;
+				}
+				records.push_back(CollapseRecord());
+				DoCollapse(c.from_, c.to_, records.back());
+			}
+		}
+
+		bool vert_alive(int v) const {return vert_alive_[v];}
+		bool face_alive(int f) const {return face_alive_[f];}
+		const std::vector<int>& faces(void) const {return faces_;}
+
+	private:
+		Vec3f FaceNormal(int a, int b, int c) const
+		{
+			return (verts_[b] - verts_[a]) ^ (verts_[c] - verts_[a]);
+		}
+
+		void InitQuadrics(void)
+		{
+			quadrics_.assign(verts_.size(), Quadric());
+			int nf = static_cast<int>(faces_.size()) / 3;
+			for (int f = 0; f < nf; f++)
+			{
+				const int *pf = &faces_[3*f];
+				Vec3f n = FaceNormal(pf[0], pf[1], pf[2]);
+				double area = n.length();
+				if (area <= 0.0)
+					continue;
+				n /= static_cast<float>(area);
+				double d = -(n DOT verts_[pf[0]]);
+				for (int k = 0; k < 3; k++)
+					quadrics_[pf[k]].AddPlane(n[0], n[1], n[2], d, area);
+
+				// boundary edges get a perpendicular plane that keeps the border in place
+				for (int k = 0; k < 3; k++)
+				{
+					int a = pf[k], b = pf[(k+1)%3];
+					if (CountSharedFaces(a, b) != 1)
+						continue;
+					Vec3f e = verts_[b] - verts_[a];
+					Vec3f bn = e ^ n;
+					double l = bn.length();
+					if (l <= 0.0)
+						continue;
+					bn /= static_cast<float>(l);
+					double bd = -(bn DOT verts_[a]);
+					quadrics_[a].AddPlane(bn[0], bn[1], bn[2], bd, 10.0 * e.length() * e.length());
+					quadrics_[b].AddPlane(bn[0], bn[1], bn[2], bd, 10.0 * e.length() * e.length());
+				}
+			}
+		}
+
+		bool FaceHas(int f, int v) const
+		{
+			return faces_[3*f] == v || faces_[3*f+1] == v || faces_[3*f+2] == v;
+		}
+
+		int CountSharedFaces(int a, int b) const
+		{
+			int count = 0;
+			for (size_t i = 0; i != vert_faces_[a].size(); ++i)
+			{
+				int f = vert_faces_[a][i];
+				if (face_alive_[f] && FaceHas(f, b))
+					count++;
+			}
+			return count;
+		}
+
+		void Neighbors(int v, std::vector<int>& neighbors) const
+		{
+			neighbors.clear();
+			for (size_t i = 0; i != vert_faces_[v].size(); ++i)
+			{
+				int f = vert_faces_[v][i];
+				if (!face_alive_[f])
+					continue;
+				for (int k = 0; k < 3; k++)
+				{
+					int w = faces_[3*f+k];
+					if (w != v && std::find(neighbors.begin(), neighbors.end(), w) == neighbors.end())
+						neighbors.push_back(w);
+				}
+			}
+		}
+
+		bool IsBoundary(int v) const
+		{
+			std::vector<int> neighbors;
+			Neighbors(v, neighbors);
+			for (size_t i = 0; i != neighbors.size(); ++i)
+				if (CountSharedFaces(v, neighbors[i]) == 1)
+					return true;
+			return false;
+		}
+
+		void PushCandidates(int v)
+		{
+			std::vector<int> neighbors;
+			Neighbors(v, neighbors);
+			for (size_t i = 0; i != neighbors.size(); ++i)
+			{
+				int w = neighbors[i];
+				Quadric q = quadrics_[v];
+				q.Add(quadrics_[w]);
+
+				Collapse c;
+				c.cost_ = q.Error(verts_[w]);
+				c.from_ = v;
+				c.to_ = w;
+				c.stamp_from_ = stamps_[v];
+				c.stamp_to_ = stamps_[w];
+				heap_.push(c);
+			}
+		}
+
+		bool IsValid(int from, int to) const
+		{
+			int shared = CountSharedFaces(from, to);
+			if (shared != 1 && shared != 2)
+				return false;
+			if (shared == 2 && IsBoundary(from))
+				return false;
+			if (num_alive_faces_ - shared < 4)
+				return false;
+
+			// link condition: the common neighbors are exactly the apexes of the shared faces
+			std::vector<int> nfrom, nto;
+			Neighbors(from, nfrom);
+			Neighbors(to, nto);
+			int common = 0;
+			for (size_t i = 0; i != nfrom.size(); ++i)
+				if (std::find(nto.begin(), nto.end(), nfrom[i]) != nto.end())
+					common++;
+			if (common != shared)
+				return false;
+
+			// the faces that only move must not flip or degenerate
+			for (size_t i = 0; i != vert_faces_[from].size(); ++i)
+			{
+				int f = vert_faces_[from][i];
+				if (!face_alive_[f] || FaceHas(f, to))
+					continue;
+				int c[3] = {faces_[3*f], faces_[3*f+1], faces_[3*f+2]};
+				Vec3f nold = FaceNormal(c[0], c[1], c[2]);
+				for (int k = 0; k < 3; k++)
+					if (c[k] == from)
+						c[k] = to;
+				Vec3f nnew = FaceNormal(c[0], c[1], c[2]);
+				float lold = nold.length(), lnew = nnew.length();
+				if (lnew <= 1e-12f * (lold + 1e-12f))
+					return false;
+				if ((nold DOT nnew) < 0.2f * lold * lnew)
+					return false;
+			}
+			return true;
+		}
+
+		void DoCollapse(int from, int to, CollapseRecord& record)
+		{
+			record.from_ = from;
+			record.to_ = to;
+
+			std::vector<int> affected;
+			Neighbors(from, affected);
+
+			for (size_t i = 0; i != vert_faces_[from].size(); ++i)
+			{
+				int f = vert_faces_[from][i];
+				if (!face_alive_[f])
+					continue;
+				if (FaceHas(f, to))
+				{
+					record.removed_faces_.push_back(f);
+					for (int k = 0; k < 3; k++)
+						record.removed_corners_.push_back(faces_[3*f+k]);
+					face_alive_[f] = false;
+					num_alive_faces_--;
+				}
+				else
+				{
+					record.moved_faces_.push_back(f);
+					for (int k = 0; k < 3; k++)
+						if (faces_[3*f+k] == from)
+							faces_[3*f+k] = to;
+					vert_faces_[to].push_back(f);
+				}
+			}
+			vert_alive_[from] = false;
+			vert_faces_[from].clear();
+			quadrics_[to].Add(quadrics_[from]);
+
+			// drop dead faces from the adjacency of to, then refresh all the touched vertices
+			std::vector<int>& tfaces = vert_faces_[to];
+			size_t j = 0;
+			for (size_t i = 0; i != tfaces.size(); ++i)
+				if (face_alive_[tfaces[i]])
+					tfaces[j++] = tfaces[i];
+			tfaces.resize(j);
+
+			stamps_[to]++;
+			for (size_t i = 0; i != affected.size(); ++i)
+				stamps_[affected[i]]++;
+			PushCandidates(to);
+			for (size_t i = 0; i != affected.size(); ++i)
+				if (affected[i] != to)
+					PushCandidates(affected[i]);
+		}
+
+	private:
+		std::vector<Vec3f>				verts_;
+		std::vector<int>				faces_;
+		std::vector<bool>				vert_alive_;
+		std::vector<bool>				face_alive_;
+		std::vector<int>				stamps_;
+		std::vector<std::vector<int> >	vert_faces_;
+		std::vector<Quadric>			quadrics_;
+		std::priority_queue<Collapse>	heap_;
+		int								num_alive_faces_;
+	};
+
+	template <class T>
+	void WriteValue(FILE* pfile, const T& value)
+	{
+		fwrite(&value, sizeof(T), 1, pfile);
+	}
+
+	template <class T>
+	bool ReadValue(FILE* pfile, T& value)
+	{
+		return fread(&value, sizeof(T), 1, pfile) == 1;
+	}
+
+	long long FileSize(const char* name)
+	{
+		struct stat st;
+		if (stat(name, &st) != 0)
+		{
+			return 0;
+		}
+		return static_cast<long long>(st.st_size);
+	}
+}
+
+ProgressiveMesh::ProgressiveMesh(void)
+{
+}
+
+ProgressiveMesh::~ProgressiveMesh(void)
+{
+	Clear();
+}
+
+void ProgressiveMesh::Clear(void)
+{
+	base_verts_.clear();
+	base_faces_.clear();
+	splits_.clear();
+}
+
+bool ProgressiveMesh::Build(Mesh3D* mesh, int base_faces)
+{
+	Clear();
+	if (mesh == NULL || !mesh->isValid())
+	{
+		return false;
+	}
+
+	std::vector<Vec3f> verts(mesh->num_of_vertex_list());
+	for (int i = 0; i < mesh->num_of_vertex_list(); i++)
+	{
+		verts[i] = mesh->get_vertex(i)->position();
+	}
+	std::vector<int> faces;
+	faces.reserve(3 * mesh->num_of_face_list());
+	for (int i = 0; i < mesh->num_of_face_list(); i++)
+	{
+		HE_face *face = mesh->get_face(i);
+		if (face->valence() != 3)
+		{
+			return false;
+		}
+		HE_edge *pedge = face->pedge_;
+		do
+		{
+			faces.push_back(pedge->pvert_->id());
+			pedge = pedge->pnext_;
+		} while (pedge != face->pedge_);
+	}
+
+	std::vector<CollapseRecord> records;
+	PMSimplifier simplifier(verts, faces);
+	simplifier.Run(base_faces, records);
+
+	// base vertices keep their relative order, the removed ones follow in refinement order
+	int nv = static_cast<int>(verts.size());
+	int nf = static_cast<int>(faces.size()) / 3;
+	std::vector<int> vert_map(nv, -1), face_map(nf, -1);
+	int next = 0;
+	for (int v = 0; v < nv; v++)
+	{
+		if (simplifier.vert_alive(v))
+		{
+			vert_map[v] = next++;
+			base_verts_.push_back(verts[v]);
+		}
+	}
+	for (int r = static_cast<int>(records.size()) - 1; r >= 0; r--)
+	{
+		vert_map[records[r].from_] = next++;
+	}
+
+	const std::vector<int>& coarse = simplifier.faces();
+	int next_face = 0;
+	for (int f = 0; f < nf; f++)
+	{
+		if (simplifier.face_alive(f))
+		{
+			face_map[f] = next_face++;
+			for (int k = 0; k < 3; k++)
+				base_faces_.push_back(vert_map[coarse[3*f+k]]);
+		}
+	}
+
+	splits_.resize(records.size());
+	for (int r = static_cast<int>(records.size()) - 1, s = 0; r >= 0; r--, s++)
+	{
+		const CollapseRecord& record = records[r];
+		PMVertexSplit& split = splits_[s];
+		split.parent_ = vert_map[record.to_];
+		split.position_ = verts[record.from_];
+		for (size_t i = 0; i != record.moved_faces_.size(); ++i)
+		{
+			split.moved_faces_.push_back(face_map[record.moved_faces_[i]]);
+		}
+		for (size_t i = 0; i != record.removed_faces_.size(); ++i)
+		{
+			face_map[record.removed_faces_[i]] = next_face++;
+		}
+		for (size_t i = 0; i != record.removed_corners_.size(); ++i)
+		{
+			split.new_faces_.push_back(vert_map[record.removed_corners_[i]]);
+		}
+	}
+	return true;
+}
+
+bool ProgressiveMesh::Save(const char* fouts) const
+{
+	FILE *pfile = fopen(fouts, "wb");
+	if (pfile == NULL)
+	{
+		return false;
+	}
+
+	int num_vertex = num_base_vertex() + num_split();
+	int num_face = num_base_face();
+	for (size_t i = 0; i != splits_.size(); ++i)
+		num_face += static_cast<int>(splits_[i].new_faces_.size()) / 3;
+
+	fwrite(kPMMagic, 1, 4, pfile);
+	WriteValue(pfile, num_base_vertex());
+	WriteValue(pfile, num_base_face());
+	WriteValue(pfile, num_split());
+	WriteValue(pfile, num_vertex);
+	WriteValue(pfile, num_face);
+	if (!base_verts_.empty())
+		fwrite(base_verts_[0].data(), sizeof(float), 3 * base_verts_.size(), pfile);
+	if (!base_faces_.empty())
+		fwrite(&base_faces_[0], sizeof(int), base_faces_.size(), pfile);
+
+	for (size_t i = 0; i != splits_.size(); ++i)
+	{
+		const PMVertexSplit& split = splits_[i];
+		WriteValue(pfile, split.parent_);
+		fwrite(split.position_.data(), sizeof(float), 3, pfile);
+		WriteValue(pfile, static_cast<int>(split.moved_faces_.size()));
+		WriteValue(pfile, static_cast<int>(split.new_faces_.size()) / 3);
+		if (!split.moved_faces_.empty())
+			fwrite(&split.moved_faces_[0], sizeof(int), split.moved_faces_.size(), pfile);
+		if (!split.new_faces_.empty())
+			fwrite(&split.new_faces_[0], sizeof(int), split.new_faces_.size(), pfile);
+	}
+
+	bool ok = ferror(pfile) == 0;
+	fclose(pfile);
+	return ok;
+}
+
+ProgressiveMeshStream::ProgressiveMeshStream(void)
+	: pfile_(NULL), num_split_(0), num_applied_(0), num_full_face_(0)
+{
+}
+
+ProgressiveMeshStream::~ProgressiveMeshStream(void)
+{
+	Close();
+}
+
+bool ProgressiveMeshStream::Open(const char* fins)
+{
+	Close();
+	verts_.clear();
+	faces_.clear();
+	num_split_ = num_applied_ = num_full_face_ = 0;
+
+	pfile_ = fopen(fins, "rb");
+	if (pfile_ == NULL)
+	{
+		return false;
+	}
+
+	char magic[4];
+	int num_base_vertex, num_base_face, num_vertex;
+	if (fread(magic, 1, 4, pfile_) != 4 || std::memcmp(magic, kPMMagic, 4) != 0
+		|| !ReadValue(pfile_, num_base_vertex) || !ReadValue(pfile_, num_base_face)
+		|| !ReadValue(pfile_, num_split_) || !ReadValue(pfile_, num_vertex)
+		|| !ReadValue(pfile_, num_full_face_)
+		|| num_base_vertex < 0 || num_base_face < 0 || num_split_ < 0)
+	{
+		Close();
+		return false;
+	}
+	// counts the file cannot hold would only reserve memory for nothing
+	long long needed = kPMHeaderBytes + 3 * sizeof(float) * static_cast<long long>(num_base_vertex)
+		+ 3 * sizeof(int) * static_cast<long long>(num_full_face_) + kPMSplitBytes * num_split_;
+	if (num_vertex != num_base_vertex + num_split_ || num_full_face_ < num_base_face || needed > FileSize(fins))
+	{
+		Close();
+		return false;
+	}
+
+	verts_.resize(num_base_vertex);
+	faces_.resize(3 * num_base_face);
+	verts_.reserve(num_vertex);
+	faces_.reserve(3 * num_full_face_);
+	if ((num_base_vertex > 0 && fread(verts_[0].data(), sizeof(float), 3 * num_base_vertex, pfile_) != 3 * static_cast<size_t>(num_base_vertex))
+		|| (num_base_face > 0 && fread(&faces_[0], sizeof(int), 3 * num_base_face, pfile_) != 3 * static_cast<size_t>(num_base_face)))
+	{
+		Close();
+		return false;
+	}
+	for (size_t i = 0; i != faces_.size(); ++i)
+	{
+		if (faces_[i] < 0 || faces_[i] >= num_base_vertex)
+		{
+			Close();
+			return false;
+		}
+	}
+	return true;
+}
+
+void ProgressiveMeshStream::Close(void)
+{
+	if (pfile_ != NULL)
+	{
+		fclose(pfile_);
+		pfile_ = NULL;
+	}
+}
+
+bool ProgressiveMeshStream::ReadSplit(PMVertexSplit& split)
+{
+	int num_moved, num_new;
+	if (!ReadValue(pfile_, split.parent_)
+		|| fread(split.position_.data(), sizeof(float), 3, pfile_) != 3
+		|| !ReadValue(pfile_, num_moved) || !ReadValue(pfile_, num_new)
+		|| num_moved < 0 || num_new < 0 || num_moved > num_face() || num_new > num_full_face_ - num_face())
+	{
+		return false;
+	}
+	split.moved_faces_.resize(num_moved);
+	split.new_faces_.resize(3 * num_new);
+	if (num_moved > 0 && fread(&split.moved_faces_[0], sizeof(int), num_moved, pfile_) != static_cast<size_t>(num_moved))
+		return false;
+	if (num_new > 0 && fread(&split.new_faces_[0], sizeof(int), 3 * num_new, pfile_) != 3 * static_cast<size_t>(num_new))
+		return false;
+
+	// the indices must name existing faces and vertices, or the new vertex of the split
+	if (split.parent_ < 0 || split.parent_ >= num_vertex())
+		return false;
+	for (size_t i = 0; i != split.moved_faces_.size(); ++i)
+	{
+		if (split.moved_faces_[i] < 0 || split.moved_faces_[i] >= num_face())
+			return false;
+	}
+	for (size_t i = 0; i != split.new_faces_.size(); ++i)
+	{
+		if (split.new_faces_[i] < 0 || split.new_faces_[i] > num_vertex())
+			return false;
+	}
+	return true;
+}
+
+void ProgressiveMeshStream::ApplySplit(const PMVertexSplit& split)
+{
+	int vnew = static_cast<int>(verts_.size());
+	verts_.push_back(split.position_);
+	for (size_t i = 0; i != split.moved_faces_.size(); ++i)
+	{
+		int *pf = &faces_[3 * split.moved_faces_[i]];
+		for (int k = 0; k < 3; k++)
+		{
+			if (pf[k] == split.parent_)
+				pf[k] = vnew;
+		}
+	}
+	faces_.insert(faces_.end(), split.new_faces_.begin(), split.new_faces_.end());
+}
+
+int ProgressiveMeshStream::Refine(int max_faces, int max_splits)
+{
+	int applied = 0;
+	PMVertexSplit split;
+	while (!finished() && applied < max_splits && num_face() < max_faces)
+	{
+		if (!ReadSplit(split))
+		{
+			// truncated or corrupt file: keep what has been read so far
+			Close();
+			break;
+		}
+		ApplySplit(split);
+		num_applied_++;
+		applied++;
+	}
+	return applied;
+}
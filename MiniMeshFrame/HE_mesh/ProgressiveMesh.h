@@ -0,0 +1,112 @@
+#pragma once
+
+#include <vector>
+#include <cstdio>
+#include "Mesh3D.h"
+
+/*!
+*	One refinement step of a progressive mesh.
+*	The split inserts a new vertex next to parent_, moves the corners of moved_faces_ from
+*	parent_ to the new vertex and appends the faces listed in new_faces_.
+*/
+struct PMVertexSplit
+{
+	int					parent_;		//!< index of the vertex that is split
+	Vec3f				position_;		//!< position of the new vertex
+	std::vector<int>	moved_faces_;	//!< faces whose corner at parent_ moves to the new vertex
+	std::vector<int>	new_faces_;		//!< vertex indices of the appended faces, 3 per face
+};
+
+/*!
+*	Progressive mesh (Hoppe-style): a coarse base mesh and an ordered list of vertex splits.
+*	The splits are built by quadric-driven half-edge collapses, so every vertex keeps its
+*	original position and a split only has to carry the position of the vertex it restores.
+*
+*	File layout (binary, little endian):
+*		"PMF1", num_base_vertex, num_base_face, num_split, num_vertex, num_face
+*		base positions (3 floats each), base faces (3 ints each)
+*		per split: parent, position (3 floats), num_moved, num_new, moved ids, new corners
+*	so a reader can show the base mesh as soon as the header has arrived and apply the
+*	splits while the rest of the file streams in.
+*/
+class ProgressiveMesh
+{
+public:
+	ProgressiveMesh(void);
+	~ProgressiveMesh(void);
+
+	//! build the progressive mesh of a triangle mesh
+	/*!
+	*	\param mesh the full resolution mesh, left unchanged
+	*	\param base_faces the number of faces at which simplification stops
+	*	\return false if the mesh is empty or not a triangle mesh
+	*/
+	bool Build(Mesh3D* mesh, int base_faces);
+
+	//! write the progressive mesh to a file
+	bool Save(const char* fouts) const;
+
+	int num_base_vertex(void) const {return static_cast<int>(base_verts_.size());}
+	int num_base_face(void) const {return static_cast<int>(base_faces_.size()) / 3;}
+	int num_split(void) const {return static_cast<int>(splits_.size());}
+
+	const std::vector<Vec3f>& base_verts(void) const {return base_verts_;}
+	const std::vector<int>& base_faces(void) const {return base_faces_;}
+	const std::vector<PMVertexSplit>& splits(void) const {return splits_;}
+
+private:
+	void Clear(void);
+
+private:
+	std::vector<Vec3f>			base_verts_;
+	std::vector<int>			base_faces_;
+	std::vector<PMVertexSplit>	splits_;
+};
+
+/*!
+*	Incremental reader of a progressive mesh file.
+*	Open() reads only the header and the base mesh; Refine() then reads and applies the
+*	following vertex splits, so the mesh can be displayed and refined while loading.
+*/
+class ProgressiveMeshStream
+{
+public:
+	ProgressiveMeshStream(void);
+	~ProgressiveMeshStream(void);
+
+	//! open a file and read its base mesh
+	bool Open(const char* fins);
+	//! release the file, the current mesh is kept
+	void Close(void);
+
+	//! read and apply splits until the face count reaches max_faces or max_splits are done
+	/*!
+	*	\return the number of splits applied
+	*/
+	int Refine(int max_faces, int max_splits);
+
+	//! all the splits of the file have been applied
+	bool finished(void) const {return pfile_ == NULL || num_applied_ >= num_split_;}
+
+	int num_vertex(void) const {return static_cast<int>(verts_.size());}
+	int num_face(void) const {return static_cast<int>(faces_.size()) / 3;}
+	int num_full_face(void) const {return num_full_face_;}
+	int num_applied(void) const {return num_applied_;}
+
+	//! the mesh at the current level of detail, in the layout of Mesh3D::CreateMesh
+	const std::vector<Vec3f>& verts(void) const {return verts_;}
+	const std::vector<int>& faces(void) const {return faces_;}
+
+private:
+	//! read the next split, false at the end of the file or on indices out of the current mesh
+	bool ReadSplit(PMVertexSplit& split);
+	void ApplySplit(const PMVertexSplit& split);
+
+private:
+	FILE				*pfile_;
+	int					num_split_;
+	int					num_applied_;
+	int					num_full_face_;
+	std::vector<Vec3f>	verts_;
+	std::vector<int>	faces_;
+};
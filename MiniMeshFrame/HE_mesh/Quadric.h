@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cmath>
+#include "Vec.h"
+
+/*!
+*	Symmetric 4x4 error quadric of Garland and Heckbert, stored as its upper triangle.
+*	Error(p) is the weighted sum of the squared distances of p to the accumulated planes.
+*/
+struct Quadric
+{
+	double a_[10];
+
+	Quadric() { for (int i = 0; i < 10; i++) a_[i] = 0.0; }
+
+	void AddPlane(double nx, double ny, double nz, double d, double w)
+	{
+		a_[0] += w*nx*nx; a_[1] += w*nx*ny; a_[2] += w*nx*nz; a_[3] += w*nx*d;
+		a_[4] += w*ny*ny; a_[5] += w*ny*nz; a_[6] += w*ny*d;
+		a_[7] += w*nz*nz; a_[8] += w*nz*d;
+		a_[9] += w*d*d;
+	}
+	void Add(const Quadric& q) { for (int i = 0; i < 10; i++) a_[i] += q.a_[i]; }
+	double Error(const trimesh::vec3& p) const
+	{
+		double x = p[0], y = p[1], z = p[2];
+		return a_[0]*x*x + 2*a_[1]*x*y + 2*a_[2]*x*z + 2*a_[3]*x
+			+ a_[4]*y*y + 2*a_[5]*y*z + 2*a_[6]*y
+			+ a_[7]*z*z + 2*a_[8]*z + a_[9];
+	}
+	//! the point of least error, false if the quadric is (nearly) singular
+	bool Minimize(double p[3]) const
+	{
+		// Cramer's rule on A p = -b
+		double c00 = a_[4]*a_[7] - a_[5]*a_[5];
+		double c01 = a_[2]*a_[5] - a_[1]*a_[7];
+		double c02 = a_[1]*a_[5] - a_[2]*a_[4];
+		double det = a_[0]*c00 + a_[1]*c01 + a_[2]*c02;
+		double trace = a_[0] + a_[4] + a_[7];
+		if (std::fabs(det) <= 1e-9 * trace * trace * trace)
+		{
+			return false;
+		}
+		double c11 = a_[0]*a_[7] - a_[2]*a_[2];
+		double c12 = a_[1]*a_[2] - a_[0]*a_[5];
+		double c22 = a_[0]*a_[4] - a_[1]*a_[1];
+		double bx = -a_[3], by = -a_[6], bz = -a_[8];
+		p[0] = (c00*bx + c01*by + c02*bz) / det;
+		p[1] = (c01*bx + c11*by + c12*bz) / det;
+		p[2] = (c02*bx + c12*by + c22*bz) / det;
+		return true;
+	}
+};
@@ -0,0 +1,292 @@
+#include "RegionSolver.h"
+
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace
+{
+	double ElapsedMs(const std::chrono::steady_clock::time_point& start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+RegionSolver::RegionSolver(void)
+	: mesh_(NULL), topology_version_(0), is_factorized_(false)
+	, operation_(MINIMAL_SURFACE), weights_(LaplacianAssembler::UNIFORM), lambda_(1.0), smoothing_steps_(1)
+	, num_fixed_(0), is_analyzed_(false), is_factor_reused_(false), factor_ms_(0.0), solve_ms_(0.0)
+{
+}
+
+RegionSolver::~RegionSolver(void)
+{
+}
+
+void RegionSolver::Clear(void)
+{
+	mesh_ = NULL;
+	is_factorized_ = false;
+	is_analyzed_ = false;
+	num_fixed_ = 0;
+	std::vector<int>().swap(selection_);
+	std::vector<int>().swap(inner_);
+	std::vector<int>().swap(offsets_);
+	std::vector<int>().swap(neighbors_);
+	std::vector<int>().swap(neighbor_rows_);
+	std::vector<int>().swap(opposites_);
+	std::vector<double>().swap(edge_weights_);
+	matrix_ = SparseMatrix();
+}
+
+void RegionSolver::CollectSelection(Mesh3D* mesh, std::vector<int>& selection)
+{
+	selection.clear();
+	if (mesh == NULL)
+	{
+		return;
+	}
+	const std::vector<HE_vert*>& verts = *(mesh->get_vertex_list());
+	for (size_t i = 0; i != verts.size(); i++)
+	{
+		if (verts[i]->selected() == SELECTED)
+		{
+			selection.push_back(static_cast<int>(i));
+		}
+	}
+}
+
+void RegionSolver::set_operation(Operation operation)
+{
+	is_factorized_ = is_factorized_ && operation == operation_;
+	operation_ = operation;
+}
+
+void RegionSolver::set_weights(LaplacianAssembler::Weights weights)
+{
+	is_factorized_ = is_factorized_ && weights == weights_;
+	weights_ = weights;
+}
+
+void RegionSolver::set_smoothing(double lambda)
+{
+	is_factorized_ = is_factorized_ && (operation_ != SMOOTH || lambda == lambda_);
+	lambda_ = lambda;
+}
+
+bool RegionSolver::Extract(Mesh3D* mesh, const std::vector<int>& selection)
+{
+	Clear();
+	mesh_ = mesh;
+	topology_version_ = mesh->topology_version();
+	selection_ = selection;
+
+	// the selected vertices on the boundary of the mesh stay where they are, as do isolated ones
+	const std::vector<HE_vert*>& verts = *(mesh->get_vertex_list());
+	int num_vertex = static_cast<int>(verts.size());
+	std::unordered_map<int, int> row;
+	row.reserve(selection.size());
+	for (size_t k = 0; k != selection.size(); k++)
+	{
+		int i = selection[k];
+		if (i < 0 || i >= num_vertex || verts[i]->pedge_ == NULL || verts[i]->isOnBoundary() || row.count(i) != 0)
+		{
+			continue;
+		}
+		row[i] = static_cast<int>(inner_.size());
+		inner_.push_back(i);
+	}
+	if (inner_.empty())
+	{
+		return false;
+	}
+
+	// every edge around an inner vertex has a face on both sides
+	std::unordered_set<int> fixed;
+	offsets_.reserve(inner_.size() + 1);
+	neighbors_.reserve(inner_.size() * 6);
+	neighbor_rows_.reserve(inner_.size() * 6);
+	opposites_.reserve(inner_.size() * 12);
+	offsets_.push_back(0);
+	for (size_t r = 0; r != inner_.size(); r++)
+	{
+		HE_edge *start = verts[inner_[r]]->pedge_, *pedge = start;
+		do
+		{
+			int j = pedge->pvert_->id_;
+			std::unordered_map<int, int>::const_iterator it = row.find(j);
+			neighbors_.push_back(j);
+			neighbor_rows_.push_back(it != row.end() ? it->second : -1);
+			opposites_.push_back(pedge->pnext_->pvert_->id_);
+			opposites_.push_back(pedge->ppair_->pnext_->pvert_->id_);
+			if (it == row.end())
+			{
+				fixed.insert(j);
+			}
+			pedge = pedge->ppair_->pnext_;
+		} while (pedge != start);
+		offsets_.push_back(static_cast<int>(neighbors_.size()));
+	}
+	num_fixed_ = static_cast<int>(fixed.size());
+	return true;
+}
+
+bool RegionSolver::Factorize(const std::vector<HE_vert*>& verts)
+{
+	int n = num_unknowns();
+	edge_weights_.resize(neighbors_.size());
+	for (int r = 0; r < n; r++)
+	{
+		for (int p = offsets_[r]; p < offsets_[r + 1]; p++)
+		{
+			edge_weights_[p] = LaplacianAssembler::EdgeWeight(weights_, verts, inner_[r], neighbors_[p],
+				opposites_[2 * p], opposites_[2 * p + 1]);
+		}
+	}
+
+	// column r of the lower triangle: the diagonal, then the unknown neighbors after r in order
+	double scale = operation_ == SMOOTH ? lambda_ : 1.0;
+	matrix_.resize(n, n);
+	int* outer = matrix_.outerIndexPtr();
+	outer[0] = 0;
+	for (int r = 0; r < n; r++)
+	{
+		int count = 1;
+		for (int p = offsets_[r]; p < offsets_[r + 1]; p++)
+		{
+			count += neighbor_rows_[p] > r ? 1 : 0;
+		}
+		outer[r + 1] = outer[r] + count;
+	}
+	matrix_.resizeNonZeros(outer[n]);
+	int* inner = matrix_.innerIndexPtr();
+	double* values = matrix_.valuePtr();
+	std::vector<std::pair<int, double> > column;
+	for (int r = 0; r < n; r++)
+	{
+		double diagonal = operation_ == SMOOTH ? 1.0 : 0.0;
+		column.clear();
+		for (int p = offsets_[r]; p < offsets_[r + 1]; p++)
+		{
+			diagonal += scale * edge_weights_[p];
+			if (neighbor_rows_[p] > r)
+			{
+				column.push_back(std::make_pair(neighbor_rows_[p], -scale * edge_weights_[p]));
+			}
+		}
+		std::sort(column.begin(), column.end());
+		int q = outer[r];
+		inner[q] = r;
+		values[q++] = diagonal;
+		for (size_t k = 0; k != column.size(); k++, q++)
+		{
+			inner[q] = column[k].first;
+			values[q] = column[k].second;
+		}
+	}
+
+	// the pattern is that of the patch, the cotangent values change with the positions
+	if (!is_analyzed_)
+	{
+		ldlt_.analyzePattern(matrix_);
+		is_analyzed_ = true;
+	}
+	ldlt_.factorize(matrix_);
+	return ldlt_.info() == Eigen::Success;
+}
+
+void RegionSolver::AssembleRhs(const std::vector<HE_vert*>& verts)
+{
+	double scale = operation_ == SMOOTH ? lambda_ : 1.0;
+	rhs_.setZero(num_unknowns(), 3);
+	for (int r = 0; r < num_unknowns(); r++)
+	{
+		for (int p = offsets_[r]; p < offsets_[r + 1]; p++)
+		{
+			if (neighbor_rows_[p] < 0)
+			{
+				const Vec3f& position = verts[neighbors_[p]]->position_;
+				double w = scale * edge_weights_[p];
+				rhs_(r, 0) += w * position[0];
+				rhs_(r, 1) += w * position[1];
+				rhs_(r, 2) += w * position[2];
+			}
+		}
+	}
+}
+
+bool RegionSolver::Solve(Mesh3D* mesh)
+{
+	std::vector<int> selection;
+	CollectSelection(mesh, selection);
+	return Solve(mesh, selection);
+}
+
+bool RegionSolver::Solve(Mesh3D* mesh, const std::vector<int>& selection)
+{
+	factor_ms_ = 0.0;
+	solve_ms_ = 0.0;
+	is_factor_reused_ = false;
+	if (mesh == NULL || selection.empty())
+	{
+		return false;
+	}
+
+	// the uniform factors fit as long as the patch, the cotangent ones are refactored on its pattern
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	const std::vector<HE_vert*>& verts = *(mesh->get_vertex_list());
+	bool is_same_patch = is_factorized_ && mesh == mesh_ && mesh->topology_version() == topology_version_
+		&& selection == selection_;
+	if (!is_same_patch && !Extract(mesh, selection))
+	{
+		return false;
+	}
+	// a minimal surface needs some fixed vertex to hang on
+	if (operation_ == MINIMAL_SURFACE && num_fixed_ == 0)
+	{
+		return false;
+	}
+	is_factor_reused_ = is_same_patch && weights_ == LaplacianAssembler::UNIFORM;
+	if (!is_factor_reused_)
+	{
+		is_factorized_ = Factorize(verts);
+		factor_ms_ = ElapsedMs(start);
+		if (!is_factorized_)
+		{
+			return false;
+		}
+	}
+
+	start = std::chrono::steady_clock::now();
+	int n = num_unknowns();
+	AssembleRhs(verts);
+	Eigen::MatrixX3d solution(n, 3);
+	for (int r = 0; r < n; r++)
+	{
+		const Vec3f& position = verts[inner_[r]]->position_;
+		solution.row(r) << position[0], position[1], position[2];
+	}
+	int steps = operation_ == SMOOTH ? std::max(smoothing_steps_, 1) : 1;
+	for (int s = 0; s < steps; s++)
+	{
+		solution = operation_ == SMOOTH ? Eigen::MatrixX3d(ldlt_.solve(rhs_ + solution)) : Eigen::MatrixX3d(ldlt_.solve(rhs_));
+	}
+	solve_ms_ = ElapsedMs(start);
+	if (ldlt_.info() != Eigen::Success || !solution.allFinite())
+	{
+		return false;
+	}
+
+	// only the span of the unknowns is uploaded again
+	int first = inner_[0], last = inner_[0];
+	for (int r = 0; r < n; r++)
+	{
+		verts[inner_[r]]->set_position(Vec3f(static_cast<float>(solution(r, 0)),
+			static_cast<float>(solution(r, 1)), static_cast<float>(solution(r, 2))));
+		first = std::min(first, inner_[r]);
+		last = std::max(last, inner_[r]);
+	}
+	mesh->MarkGeometryChanged(first, last + 1);
+	return true;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <vector>
+#include <Eigen/Sparse>
+#include "Mesh3D.h"
+#include "LaplacianAssembler.h"
+
+/*!
+*	Minimal surface or implicit smoothing of a selected patch of a mesh, the rest of the mesh
+*	untouched. The selected vertices off the boundary of the mesh are the unknowns, their
+*	one-ring outside the selection is held fixed as the boundary of the patch, as are the
+*	selected vertices on the boundary of the mesh. The patch is read from the half-edges of the
+*	selected vertices only, into a local system of its own with a small sparse LDLT, so the
+*	time follows the size of the selection and not that of the mesh; the new positions are
+*	written back in place.
+*	MINIMAL_SURFACE puts every unknown at the weighted average of its one-ring, L x = 0 on the
+*	patch. SMOOTH takes implicit steps (I + lambda L) x' = x of the patch (Desbrun et al.),
+*	which fair it without the shrinking limit of explicit steps.
+*	With the uniform weights the matrix depends on the connectivity of the patch alone, and
+*	solving the same selection of the same mesh again keeps the factors, as LaplaceSolver does.
+*/
+class RegionSolver
+{
+public:
+	typedef Eigen::SparseMatrix<double> SparseMatrix;
+
+	enum Operation
+	{
+		MINIMAL_SURFACE,
+		SMOOTH
+	};
+
+	RegionSolver(void);
+	~RegionSolver(void);
+
+	//! solve on the selected vertices of the mesh, see CollectSelection
+	bool Solve(Mesh3D* mesh);
+	//! solve on the vertices of these ids
+	/*!
+	*	\return false if no selected vertex can move, or the system is singular (a selected
+	*	part that reaches no fixed vertex), the mesh is unchanged
+	*/
+	bool Solve(Mesh3D* mesh, const std::vector<int>& selection);
+	//! drop the patch and its factors
+	void Clear(void);
+
+	//! ids of the vertices whose tag is SELECTED, a pass over every vertex
+	static void CollectSelection(Mesh3D* mesh, std::vector<int>& selection);
+
+	//! the setters drop the factors if they no longer fit
+	void set_operation(Operation operation);
+	//! UNIFORM (the default) or COTANGENT, the mean-value weights are not symmetric
+	void set_weights(LaplacianAssembler::Weights weights);
+	//! lambda of the SMOOTH steps
+	void set_smoothing(double lambda);
+	//! SMOOTH steps per Solve, all with the factors of the first
+	void set_smoothing_steps(int n) {smoothing_steps_ = n;}
+
+	int num_unknowns(void) const {return static_cast<int>(inner_.size());}
+	//! vertices of the mesh held fixed around and inside the patch
+	int num_fixed(void) const {return num_fixed_;}
+	bool isFactorReused(void) const {return is_factor_reused_;}
+	double factor_ms(void) const {return factor_ms_;}
+	double solve_ms(void) const {return solve_ms_;}
+
+private:
+	//! the unknowns, their one-rings and the fixed vertices, from the half-edges of the selection
+	bool Extract(Mesh3D* mesh, const std::vector<int>& selection);
+	//! lower triangle of the patch matrix and its factors
+	bool Factorize(const std::vector<HE_vert*>& verts);
+	//! the part of the right-hand side from the fixed vertices
+	void AssembleRhs(const std::vector<HE_vert*>& verts);
+
+private:
+	Mesh3D				*mesh_;				//!< the patch is that of this mesh
+	unsigned int		topology_version_;
+	std::vector<int>	selection_;			//!< as given to the Solve that extracted the patch
+	bool				is_factorized_;
+
+	Operation			operation_;
+	LaplacianAssembler::Weights	weights_;
+	double				lambda_;
+	int					smoothing_steps_;
+
+	std::vector<int>	inner_;				//!< vertex of each unknown
+	std::vector<int>	offsets_;			//!< one-rings of the unknowns in compressed rows
+	std::vector<int>	neighbors_;
+	std::vector<int>	neighbor_rows_;		//!< unknown of each neighbor, -1 if it is fixed
+	std::vector<int>	opposites_;			//!< 2 per neighbor, as in VertexAdjacency
+	std::vector<double>	edge_weights_;		//!< w_ij of each neighbor in the last factors
+	int					num_fixed_;
+
+	SparseMatrix		matrix_;			//!< lower triangle
+	Eigen::MatrixX3d	rhs_;
+	Eigen::SimplicialLDLT<SparseMatrix>	ldlt_;
+	bool				is_analyzed_;		//!< the symbolic factorization of the patch is done
+
+	bool				is_factor_reused_;
+	double				factor_ms_;
+	double				solve_ms_;
+};
@@ -0,0 +1,537 @@
+#include "SoftRasterizer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SOFT_RASTERIZER_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// the planes of RenderingWidget::resizeGL
+	const float kNear = 0.001f;
+	const float kFar = 1000.f;
+	// vertices are snapped to 1/16 pixel, the edge functions are integers in these units
+	// (64 bits, 32 for the four pixels of a SSE2 group) and the top-left rule is a bias of one
+	const int kSubpixel = 16;
+	// pixels beyond the image a vertex may be, so its sub-pixel coordinates stay far from
+	// overflowing; the triangles of the vertices outside are dropped
+	const float kGuardBand = 4096.f;
+#ifdef SOFT_RASTERIZER_SSE2
+	// a group takes the edge function at its first pixel clamped to this, the sign of the
+	// four pixels is kept as long as three steps of a pixel are below it
+	const long long kEdgeClamp = 1 << 30;
+#endif
+
+	template<class Function>
+	void RunThreads(int num_threads, Function function)
+	{
+		if (num_threads <= 1)
+		{
+			function(0);
+			return;
+		}
+		std::vector<std::thread> workers;
+		for (int t = 0; t < num_threads; t++)
+		{
+			workers.push_back(std::thread(function, t));
+		}
+		for (int t = 0; t < num_threads; t++)
+		{
+			workers[t].join();
+		}
+	}
+
+	inline float Clamp01(float x)
+	{
+		return x < 0.f ? 0.f : (x > 1.f ? 1.f : x);
+	}
+
+	inline unsigned int PackColor(float r, float g, float b, float a)
+	{
+		return static_cast<unsigned int>(Clamp01(r) * 255.f + 0.5f)
+			| static_cast<unsigned int>(Clamp01(g) * 255.f + 0.5f) << 8
+			| static_cast<unsigned int>(Clamp01(b) * 255.f + 0.5f) << 16
+			| static_cast<unsigned int>(Clamp01(a) * 255.f + 0.5f) << 24;
+	}
+
+#ifdef SOFT_RASTERIZER_SSE2
+	inline int ClampEdge(long long e)
+	{
+		return static_cast<int>(e < -kEdgeClamp ? -kEdgeClamp : (e > kEdgeClamp ? kEdgeClamp : e));
+	}
+#endif
+}
+
+SoftRasterizer::SoftRasterizer(void)
+	: width_(0), height_(0), stride_(0), tiles_x_(0), tiles_y_(0), num_threads_(0), num_bin_threads_(0)
+	, fovy_(45.f), background_(0.3f, 0.3f, 0.3f, 0.f), has_lighting_(true), is_backface_culling_(false)
+	, mesh_(NULL), topology_version_(0), num_drawn_triangles_(0)
+{
+	SetCamera(Vec3f(0.f, 0.f, 5.f), Vec3f(0.f, 0.f, 0.f));
+}
+
+SoftRasterizer::~SoftRasterizer(void)
+{
+}
+
+void SoftRasterizer::Resize(int width, int height)
+{
+	width_ = width > 0 ? width : 0;
+	height_ = height > 0 ? height : 0;
+	stride_ = (width_ + 3) & ~3;
+	tiles_x_ = (width_ + kTileSize - 1) / kTileSize;
+	tiles_y_ = (height_ + kTileSize - 1) / kTileSize;
+	pixels_.assign(static_cast<size_t>(stride_) * height_, 0);
+	depth_.assign(static_cast<size_t>(stride_) * height_, 1.f);
+}
+
+void SoftRasterizer::SetCamera(const Vec3f& eye, const Vec3f& goal, const float* ball_matrix)
+{
+	// gluLookAt with y up
+	Vec3f f = goal - eye;
+	f /= len(f) > 0.f ? len(f) : 1.f;
+	Vec3f s = f ^ Vec3f(0.f, 1.f, 0.f);
+	s /= len(s) > 0.f ? len(s) : 1.f;
+	Vec3f u = s ^ f;
+	float view[16] = {
+		s[0], u[0], -f[0], 0.f,
+		s[1], u[1], -f[1], 0.f,
+		s[2], u[2], -f[2], 0.f,
+		-s.dot(eye), -u.dot(eye), f.dot(eye), 1.f};
+
+	static const float identity[16] = {1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f};
+	const float* ball = ball_matrix != NULL ? ball_matrix : identity;
+	for (int c = 0; c < 4; c++)
+	{
+		for (int r = 0; r < 4; r++)
+		{
+			float sum = 0.f;
+			for (int k = 0; k < 4; k++)
+			{
+				sum += view[k * 4 + r] * ball[c * 4 + k];
+			}
+			modelview_[c * 4 + r] = sum;
+		}
+	}
+}
+
+int SoftRasterizer::ThreadCount(int work, int grain) const
+{
+	int num_threads = num_threads_ > 0 ? num_threads_ : static_cast<int>(std::thread::hardware_concurrency());
+	int useful = work / grain;
+	num_threads = num_threads < useful ? num_threads : useful;
+	return num_threads > 1 ? num_threads : 1;
+}
+
+void SoftRasterizer::PrepareTriangles(Mesh3D* mesh)
+{
+	if (mesh == mesh_ && mesh->topology_version() == topology_version_)
+	{
+		return;
+	}
+	mesh_ = mesh;
+	topology_version_ = mesh->topology_version();
+	triangles_.clear();
+
+	const std::vector<HE_face*>& faces = *(mesh->get_faces_list());
+	for (size_t i = 0; i != faces.size(); i++)
+	{
+		HE_edge *first = faces[i]->pedge_;
+		HE_edge *pedge = first->pnext_;
+		while (pedge->pnext_ != first)
+		{
+			triangles_.push_back(first->pvert_->id_);
+			triangles_.push_back(pedge->pvert_->id_);
+			triangles_.push_back(pedge->pnext_->pvert_->id_);
+			pedge = pedge->pnext_;
+		}
+	}
+}
+
+void SoftRasterizer::TransformVertices(Mesh3D* mesh, int first, int last)
+{
+	const std::vector<HE_vert*>& verts = *(mesh->get_vertex_list());
+	const float* m = modelview_;
+	float focal = 1.f / tan(fovy_ * 3.14159265f / 360.f);
+	float aspect = static_cast<float>(width_) / height_;
+	Vec3f light(1.f, 1.f, 1.f);
+	light /= len(light);
+
+	for (int i = first; i < last; i++)
+	{
+		const HE_vert *vert = verts[i];
+		const Vec3f& p = vert->position_;
+		ScreenVertex& out = vertices_[i];
+
+		float xe = m[0] * p[0] + m[4] * p[1] + m[8] * p[2] + m[12];
+		float ye = m[1] * p[0] + m[5] * p[1] + m[9] * p[2] + m[13];
+		float ze = m[2] * p[0] + m[6] * p[1] + m[10] * p[2] + m[14];
+		float w = -ze;
+		out.valid_ = w > kNear;
+		if (!out.valid_)
+		{
+			continue;
+		}
+		float inv_w = 1.f / w;
+		float x = (focal / aspect * xe * inv_w * 0.5f + 0.5f) * width_;
+		float y = (0.5f - focal * ye * inv_w * 0.5f) * height_;
+		out.valid_ = x > -kGuardBand && x < width_ + kGuardBand && y > -kGuardBand && y < height_ + kGuardBand;
+		out.sx_ = static_cast<int>(floor(x * kSubpixel + 0.5f));
+		out.sy_ = static_cast<int>(floor(y * kSubpixel + 0.5f));
+		out.x_ = static_cast<float>(out.sx_) / kSubpixel;
+		out.y_ = static_cast<float>(out.sy_) / kSubpixel;
+		out.z_ = ((kFar + kNear) / (kFar - kNear) + 2.f * kFar * kNear / (kFar - kNear) * -inv_w) * 0.5f + 0.5f;
+		out.inv_w_ = inv_w;
+
+		// Lambert with the ambient and the light of SetDefaultLight, in eye space
+		float shade = 1.f;
+		if (has_lighting_)
+		{
+			const Vec3f& n = vert->normal_;
+			Vec3f ne(m[0] * n[0] + m[4] * n[1] + m[8] * n[2],
+				m[1] * n[0] + m[5] * n[1] + m[9] * n[2],
+				m[2] * n[0] + m[6] * n[1] + m[10] * n[2]);
+			float l = len(ne);
+			float diffuse = l > 0.f ? ne.dot(light) / l : 0.f;
+			shade = 0.3f + 0.8f * (diffuse > 0.f ? diffuse : 0.f);
+		}
+		out.r_ = Clamp01(vert->color_[0] * shade) * inv_w;
+		out.g_ = Clamp01(vert->color_[1] * shade) * inv_w;
+		out.b_ = Clamp01(vert->color_[2] * shade) * inv_w;
+	}
+}
+
+int SoftRasterizer::SetupAndBin(int thread, int first, int last)
+{
+	int num_tiles = tiles_x_ * tiles_y_;
+	std::vector<int>* bins = &bins_[static_cast<size_t>(thread) * num_tiles];
+	int count = 0;
+	for (int t = first; t < last; t++)
+	{
+		const ScreenVertex* v[3] = {&vertices_[triangles_[t * 3]], &vertices_[triangles_[t * 3 + 1]],
+			&vertices_[triangles_[t * 3 + 2]]};
+		if (!v[0]->valid_ || !v[1]->valid_ || !v[2]->valid_)
+		{
+			continue;
+		}
+
+		// counter-clockwise on the screen of OpenGL is clockwise with y down
+		long long twice_area = static_cast<long long>(v[1]->sx_ - v[0]->sx_) * (v[2]->sy_ - v[0]->sy_)
+			- static_cast<long long>(v[2]->sx_ - v[0]->sx_) * (v[1]->sy_ - v[0]->sy_);
+		if (twice_area == 0 || (is_backface_culling_ && twice_area > 0))
+		{
+			continue;
+		}
+		if (twice_area < 0)
+		{
+			std::swap(v[1], v[2]);
+			twice_area = -twice_area;
+		}
+		float area = static_cast<float>(twice_area) / (kSubpixel * kSubpixel);
+
+		// the pixels whose centers are in the bounding box, small triangles often have none
+		TriangleSetup& setup = setups_[t];
+		setup.min_x_ = static_cast<int>(ceil(std::min(v[0]->x_, std::min(v[1]->x_, v[2]->x_)) - 0.5f));
+		setup.min_y_ = static_cast<int>(ceil(std::min(v[0]->y_, std::min(v[1]->y_, v[2]->y_)) - 0.5f));
+		setup.max_x_ = static_cast<int>(floor(std::max(v[0]->x_, std::max(v[1]->x_, v[2]->x_)) - 0.5f));
+		setup.max_y_ = static_cast<int>(floor(std::max(v[0]->y_, std::max(v[1]->y_, v[2]->y_)) - 0.5f));
+		setup.min_x_ = setup.min_x_ > 0 ? setup.min_x_ : 0;
+		setup.min_y_ = setup.min_y_ > 0 ? setup.min_y_ : 0;
+		setup.max_x_ = setup.max_x_ < width_ - 1 ? setup.max_x_ : width_ - 1;
+		setup.max_y_ = setup.max_y_ < height_ - 1 ? setup.max_y_ : height_ - 1;
+		if (setup.min_x_ > setup.max_x_ || setup.min_y_ > setup.max_y_)
+		{
+			continue;
+		}
+
+		setup.origin_x_ = v[0]->x_;
+		setup.origin_y_ = v[0]->y_;
+		setup.origin_sx_ = v[0]->sx_;
+		setup.origin_sy_ = v[0]->sy_;
+		for (int e = 0; e < 3; e++)
+		{
+			const ScreenVertex* a = v[e];
+			const ScreenVertex* b = v[(e + 1) % 3];
+			int A = a->sy_ - b->sy_;
+			int B = b->sx_ - a->sx_;
+			setup.edge_[e][0] = A;
+			setup.edge_[e][1] = B;
+			setup.edge_c_[e] = static_cast<long long>(A) * (v[0]->sx_ - a->sx_) + static_cast<long long>(B) * (v[0]->sy_ - a->sy_);
+			// top-left rule: pixels on a top or left edge belong to this triangle
+			setup.edge_[e][2] = A > 0 || (A == 0 && B > 0) ? 0 : 1;
+		}
+
+		float dx1 = v[1]->x_ - v[0]->x_, dy1 = v[1]->y_ - v[0]->y_;
+		float dx2 = v[2]->x_ - v[0]->x_, dy2 = v[2]->y_ - v[0]->y_;
+		float inv_area = 1.f / area;
+		const float attributes[5][3] = {
+			{v[0]->z_, v[1]->z_, v[2]->z_},
+			{v[0]->inv_w_, v[1]->inv_w_, v[2]->inv_w_},
+			{v[0]->r_, v[1]->r_, v[2]->r_},
+			{v[0]->g_, v[1]->g_, v[2]->g_},
+			{v[0]->b_, v[1]->b_, v[2]->b_}};
+		for (int k = 0; k < 5; k++)
+		{
+			float d1 = attributes[k][1] - attributes[k][0];
+			float d2 = attributes[k][2] - attributes[k][0];
+			setup.plane_[k][0] = attributes[k][0];
+			setup.plane_[k][1] = (d1 * dy2 - d2 * dy1) * inv_area;
+			setup.plane_[k][2] = (d2 * dx1 - d1 * dx2) * inv_area;
+		}
+
+		for (int ty = setup.min_y_ / kTileSize; ty <= setup.max_y_ / kTileSize; ty++)
+		{
+			for (int tx = setup.min_x_ / kTileSize; tx <= setup.max_x_ / kTileSize; tx++)
+			{
+				bins[ty * tiles_x_ + tx].push_back(t);
+			}
+		}
+		count++;
+	}
+	return count;
+}
+
+void SoftRasterizer::RasterizeTriangle(const TriangleSetup& setup, int x0, int y0, int x1, int y1)
+{
+	// 4 pixel groups start on multiples of 4, they never leave the tile nor the padded row
+	x0 &= ~3;
+
+#ifdef SOFT_RASTERIZER_SSE2
+	const __m128 lane = _mm_set_ps(3.f, 2.f, 1.f, 0.f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.f);
+	const __m128 scale = _mm_set1_ps(255.f);
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xff000000u));
+	const __m128 four = _mm_set1_ps(4.f);
+	// the edge functions step exactly in integers, the pixels of a group are offsets from its first
+	__m128i steps[3], bias[3];
+	long long group_step[3];
+	for (int e = 0; e < 3; e++)
+	{
+		int s = setup.edge_[e][0] * kSubpixel;
+		steps[e] = _mm_set_epi32(3 * s, 2 * s, s, 0);
+		bias[e] = _mm_set1_epi32(setup.edge_[e][2] - 1);
+		group_step[e] = 4LL * s;
+	}
+	__m128 plane_x[5];
+	for (int k = 0; k < 5; k++)
+	{
+		plane_x[k] = _mm_set1_ps(setup.plane_[k][1]);
+	}
+	__m128 last_x = _mm_set1_ps(static_cast<float>(x1));
+
+	for (int y = y0; y <= y1; y++)
+	{
+		float dx = x0 + 0.5f - setup.origin_x_;
+		float dy = y + 0.5f - setup.origin_y_;
+		long long sdx = static_cast<long long>(x0) * kSubpixel + kSubpixel / 2 - setup.origin_sx_;
+		long long sdy = static_cast<long long>(y) * kSubpixel + kSubpixel / 2 - setup.origin_sy_;
+		long long edge[3];
+		for (int e = 0; e < 3; e++)
+		{
+			edge[e] = setup.edge_[e][0] * sdx + setup.edge_[e][1] * sdy + setup.edge_c_[e];
+		}
+		// the planes are evaluated at each group, not stepped, so they do not drift along the row
+		__m128 plane_row[5];
+		for (int k = 0; k < 5; k++)
+		{
+			plane_row[k] = _mm_set1_ps(setup.plane_[k][0] + setup.plane_[k][2] * dy);
+		}
+		__m128 dxs = _mm_add_ps(_mm_set1_ps(dx), lane);
+		__m128 xs = _mm_add_ps(_mm_set1_ps(static_cast<float>(x0)), lane);
+		unsigned int* color_row = &pixels_[static_cast<size_t>(y) * stride_];
+		float* depth_row = &depth_[static_cast<size_t>(y) * stride_];
+
+		for (int x = x0; x <= x1; x += 4)
+		{
+			__m128i inside[3];
+			for (int e = 0; e < 3; e++)
+			{
+				inside[e] = _mm_cmpgt_epi32(_mm_add_epi32(_mm_set1_epi32(ClampEdge(edge[e])), steps[e]), bias[e]);
+				edge[e] += group_step[e];
+			}
+			__m128 mask = _mm_castsi128_ps(_mm_and_si128(_mm_and_si128(inside[0], inside[1]), inside[2]));
+			mask = _mm_and_ps(mask, _mm_cmple_ps(xs, last_x));
+			if (_mm_movemask_ps(mask) != 0)
+			{
+				__m128 plane[5];
+				for (int k = 0; k < 5; k++)
+				{
+					plane[k] = _mm_add_ps(_mm_mul_ps(plane_x[k], dxs), plane_row[k]);
+				}
+				__m128 old_depth = _mm_loadu_ps(depth_row + x);
+				mask = _mm_and_ps(mask, _mm_cmplt_ps(plane[0], old_depth));
+				if (_mm_movemask_ps(mask) != 0)
+				{
+					_mm_storeu_ps(depth_row + x, _mm_or_ps(_mm_and_ps(mask, plane[0]), _mm_andnot_ps(mask, old_depth)));
+
+					__m128 w = _mm_div_ps(one, plane[1]);
+					__m128i r = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_mul_ps(plane[2], w), zero), one), scale), half));
+					__m128i g = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_mul_ps(plane[3], w), zero), one), scale), half));
+					__m128i b = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_mul_ps(plane[4], w), zero), one), scale), half));
+					__m128i color = _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(g, 8)), _mm_or_si128(_mm_slli_epi32(b, 16), alpha));
+					__m128i keep = _mm_castps_si128(mask);
+					__m128i old_color = _mm_loadu_si128(reinterpret_cast<const __m128i*>(color_row + x));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(color_row + x),
+						_mm_or_si128(_mm_and_si128(keep, color), _mm_andnot_si128(keep, old_color)));
+				}
+			}
+			dxs = _mm_add_ps(dxs, four);
+			xs = _mm_add_ps(xs, four);
+		}
+	}
+#else
+	for (int y = y0; y <= y1; y++)
+	{
+		float dy = y + 0.5f - setup.origin_y_;
+		long long sdy = static_cast<long long>(y) * kSubpixel + kSubpixel / 2 - setup.origin_sy_;
+		unsigned int* color_row = &pixels_[static_cast<size_t>(y) * stride_];
+		float* depth_row = &depth_[static_cast<size_t>(y) * stride_];
+		for (int x = x0; x <= x1; x++)
+		{
+			float dx = x + 0.5f - setup.origin_x_;
+			long long sdx = static_cast<long long>(x) * kSubpixel + kSubpixel / 2 - setup.origin_sx_;
+			bool inside = true;
+			for (int e = 0; e < 3 && inside; e++)
+			{
+				inside = setup.edge_[e][0] * sdx + setup.edge_[e][1] * sdy + setup.edge_c_[e] >= setup.edge_[e][2];
+			}
+			float plane[5];
+			for (int k = 0; k < 5 && inside; k++)
+			{
+				plane[k] = setup.plane_[k][0] + setup.plane_[k][1] * dx + setup.plane_[k][2] * dy;
+			}
+			if (!inside || plane[0] >= depth_row[x])
+			{
+				continue;
+			}
+			float w = 1.f / plane[1];
+			depth_row[x] = plane[0];
+			color_row[x] = PackColor(plane[2] * w, plane[3] * w, plane[4] * w, 1.f);
+		}
+	}
+#endif
+}
+
+void SoftRasterizer::RasterizeTile(int tile)
+{
+	int x0 = (tile % tiles_x_) * kTileSize;
+	int y0 = (tile / tiles_x_) * kTileSize;
+	int x1 = std::min(x0 + kTileSize, width_) - 1;
+	int y1 = std::min(y0 + kTileSize, height_) - 1;
+
+	unsigned int clear = PackColor(background_[0], background_[1], background_[2], background_[3]);
+	int padded_x1 = std::min(x0 + kTileSize, stride_) - 1;
+	for (int y = y0; y <= y1; y++)
+	{
+		size_t row = static_cast<size_t>(y) * stride_;
+		std::fill(pixels_.begin() + row + x0, pixels_.begin() + row + padded_x1 + 1, clear);
+		std::fill(depth_.begin() + row + x0, depth_.begin() + row + padded_x1 + 1, 1.f);
+	}
+
+	// the bins of the threads hold consecutive triangle ranges, so the order is kept
+	int num_tiles = tiles_x_ * tiles_y_;
+	for (int t = 0; t < num_bin_threads_; t++)
+	{
+		const std::vector<int>& bin = bins_[static_cast<size_t>(t) * num_tiles + tile];
+		for (size_t i = 0; i != bin.size(); i++)
+		{
+			const TriangleSetup& setup = setups_[bin[i]];
+			RasterizeTriangle(setup, std::max(setup.min_x_, x0), std::max(setup.min_y_, y0),
+				std::min(setup.max_x_, x1), std::min(setup.max_y_, y1));
+		}
+	}
+}
+
+void SoftRasterizer::Render(Mesh3D* mesh)
+{
+	num_drawn_triangles_ = 0;
+	if (width_ == 0 || height_ == 0)
+	{
+		return;
+	}
+	int num_vertex = mesh == NULL ? 0 : mesh->num_of_vertex_list();
+	if (num_vertex == 0)
+	{
+		triangles_.clear();
+		mesh_ = NULL;
+	}
+	else
+	{
+		PrepareTriangles(mesh);
+	}
+	int num_triangle = num_triangles();
+
+	// transform and light the vertices
+	vertices_.resize(num_vertex);
+	int num_threads = ThreadCount(num_vertex, 1 << 14);
+	int chunk = (num_vertex + num_threads - 1) / num_threads;
+	if (num_vertex > 0)
+	{
+		RunThreads(num_threads, [&](int t)
+		{
+			TransformVertices(mesh, t * chunk, std::min((t + 1) * chunk, num_vertex));
+		});
+	}
+
+	// set up the triangles and bin them to the tiles
+	int num_tiles = tiles_x_ * tiles_y_;
+	num_bin_threads_ = ThreadCount(num_triangle, 1 << 13);
+	setups_.resize(num_triangle);
+	bins_.resize(static_cast<size_t>(num_bin_threads_) * num_tiles);
+	for (size_t i = 0; i != bins_.size(); i++)
+	{
+		bins_[i].clear();
+	}
+	std::vector<int> counts(num_bin_threads_, 0);
+	chunk = (num_triangle + num_bin_threads_ - 1) / num_bin_threads_;
+	RunThreads(num_bin_threads_, [&](int t)
+	{
+		counts[t] = SetupAndBin(t, t * chunk, std::min((t + 1) * chunk, num_triangle));
+	});
+	for (int t = 0; t < num_bin_threads_; t++)
+	{
+		num_drawn_triangles_ += counts[t];
+	}
+
+	// the threads take the tiles one by one, each tile is cleared then drawn by one thread
+	std::atomic<int> next_tile(0);
+	RunThreads(ThreadCount(num_tiles, 1), [&](int)
+	{
+		for (int tile = next_tile++; tile < num_tiles; tile = next_tile++)
+		{
+			RasterizeTile(tile);
+		}
+	});
+}
+
+bool SoftRasterizer::SavePPM(const char* filename) const
+{
+	FILE *pfile = fopen(filename, "wb");
+	if (pfile == NULL)
+	{
+		return false;
+	}
+	fprintf(pfile, "P6\n%d %d\n255\n", width_, height_);
+	std::vector<unsigned char> row(static_cast<size_t>(width_) * 3);
+	for (int y = 0; y < height_; y++)
+	{
+		for (int x = 0; x < width_; x++)
+		{
+			unsigned int pixel = pixels_[static_cast<size_t>(y) * stride_ + x];
+			row[x * 3] = pixel & 0xff;
+			row[x * 3 + 1] = (pixel >> 8) & 0xff;
+			row[x * 3 + 2] = (pixel >> 16) & 0xff;
+		}
+		fwrite(row.data(), 1, row.size(), pfile);
+	}
+	fclose(pfile);
+	return true;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <vector>
+#include "Mesh3D.h"
+
+/*!
+*	Multithreaded software rasterizer for mesh thumbnails, without OpenGL or Qt.
+*	The camera is the one of RenderingWidget::paintGL: the eye looks at a goal with y up,
+*	through a perspective of fovy degrees (45 with the planes 0.001 and 1000 of resizeGL),
+*	and the mesh is turned by the matrix of CArcBall::GetBallMatrix.
+*	Vertices are lit per vertex with their color_ and normal_, Lambert with the ambient and
+*	the directional light of RenderState, and interpolated perspective-correct over the faces.
+*	The image is cut in tiles of kTileSize pixels; triangles are set up and binned to the
+*	tiles by all threads, then each thread takes whole tiles and walks the edge functions
+*	four pixels at a time with SSE2 (one at a time elsewhere) against a float depth buffer.
+*	The edge functions are integers in sub-pixel units, so the coverage is exact whatever
+*	the size of the triangle.
+*	Triangles are not clipped: those crossing the near plane or far outside the image
+*	are dropped, which a thumbnail framing the whole mesh does not meet.
+*/
+class SoftRasterizer
+{
+public:
+	SoftRasterizer(void);
+	~SoftRasterizer(void);
+
+	//! set the size of the image, in pixels
+	void Resize(int width, int height);
+	int width(void) const {return width_;}
+	int height(void) const {return height_;}
+	//! pixels per row of the buffers, width rounded up to a multiple of 4
+	int stride(void) const {return stride_;}
+
+	//! place the camera as gluLookAt(eye, goal, y) followed by glMultMatrixf(ball_matrix)
+	/*!
+	*	\param ball_matrix column-major rotation of the mesh, NULL for none
+	*/
+	void SetCamera(const Vec3f& eye, const Vec3f& goal, const float* ball_matrix = NULL);
+	void set_fovy(float degrees) {fovy_ = degrees;}
+	void set_background(const Vec4f& color) {background_ = color;}
+	void set_lighting(bool b) {has_lighting_ = b;}
+	void set_backface_culling(bool b) {is_backface_culling_ = b;}
+	//! 0 uses every hardware thread
+	void set_num_threads(int n) {num_threads_ = n;}
+
+	//! draw a mesh into the image
+	void Render(Mesh3D* mesh);
+
+	//! RGBA8 pixels (red in the low byte), rows of stride pixels, the top row first
+	const std::vector<unsigned int>& pixels(void) const {return pixels_;}
+	//! window depth in [0, 1], 1 where nothing was drawn, laid out as the pixels
+	const std::vector<float>& depth(void) const {return depth_;}
+	//! the triangles of the last Render that survived culling and setup
+	int num_drawn_triangles(void) const {return num_drawn_triangles_;}
+	int num_triangles(void) const {return static_cast<int>(triangles_.size() / 3);}
+
+	//! write the image as a binary PPM
+	bool SavePPM(const char* filename) const;
+
+	static const int kTileSize = 64;
+
+private:
+	//! a vertex in window space, y down, with its lit color divided by w
+	struct ScreenVertex
+	{
+		float	x_, y_, z_, inv_w_;
+		float	r_, g_, b_;
+		int		sx_, sy_;		//!< x_ and y_ in sub-pixels
+		bool	valid_;			//!< in front of the near plane and inside the guard band
+	};
+
+	//! edge functions and attribute planes of a triangle, a(x, y) = a0 + ax x + ay y
+	struct TriangleSetup
+	{
+		float	origin_x_, origin_y_;		//!< a vertex, the planes and the edges are relative to it
+		int		origin_sx_, origin_sy_;		//!< in sub-pixels
+		int		edge_[3][3];				//!< A, B, bias: inside if A dx + B dy + C >= bias, in sub-pixels
+		long long	edge_c_[3];				//!< C, a product of sub-pixel coordinates
+		float	plane_[5][3];				//!< z, 1/w, r/w, g/w, b/w
+		int		min_x_, min_y_, max_x_, max_y_;
+	};
+
+	void PrepareTriangles(Mesh3D* mesh);
+	void TransformVertices(Mesh3D* mesh, int first, int last);
+	int SetupAndBin(int thread, int first, int last);
+	void RasterizeTile(int tile);
+	void RasterizeTriangle(const TriangleSetup& setup, int x0, int y0, int x1, int y1);
+	int ThreadCount(int work, int grain) const;
+
+private:
+	int		width_, height_, stride_;
+	int		tiles_x_, tiles_y_;
+	int		num_threads_;
+	int		num_bin_threads_;
+
+	float	modelview_[16];				//!< column-major
+	float	fovy_;
+	Vec4f	background_;
+	bool	has_lighting_;
+	bool	is_backface_culling_;
+
+	Mesh3D*			mesh_;					//!< triangles_ is built for this mesh
+	unsigned int	topology_version_;
+	int				num_drawn_triangles_;
+
+	std::vector<unsigned int>		triangles_;		//!< fans of the faces
+	std::vector<ScreenVertex>		vertices_;
+	std::vector<TriangleSetup>		setups_;		//!< one per triangle
+	std::vector<std::vector<int> >	bins_;			//!< [thread * tiles + tile], triangles in order
+	std::vector<unsigned int>		pixels_;
+	std::vector<float>				depth_;
+};
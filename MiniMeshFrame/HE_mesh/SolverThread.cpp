@@ -0,0 +1,86 @@
+#include "SolverThread.h"
+
+SolverThread::SolverThread(void)
+	: solver_(NULL), publish_interval_(1), is_canceled_(false), is_paused_(false)
+{
+}
+
+SolverThread::~SolverThread(void)
+{
+	Cancel();
+}
+
+void SolverThread::Start(IterativeSolver* solver, int publish_interval)
+{
+	Cancel();
+	if (solver == NULL)
+	{
+		return;
+	}
+	solver_ = solver;
+	publish_interval_ = publish_interval > 0 ? publish_interval : 1;
+	snapshots_.Reset();
+	is_canceled_ = false;
+	thread_ = std::thread(&SolverThread::Run, this);
+}
+
+void SolverThread::Cancel(void)
+{
+	if (solver_ == NULL)
+	{
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		is_canceled_ = true;
+	}
+	resumed_.notify_all();
+	thread_.join();
+	delete solver_;
+	solver_ = NULL;
+}
+
+void SolverThread::Pause(bool paused)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		is_paused_ = paused;
+	}
+	resumed_.notify_all();
+}
+
+void SolverThread::Publish(int iteration, bool finished)
+{
+	SolverSnapshot& snapshot = snapshots_.back();
+	solver_->GetPositions(snapshot.positions_);
+	snapshot.iteration_ = iteration;
+	snapshot.residual_ = solver_->residual();
+	snapshot.is_finished_ = finished;
+	snapshots_.Publish();
+}
+
+void SolverThread::Run(void)
+{
+	for (int iteration = 1; ; iteration++)
+	{
+		if (is_paused_)
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			resumed_.wait(lock, [this]() {return !is_paused_ || is_canceled_;});
+		}
+		if (is_canceled_)
+		{
+			return;
+		}
+
+		bool more = solver_->Iterate();
+		if (!more || iteration % publish_interval_ == 0)
+		{
+			Publish(iteration, !more);
+		}
+		if (!more)
+		{
+			return;
+		}
+	}
+}
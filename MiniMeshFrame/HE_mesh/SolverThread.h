@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Mesh3D.h"
+#include "TripleBuffer.h"
+
+/*!
+*	A geometry solver advanced one iteration at a time by a SolverThread.
+*	The solver works on its own copy of the positions, so the mesh can be drawn while it
+*	runs; it never touches the mesh it was set up from.
+*/
+class IterativeSolver
+{
+public:
+	virtual ~IterativeSolver(void) {}
+
+	//! run one iteration
+	/*!
+	*	\return false once the solve is over, converged or out of iterations
+	*/
+	virtual bool Iterate(void) = 0;
+	//! copy the current positions, indexed by vertex id
+	virtual void GetPositions(std::vector<Vec3f>& positions) const = 0;
+	//! how far the last iteration is from the solution, in the units of the solver
+	virtual float residual(void) const = 0;
+};
+
+//! positions published by a SolverThread
+struct SolverSnapshot
+{
+	std::vector<Vec3f>	positions_;
+	int					iteration_;
+	float				residual_;
+	bool				is_finished_;	//!< the last snapshot of the solve
+};
+
+/*!
+*	Worker thread running an IterativeSolver away from the GUI thread.
+*	Every publish_interval iterations, and after the last one, the positions are handed to
+*	the reader through a TripleBuffer, so the display follows the solve without either side
+*	waiting. The solve can be paused, resumed and canceled between two iterations.
+*/
+class SolverThread
+{
+public:
+	SolverThread(void);
+	~SolverThread(void);
+
+	//! cancel the running solve and start a new one, the thread owns solver
+	void Start(IterativeSolver* solver, int publish_interval);
+	//! stop between two iterations and wait for the thread, nothing more is published
+	void Cancel(void);
+	//! hold the solve between two iterations, a solve started while paused waits too
+	void Pause(bool paused);
+
+	//! a solve was started and not canceled, Cancel also joins a solve that is over
+	bool isRunning(void) const {return solver_ != NULL;}
+	bool isPaused(void) const {return is_paused_;}
+
+	//! take the newest snapshot, false if none was published since the last call
+	bool AcquireSnapshot(void) {return snapshots_.Acquire();}
+	//! the snapshot taken by the last AcquireSnapshot
+	const SolverSnapshot& snapshot(void) const {return snapshots_.front();}
+
+private:
+	void Run(void);
+	void Publish(int iteration, bool finished);
+
+private:
+	IterativeSolver					*solver_;
+	int								publish_interval_;
+	std::thread						thread_;
+	TripleBuffer<SolverSnapshot>	snapshots_;
+
+	std::atomic<bool>				is_canceled_;		//!< both set under mutex_ for resumed_
+	std::atomic<bool>				is_paused_;
+	std::mutex						mutex_;
+	std::condition_variable			resumed_;
+};
@@ -0,0 +1,644 @@
+#include "StreamSimplifier.h"
+
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include <unordered_set>
+
+namespace
+{
+	const int kKeyBits = 21;
+	const long long kKeyBias = 1LL << (kKeyBits - 1);
+	const unsigned long long kKeyMask = (1ULL << kKeyBits) - 1;
+	const unsigned long long kNoKey = ~0ULL;
+	//! triangles per batch, a few milliseconds of work for each thread
+	const size_t kBatchSize = 1 << 17;
+	//! initial size of the tables, they double when half full
+	const size_t kMinTableSize = 1 << 12;
+	const int kVertexCacheSize = 1 << 12;
+
+	inline size_t HashKey(unsigned long long key)
+	{
+		key *= 0x9e3779b97f4a7c15ULL;
+		return static_cast<size_t>(key ^ (key >> 32));
+	}
+
+	inline void DecodeKey(unsigned long long key, long long c[3])
+	{
+		for (int k = 0; k < 3; k++)
+			c[k] = static_cast<long long>((key >> (kKeyBits * k)) & kKeyMask) - kKeyBias;
+	}
+
+	inline unsigned long long EncodeKey(const long long c[3])
+	{
+		unsigned long long key = 0;
+		for (int k = 0; k < 3; k++)
+		{
+			long long x = std::min(std::max(c[k] + kKeyBias, 0LL), static_cast<long long>(kKeyMask));
+			key |= static_cast<unsigned long long>(x) << (kKeyBits * k);
+		}
+		return key;
+	}
+}
+
+void StreamSimplifier::Cell::Add(const Cell& cell)
+{
+	quadric_.Add(cell.quadric_);
+	for (int k = 0; k < 3; k++)
+		sum_[k] += cell.sum_[k];
+	count_ += cell.count_;
+}
+
+StreamSimplifier::CellTriangle::CellTriangle(int a, int b, int c)
+{
+	// rotate, keeping the orientation
+	if (a < b && a < c)
+	{
+		c_[0] = a; c_[1] = b; c_[2] = c;
+	}
+	else if (b < c)
+	{
+		c_[0] = b; c_[1] = c; c_[2] = a;
+	}
+	else
+	{
+		c_[0] = c; c_[1] = a; c_[2] = b;
+	}
+}
+
+StreamSimplifier::StreamSimplifier(void)
+	: max_vertices_(1 << 20), resolution_(0), num_threads_(0), pspill_(NULL), num_spilled_(0), late_data_(NULL)
+	, input_verts_(NULL), grid_ready_(false), cell_size_(1.0f), inv_cell_size_(1.0f), level_(0)
+	, num_input_vertex_(0), num_input_face_(0)
+{
+}
+
+StreamSimplifier::~StreamSimplifier(void)
+{
+	Clear();
+}
+
+void StreamSimplifier::Clear(void)
+{
+	Join();
+	if (pspill_ != NULL)
+	{
+		fclose(pspill_);
+		pspill_ = NULL;
+	}
+	spill_file_.Unmap(spill_view_);
+	spill_file_.Close();
+	num_spilled_ = 0;
+	std::vector<Vec3f>().swap(late_verts_);
+	late_data_ = NULL;
+	std::vector<Grid>().swap(grids_);
+	std::vector<int>().swap(batch_);
+	std::vector<int>().swap(clustering_);
+}
+
+void StreamSimplifier::Reset(void)
+{
+	Clear();
+	out_verts_.clear();
+	out_faces_.clear();
+	input_verts_ = NULL;
+	bbox_[0] = bbox_[1] = bbox_[2] = FLT_MAX;
+	bbox_[3] = bbox_[4] = bbox_[5] = -FLT_MAX;
+	grid_ready_ = false;
+	origin_[0] = origin_[1] = origin_[2] = 0.0f;
+	cell_size_ = 1.0f;
+	level_ = 0;
+	num_input_vertex_ = num_input_face_ = 0;
+
+	int num_threads = num_threads_ > 0 ? num_threads_ : static_cast<int>(std::thread::hardware_concurrency());
+	grids_.resize(std::max(num_threads, 1));
+	for (size_t t = 0; t < grids_.size(); t++)
+	{
+		grids_[t].level_ = 0;
+		grids_[t].vertex_keys_.assign(kVertexCacheSize, std::make_pair(-1, 0ULL));
+		ResizeCellIndex(grids_[t], kMinTableSize);
+		ResizeTriangles(grids_[t], kMinTableSize);
+	}
+	batch_.reserve(3 * kBatchSize);
+}
+
+bool StreamSimplifier::Run(const std::vector<Vec3f>& verts, const std::vector<int>& triangles)
+{
+	Reset();
+	if (verts.empty())
+	{
+		return false;
+	}
+	input_verts_ = &verts[0];
+	num_input_vertex_ = static_cast<long long>(verts.size());
+	for (size_t i = 0; i < verts.size(); i++)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			bbox_[k] = std::min(bbox_[k], verts[i][k]);
+			bbox_[k+3] = std::max(bbox_[k+3], verts[i][k]);
+		}
+	}
+	SetupGrid();
+
+	for (size_t i = 0; i + 2 < triangles.size(); i += 3)
+	{
+		const int *tri = &triangles[i];
+		if (tri[0] < 0 || tri[1] < 0 || tri[2] < 0 || tri[0] >= num_input_vertex_
+			|| tri[1] >= num_input_vertex_ || tri[2] >= num_input_vertex_)
+			continue;
+		batch_.insert(batch_.end(), tri, tri + 3);
+		num_input_face_++;
+		if (batch_.size() >= 3 * kBatchSize)
+			Dispatch();
+	}
+	Dispatch();
+	Join();
+
+	Merge();
+	Extract();
+	Clear();
+	input_verts_ = NULL;
+	return !out_faces_.empty();
+}
+
+bool StreamSimplifier::Run(const char* fins)
+{
+	std::string temp_name = temp_name_.empty() ? std::string(fins) + ".simplify.tmp" : temp_name_;
+	bool is_overflow = false;
+	bool ok = Read(fins, temp_name, false, is_overflow);
+	if (!ok && is_overflow)
+	{
+		// vertices keep coming between the faces: spill them all, then read the faces again
+		ok = Read(fins, temp_name, true, is_overflow);
+	}
+	remove(temp_name.c_str());
+	return ok && !out_faces_.empty();
+}
+
+bool StreamSimplifier::Read(const char* fins, const std::string& temp_name, bool vertices_first, bool& is_overflow)
+{
+	Reset();
+	is_overflow = false;
+	MeshStreamReader reader;
+	if (!reader.Open(fins))
+	{
+		return false;
+	}
+	pspill_ = fopen(temp_name.c_str(), "wb");
+	if (pspill_ == NULL)
+	{
+		return false;
+	}
+
+	// the vertices after the first face stay in memory, as many as the cells at most
+	Vec3f v;
+	std::vector<int> face;
+	MeshStreamRecord record;
+	bool ok = true;
+	while (ok && (record = reader.Next(v, face)) != MS_END)
+	{
+		if (record == MS_VERTEX)
+		{
+			if (grid_ready_)
+			{
+				// the storage is reserved once, the batch being clustered reads it
+				if (late_verts_.empty())
+					late_verts_.reserve(max_vertices_);
+				is_overflow = static_cast<int>(late_verts_.size()) >= max_vertices_;
+				ok = !is_overflow;
+				if (ok)
+					late_verts_.push_back(v);
+			}
+			else
+			{
+				fwrite(v.data(), sizeof(float), 3, pspill_);
+				num_spilled_++;
+			}
+			for (int k = 0; k < 3; k++)
+			{
+				bbox_[k] = std::min(bbox_[k], v[k]);
+				bbox_[k+3] = std::max(bbox_[k+3], v[k]);
+			}
+			num_input_vertex_++;
+		}
+		else if (!vertices_first)
+		{
+			if (!grid_ready_)
+			{
+				ok = BeginFaces(temp_name);
+			}
+			if (ok)
+			{
+				AddFace(face);
+			}
+		}
+	}
+
+	if (ok && vertices_first)
+	{
+		MeshStreamReader faces;
+		ok = BeginFaces(temp_name) && faces.Open(fins);
+		while (ok && (record = faces.Next(v, face)) != MS_END)
+		{
+			if (record == MS_FACE)
+				AddFace(face);
+		}
+	}
+	if (ok)
+	{
+		Dispatch();
+		Join();
+		Merge();
+		Extract();
+	}
+	Clear();
+	return ok;
+}
+
+void StreamSimplifier::AddFace(const std::vector<int>& face)
+{
+	for (size_t i = 0; i < face.size(); i++)
+	{
+		if (face[i] < 0 || face[i] >= num_input_vertex_)
+			return;
+	}
+	for (size_t i = 1; i + 1 < face.size(); i++)
+	{
+		batch_.push_back(face[0]);
+		batch_.push_back(face[i]);
+		batch_.push_back(face[i+1]);
+		num_input_face_++;
+	}
+	if (batch_.size() >= 3 * kBatchSize)
+	{
+		Dispatch();
+	}
+}
+
+void StreamSimplifier::Dispatch(void)
+{
+	Join();
+	// the level one grid reached is as fine as the others need, they skip the finer ones
+	AlignLevels();
+	clustering_.swap(batch_);
+	batch_.clear();
+	late_data_ = late_verts_.empty() ? NULL : &late_verts_[0];
+
+	size_t num_triangle = clustering_.size() / 3;
+	size_t num_grid = grids_.size();
+	if (num_grid == 1 || num_triangle == 0)
+	{
+		Cluster(grids_[0], 0, num_triangle);
+		return;
+	}
+	for (size_t t = 0; t < num_grid; t++)
+	{
+		workers_.push_back(std::thread(&StreamSimplifier::Cluster, this, std::ref(grids_[t]),
+			num_triangle * t / num_grid, num_triangle * (t + 1) / num_grid));
+	}
+}
+
+void StreamSimplifier::Join(void)
+{
+	for (size_t t = 0; t < workers_.size(); t++)
+	{
+		workers_[t].join();
+	}
+	workers_.clear();
+}
+
+bool StreamSimplifier::BeginFaces(const std::string& temp_name)
+{
+	fclose(pspill_);
+	pspill_ = NULL;
+	if (num_spilled_ > 0)
+	{
+		if (!spill_file_.Open(temp_name.c_str(), false))
+		{
+			return false;
+		}
+		spill_view_ = spill_file_.Map(0, static_cast<size_t>(num_spilled_ * 3 * sizeof(float)));
+		if (!spill_view_.isValid())
+		{
+			return false;
+		}
+	}
+	SetupGrid();
+	return true;
+}
+
+void StreamSimplifier::SetupGrid(void)
+{
+	float extent = 0.0f;
+	for (int k = 0; k < 3; k++)
+	{
+		origin_[k] = num_input_vertex_ > 0 ? bbox_[k] : 0.0f;
+		extent = std::max(extent, bbox_[k+3] - bbox_[k]);
+	}
+	// by default start from a grid a surface fills with a few times the budget, the first
+	// coarsenings of a finer grid would only cost time
+	int resolution = resolution_ > 0 ? resolution_ : std::max(static_cast<int>(4.0 * sqrt(static_cast<double>(max_vertices_))), 2);
+	cell_size_ = num_input_vertex_ > 0 && extent > 0.0f ? extent / resolution : 1.0f;
+	inv_cell_size_ = 1.0f / cell_size_;
+	grid_ready_ = true;
+}
+
+const float* StreamSimplifier::position(int v) const
+{
+	if (input_verts_ != NULL)
+	{
+		return input_verts_[v].data();
+	}
+	return v < num_spilled_ ? reinterpret_cast<const float*>(spill_view_.data_) + 3 * static_cast<size_t>(v)
+		: late_data_[v - num_spilled_].data();
+}
+
+unsigned long long StreamSimplifier::CellKey(const float* p, int level) const
+{
+	// in float, the key has far fewer bits than the mantissa
+	long long c[3];
+	for (int k = 0; k < 3; k++)
+	{
+		float x = (p[k] - origin_[k]) * inv_cell_size_;
+		x = std::min(std::max(x, -1e9f), 1e9f);
+		int i = static_cast<int>(x);
+		c[k] = (i - (x < i ? 1 : 0)) >> level;
+	}
+	return EncodeKey(c);
+}
+
+int StreamSimplifier::FindCell(Grid& grid, unsigned long long key)
+{
+	size_t mask = grid.cell_index_.size() - 1;
+	for (size_t slot = HashKey(key) & mask; ; slot = (slot + 1) & mask)
+	{
+		std::pair<unsigned long long, int>& entry = grid.cell_index_[slot];
+		if (entry.first == key)
+		{
+			return entry.second;
+		}
+		if (entry.first == kNoKey)
+		{
+			Cell cell;
+			cell.sum_[0] = cell.sum_[1] = cell.sum_[2] = 0.0;
+			cell.count_ = 0.0;
+			cell.key_ = key;
+			int id = static_cast<int>(grid.cells_.size());
+			grid.cells_.push_back(cell);
+			entry = std::make_pair(key, id);
+			if (2 * grid.cells_.size() > grid.cell_index_.size())
+			{
+				ResizeCellIndex(grid, 2 * grid.cell_index_.size());
+			}
+			return id;
+		}
+	}
+}
+
+void StreamSimplifier::InsertTriangle(Grid& grid, const CellTriangle& t)
+{
+	size_t mask = grid.triangles_.size() - 1;
+	for (size_t slot = CellTriangleHash()(t) & mask; ; slot = (slot + 1) & mask)
+	{
+		CellTriangle& entry = grid.triangles_[slot];
+		if (entry == t)
+		{
+			return;
+		}
+		if (entry.c_[0] < 0)
+		{
+			entry = t;
+			grid.num_triangles_++;
+			if (2 * grid.num_triangles_ > grid.triangles_.size())
+			{
+				ResizeTriangles(grid, 2 * grid.triangles_.size());
+			}
+			return;
+		}
+	}
+}
+
+void StreamSimplifier::ResizeCellIndex(Grid& grid, size_t size)
+{
+	grid.cell_index_.assign(size, std::make_pair(kNoKey, -1));
+	size_t mask = size - 1;
+	for (size_t i = 0; i < grid.cells_.size(); i++)
+	{
+		size_t slot = HashKey(grid.cells_[i].key_) & mask;
+		while (grid.cell_index_[slot].first != kNoKey)
+			slot = (slot + 1) & mask;
+		grid.cell_index_[slot] = std::make_pair(grid.cells_[i].key_, static_cast<int>(i));
+	}
+}
+
+void StreamSimplifier::ResizeTriangles(Grid& grid, size_t size)
+{
+	std::vector<CellTriangle> triangles(size);
+	grid.triangles_.swap(triangles);
+	grid.num_triangles_ = 0;
+	for (size_t i = 0; i < triangles.size(); i++)
+	{
+		if (triangles[i].c_[0] >= 0)
+			InsertTriangle(grid, triangles[i]);
+	}
+}
+
+void StreamSimplifier::Cluster(Grid& grid, size_t first, size_t last)
+{
+	for (size_t i = first; i < last; i++)
+	{
+		AddTriangle(grid, &clustering_[3 * i]);
+	}
+}
+
+void StreamSimplifier::AddTriangle(Grid& grid, const int* tri)
+{
+	const float *p[3] = {position(tri[0]), position(tri[1]), position(tri[2])};
+
+	double e1[3], e2[3];
+	for (int k = 0; k < 3; k++)
+	{
+		e1[k] = p[1][k] - p[0][k];
+		e2[k] = p[2][k] - p[0][k];
+	}
+	// the plane of the unit normal weighted by the area is that of the cross product n weighted by 1/(2|n|)
+	double n[3] = {e1[1]*e2[2] - e1[2]*e2[1], e1[2]*e2[0] - e1[0]*e2[2], e1[0]*e2[1] - e1[1]*e2[0]};
+	double len = sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+	double d = -(n[0]*p[0][0] + n[1]*p[0][1] + n[2]*p[0][2]);
+	double w = len > 0.0 ? 0.5 / len : 0.0;
+
+	unsigned long long keys[3];
+	for (int k = 0; k < 3; k++)
+	{
+		std::pair<int, unsigned long long>& cached = grid.vertex_keys_[tri[k] & (kVertexCacheSize - 1)];
+		if (cached.first != tri[k])
+			cached = std::make_pair(tri[k], CellKey(p[k], grid.level_));
+		keys[k] = cached.second;
+	}
+	if (keys[0] == keys[1] && keys[1] == keys[2])
+	{
+		// the common case once the grid is coarse, the triangle collapses in one cell
+		Cell& cell = grid.cells_[FindCell(grid, keys[0])];
+		cell.quadric_.AddPlane(n[0], n[1], n[2], d, 3.0 * w);
+		for (int j = 0; j < 3; j++)
+			cell.sum_[j] += p[0][j] + p[1][j] + p[2][j];
+		cell.count_ += 3.0;
+		if (static_cast<int>(grid.cells_.size()) > max_vertices_)
+			Coarsen(grid);
+		return;
+	}
+
+	Quadric q;
+	q.AddPlane(n[0], n[1], n[2], d, w);
+	int cells[3];
+	for (int k = 0; k < 3; k++)
+	{
+		cells[k] = (k > 0 && keys[k] == keys[0]) ? cells[0]
+			: (k > 1 && keys[k] == keys[1]) ? cells[1] : FindCell(grid, keys[k]);
+		Cell& cell = grid.cells_[cells[k]];
+		cell.quadric_.Add(q);
+		for (int j = 0; j < 3; j++)
+			cell.sum_[j] += p[k][j];
+		cell.count_ += 1.0;
+	}
+	if (cells[0] != cells[1] && cells[1] != cells[2] && cells[2] != cells[0])
+	{
+		InsertTriangle(grid, CellTriangle(cells[0], cells[1], cells[2]));
+	}
+
+	while (static_cast<int>(grid.cells_.size()) > max_vertices_)
+	{
+		Coarsen(grid);
+	}
+}
+
+void StreamSimplifier::Coarsen(Grid& grid)
+{
+	grid.level_++;
+	grid.vertex_keys_.assign(kVertexCacheSize, std::make_pair(-1, 0ULL));
+	std::vector<Cell> cells;
+	cells.swap(grid.cells_);
+	std::vector<CellTriangle> triangles(grid.triangles_.size());
+	triangles.swap(grid.triangles_);
+	grid.num_triangles_ = 0;
+	ResizeCellIndex(grid, grid.cell_index_.size());
+
+	std::vector<int> remap(cells.size());
+	for (size_t i = 0; i < cells.size(); i++)
+	{
+		long long c[3];
+		DecodeKey(cells[i].key_, c);
+		for (int k = 0; k < 3; k++)
+			c[k] >>= 1;
+		remap[i] = FindCell(grid, EncodeKey(c));
+		grid.cells_[remap[i]].Add(cells[i]);
+	}
+	for (size_t i = 0; i < triangles.size(); i++)
+	{
+		if (triangles[i].c_[0] < 0)
+			continue;
+		int a = remap[triangles[i].c_[0]], b = remap[triangles[i].c_[1]], c = remap[triangles[i].c_[2]];
+		if (a != b && b != c && c != a)
+			InsertTriangle(grid, CellTriangle(a, b, c));
+	}
+}
+
+void StreamSimplifier::AlignLevels(void)
+{
+	int level = 0;
+	for (size_t t = 0; t < grids_.size(); t++)
+	{
+		level = std::max(level, grids_[t].level_);
+	}
+	for (size_t t = 0; t < grids_.size(); t++)
+	{
+		while (grids_[t].level_ < level)
+			Coarsen(grids_[t]);
+	}
+}
+
+void StreamSimplifier::Merge(void)
+{
+	AlignLevels();
+
+	// the keys are those of the same level, a triangle found by several threads is kept once
+	Grid& merged = grids_[0];
+	for (size_t t = 1; t < grids_.size(); t++)
+	{
+		const Grid& grid = grids_[t];
+		std::vector<int> remap(grid.cells_.size());
+		for (size_t i = 0; i < grid.cells_.size(); i++)
+		{
+			remap[i] = FindCell(merged, grid.cells_[i].key_);
+			merged.cells_[remap[i]].Add(grid.cells_[i]);
+		}
+		for (size_t i = 0; i < grid.triangles_.size(); i++)
+		{
+			const CellTriangle& tri = grid.triangles_[i];
+			if (tri.c_[0] >= 0)
+				InsertTriangle(merged, CellTriangle(remap[tri.c_[0]], remap[tri.c_[1]], remap[tri.c_[2]]));
+		}
+		std::vector<Cell>().swap(grids_[t].cells_);
+		std::vector<CellTriangle>().swap(grids_[t].triangles_);
+		std::vector<std::pair<unsigned long long, int> >().swap(grids_[t].cell_index_);
+	}
+	while (static_cast<int>(merged.cells_.size()) > max_vertices_)
+	{
+		Coarsen(merged);
+	}
+	level_ = merged.level_;
+}
+
+void StreamSimplifier::Extract(void)
+{
+	// only the cells used by a kept triangle become vertices, and a triangle reusing a
+	// directed edge is dropped as the half-edge structure cannot hold it
+	const Grid& grid = grids_[0];
+	std::vector<int> index(grid.cells_.size(), -1);
+	std::unordered_set<unsigned long long> edges;
+	edges.reserve(3 * grid.num_triangles_);
+	float size = cell_size();
+	for (std::vector<CellTriangle>::const_iterator it = grid.triangles_.begin(); it != grid.triangles_.end(); ++it)
+	{
+		if (it->c_[0] < 0)
+			continue;
+		unsigned long long keys[3];
+		for (int k = 0; k < 3; k++)
+			keys[k] = (static_cast<unsigned long long>(it->c_[k]) << 32) | static_cast<unsigned int>(it->c_[(k+1)%3]);
+		if (edges.count(keys[0]) || edges.count(keys[1]) || edges.count(keys[2]))
+			continue;
+		edges.insert(keys, keys + 3);
+
+		for (int k = 0; k < 3; k++)
+		{
+			int c = it->c_[k];
+			if (index[c] < 0)
+			{
+				index[c] = static_cast<int>(out_verts_.size());
+				const Cell& cell = grid.cells_[c];
+				long long coord[3];
+				DecodeKey(cell.key_, coord);
+
+				// the quadric minimizer, unless it leaves the neighborhood of the cell
+				double p[3];
+				bool inside = cell.quadric_.Minimize(p);
+				for (int j = 0; j < 3 && inside; j++)
+				{
+					double lo = origin_[j] + (coord[j] - 0.5) * size;
+					double hi = origin_[j] + (coord[j] + 1.5) * size;
+					inside = p[j] >= lo && p[j] <= hi;
+				}
+				if (!inside)
+				{
+					for (int j = 0; j < 3; j++)
+						p[j] = cell.sum_[j] / cell.count_;
+				}
+				out_verts_.push_back(Vec3f(static_cast<float>(p[0]), static_cast<float>(p[1]), static_cast<float>(p[2])));
+			}
+			out_faces_.push_back(index[c]);
+		}
+	}
+}
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <thread>
+#include "MeshStream.h"
+#include "MappedFile.h"
+#include "Quadric.h"
+
+/*!
+*	Out-of-core simplification by vertex clustering (Lindstrom, 2000).
+*	The triangles of an OBJ or PLY file are read in a single pass without building a Mesh3D.
+*	Each vertex falls in a cell of a uniform grid, the cells accumulate the quadrics of their
+*	triangles and are represented by the point minimizing them; only the triangles spanning
+*	three cells are kept. Whenever the number of occupied cells exceeds the vertex budget the
+*	grid is coarsened by a factor of two, so the memory stays bounded by the budget whatever
+*	the input size. Positions are spilled to a memory-mapped temporary file to resolve indices;
+*	the vertices that follow the first face are kept in memory up to the budget, past it the
+*	file is read twice, first its vertices and then its faces.
+*	The result is an indexed mesh ready for Mesh3D::CreateMesh.
+*
+*	The triangles are clustered in batches while the next batch is parsed. Each thread has its
+*	own grid and takes an equal share of every batch; a grid is coarsened against the budget on
+*	its own, the others follow it between batches, and the grids are merged at the end, which
+*	gives the cells and the triangles of a single threaded run. The cells and the triangles are
+*	kept in open addressing tables and the keys of the recent vertices are cached. A thread
+*	clusters 10-18M triangles/s, the larger the budget the slower, and parsing takes 20M/s for
+*	OBJ files and 27M/s for binary PLY files: two or three threads reach the 20M/s of the parsing.
+*	The memory is bounded by the budget times the number of threads.
+*/
+class StreamSimplifier
+{
+public:
+	StreamSimplifier(void);
+	~StreamSimplifier(void);
+
+	//! the largest number of output vertices
+	void set_max_vertices(int n) {max_vertices_ = n > 4 ? n : 4;}
+	int max_vertices(void) const {return max_vertices_;}
+	//! cells along the largest side of the bounding box before any coarsening, 0 to derive it from the budget
+	void set_resolution(int r) {resolution_ = r > 0 ? r : 0;}
+	//! file receiving the vertex positions during the run, by default next to the input
+	void set_temp_file(const char* name) {temp_name_ = name;}
+	//! 0 uses every hardware thread
+	void set_num_threads(int n) {num_threads_ = n;}
+
+	//! simplify an OBJ or PLY file
+	/*!
+	*	\return false if the file cannot be read or has no triangle
+	*/
+	bool Run(const char* fins);
+	//! simplify a mesh held in memory, in the layout of Mesh3D::CreateMesh
+	bool Run(const std::vector<Vec3f>& verts, const std::vector<int>& triangles);
+
+	const std::vector<Vec3f>& vertices(void) const {return out_verts_;}
+	const std::vector<int>& triangles(void) const {return out_faces_;}
+	long long num_input_vertex(void) const {return num_input_vertex_;}
+	long long num_input_face(void) const {return num_input_face_;}
+	//! the size of the cells of the final grid
+	float cell_size(void) const {return cell_size_ * static_cast<float>(1 << level_);}
+
+private:
+	struct Cell
+	{
+		Quadric				quadric_;
+		double				sum_[3];		//!< sum of the corners, the fallback representative
+		double				count_;
+		unsigned long long	key_;
+
+		void Add(const Cell& cell);
+	};
+
+	//! a triangle of cells, rotated so that the smallest index comes first
+	struct CellTriangle
+	{
+		int c_[3];
+
+		//! an empty slot of the triangle table
+		CellTriangle(void) {c_[0] = c_[1] = c_[2] = -1;}
+		CellTriangle(int a, int b, int c);
+		bool operator == (const CellTriangle& t) const
+		{
+			return c_[0] == t.c_[0] && c_[1] == t.c_[1] && c_[2] == t.c_[2];
+		}
+	};
+
+	struct CellTriangleHash
+	{
+		size_t operator () (const CellTriangle& t) const
+		{
+			unsigned long long h = static_cast<unsigned long long>(t.c_[0]) * 0x9e3779b97f4a7c15ULL;
+			h ^= static_cast<unsigned long long>(t.c_[1]) * 0xc2b2ae3d27d4eb4fULL;
+			h ^= static_cast<unsigned long long>(t.c_[2]) * 0x165667b19e3779f9ULL;
+			return static_cast<size_t>(h ^ (h >> 29));
+		}
+	};
+
+	//! the cells and the triangles of cells gathered by one thread
+	struct Grid
+	{
+		int					level_;			//!< number of coarsenings
+		std::vector<Cell>	cells_;
+		//! open addressing table from the keys to cells_, the size a power of two
+		std::vector<std::pair<unsigned long long, int> >	cell_index_;
+		//! open addressing set of the triangles spanning three cells
+		std::vector<CellTriangle>	triangles_;
+		size_t				num_triangles_;
+		//! direct mapped cache of the keys of the vertices, each is shared by about six triangles
+		std::vector<std::pair<int, unsigned long long> >	vertex_keys_;
+	};
+
+	void Reset(void);
+	//! one reading of a file, or two with vertices_first: all the vertices, then the faces
+	/*!
+	*	\param is_overflow set if more vertices came after the first face than the budget
+	*/
+	bool Read(const char* fins, const std::string& temp_name, bool vertices_first, bool& is_overflow);
+	//! triangulate a face as a fan into the batch, skipped if it names a vertex not read yet
+	void AddFace(const std::vector<int>& face);
+	//! start clustering the batch, once the previous one is done
+	void Dispatch(void);
+	//! wait for the batch being clustered
+	void Join(void);
+	//! switch from spilling positions to looking them up, at the first face
+	bool BeginFaces(const std::string& temp_name);
+	//! place the grid on the bounding box of the vertices read so far
+	void SetupGrid(void);
+	const float* position(int v) const;
+	unsigned long long CellKey(const float* p, int level) const;
+	//! the cell of a key, created if missing
+	int FindCell(Grid& grid, unsigned long long key);
+	void InsertTriangle(Grid& grid, const CellTriangle& t);
+	//! rebuild the tables of a grid with size slots, a power of two
+	void ResizeCellIndex(Grid& grid, size_t size);
+	void ResizeTriangles(Grid& grid, size_t size);
+	//! cluster the triangles [first, last) of the batch
+	void Cluster(Grid& grid, size_t first, size_t last);
+	void AddTriangle(Grid& grid, const int* tri);
+	//! halve the resolution of a grid, merging cells and dropping collapsed triangles
+	void Coarsen(Grid& grid);
+	//! coarsen the grids to the coarsest of them
+	void AlignLevels(void);
+	//! bring the grids to a common level and gather them in the first one
+	void Merge(void);
+	void Extract(void);
+	void Clear(void);
+
+private:
+	int						max_vertices_;
+	int						resolution_;
+	std::string				temp_name_;
+	int						num_threads_;
+
+	FILE					*pspill_;
+	MappedFile				spill_file_;
+	MappedView				spill_view_;
+	long long				num_spilled_;
+	std::vector<Vec3f>		late_verts_;	//!< vertices found after the first face, max_vertices at most
+	const Vec3f				*late_data_;	//!< late_verts_ as seen by the batch being clustered
+	const Vec3f				*input_verts_;	//!< the vertices of an in-memory run, NULL for files
+	float					bbox_[6];
+
+	bool					grid_ready_;
+	float					origin_[3];
+	float					cell_size_;
+	float					inv_cell_size_;
+	int						level_;			//!< number of coarsenings of the merged grid
+
+	std::vector<Grid>		grids_;			//!< one per thread
+	std::vector<int>		batch_;			//!< triangles waiting to be clustered
+	std::vector<int>		clustering_;	//!< triangles being clustered
+	std::vector<std::thread>	workers_;
+
+	long long				num_input_vertex_;
+	long long				num_input_face_;
+	std::vector<Vec3f>		out_verts_;
+	std::vector<int>		out_faces_;
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+
+/*!
+*	Lock-free hand-over of values from one writer thread to one reader thread.
+*	The writer fills back() and publishes it, the reader takes the newest published value
+*	with Acquire() and reads front(). Neither side waits for the other: the third buffer is
+*	the one in the middle, swapped atomically with the back buffer on Publish() and with
+*	the front buffer on Acquire() when it holds a value not yet taken.
+*/
+template<class T>
+class TripleBuffer
+{
+public:
+	TripleBuffer(void) : back_(0), front_(1), middle_(2) {}
+
+	//! forget the published values, neither side may be using the buffer
+	void Reset(void)
+	{
+		back_ = 0;
+		front_ = 1;
+		middle_.store(2);
+	}
+
+	//! writer: the buffer to fill
+	T& back(void) {return buffers_[back_];}
+	//! writer: hand the back buffer over, the reader sees it on its next Acquire()
+	void Publish(void)
+	{
+		back_ = middle_.exchange(back_ | kFresh) & kIndex;
+	}
+
+	//! reader: take the newest published buffer
+	/*!
+	*	\return false if nothing was published since the last call, front() is unchanged
+	*/
+	bool Acquire(void)
+	{
+		if ((middle_.load() & kFresh) == 0)
+		{
+			return false;
+		}
+		front_ = middle_.exchange(front_) & kIndex;
+		return true;
+	}
+	//! reader: the buffer taken by the last Acquire()
+	const T& front(void) const {return buffers_[front_];}
+
+private:
+	static const int kIndex = 3;
+	static const int kFresh = 4;
+
+	T					buffers_[3];
+	int					back_;			//!< owned by the writer
+	int					front_;			//!< owned by the reader
+	std::atomic<int>	middle_;		//!< index of the third buffer, kFresh if published and not taken
+};
@@ -0,0 +1,67 @@
+#include "VertexAdjacency.h"
+
+VertexAdjacency::VertexAdjacency(void)
+	: num_boundary_(0)
+{
+}
+
+VertexAdjacency::~VertexAdjacency(void)
+{
+}
+
+void VertexAdjacency::Clear(void)
+{
+	std::vector<int>().swap(offsets_);
+	std::vector<int>().swap(indices_);
+	std::vector<int>().swap(opposites_);
+	std::vector<unsigned char>().swap(boundary_);
+	num_boundary_ = 0;
+}
+
+void VertexAdjacency::Build(Mesh3D* mesh)
+{
+	Clear();
+	int num_vertex = mesh == NULL ? 0 : mesh->num_of_vertex_list();
+	if (num_vertex == 0)
+	{
+		return;
+	}
+	const std::vector<HE_vert*>& verts = *(mesh->get_vertex_list());
+	offsets_.reserve(num_vertex + 1);
+	indices_.reserve(static_cast<size_t>(mesh->num_of_edge_list()) * 2);
+	opposites_.reserve(static_cast<size_t>(mesh->num_of_edge_list()) * 4);
+	boundary_.resize(num_vertex, 0);
+
+	offsets_.push_back(0);
+	for (int i = 0; i < num_vertex; i++)
+	{
+		HE_vert *vert = verts[i];
+		HE_edge *start = vert->pedge_;
+		if (start != NULL)
+		{
+			// a boundary vertex is walked from its outgoing boundary edge, see BoundaryCheck
+			if (vert->isOnBoundary())
+			{
+				boundary_[i] = 1;
+				num_boundary_++;
+				for (int k = 0; k < vert->degree() && start->pface_ != NULL; k++)
+				{
+					start = start->pprev_->ppair_;
+				}
+			}
+			HE_edge *pedge = start;
+			do
+			{
+				indices_.push_back(pedge->pvert_->id_);
+				opposites_.push_back(pedge->pface_ != NULL ? pedge->pnext_->pvert_->id_ : -1);
+				opposites_.push_back(pedge->ppair_->pface_ != NULL ? pedge->ppair_->pnext_->pvert_->id_ : -1);
+				if (pedge->ppair_->pface_ == NULL)
+				{
+					break;
+				}
+				pedge = pedge->ppair_->pnext_;
+			} while (pedge != start);
+		}
+		offsets_.push_back(static_cast<int>(indices_.size()));
+	}
+}
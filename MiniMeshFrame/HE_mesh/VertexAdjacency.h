@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+#include "Mesh3D.h"
+
+/*!
+*	One-rings of the vertices of a mesh in compressed rows (CSR), for solvers that sweep
+*	the vertices many times: the neighbors of vertex i are indices()[offsets()[i]] up to
+*	indices()[offsets()[i + 1]], in the order of the half-edges around the vertex.
+*	Each of these edges also keeps the two vertices opposite to it, in the face of the
+*	half-edge leaving vertex i and in the face of its pair (the corner triangles of polygons),
+*	-1 on the boundary side, for the weights that need the angles of the edge.
+*	Built once from the half-edges, it does not follow later changes of the connectivity.
+*/
+class VertexAdjacency
+{
+public:
+	VertexAdjacency(void);
+	~VertexAdjacency(void);
+
+	void Build(Mesh3D* mesh);
+	void Clear(void);
+
+	int num_vertex(void) const {return offsets_.empty() ? 0 : static_cast<int>(offsets_.size()) - 1;}
+	int num_boundary(void) const {return num_boundary_;}
+	int degree(int i) const {return offsets_[i + 1] - offsets_[i];}
+	const int* neighbors(int i) const {return indices_.data() + offsets_[i];}
+	//! two per neighbor: the opposite vertex on the side of the outgoing then the incoming half-edge
+	const int* opposites(int i) const {return opposites_.data() + 2 * offsets_[i];}
+	bool is_boundary(int i) const {return boundary_[i] != 0;}
+
+	const std::vector<int>& offsets(void) const {return offsets_;}
+	const std::vector<int>& indices(void) const {return indices_;}
+
+private:
+	std::vector<int>			offsets_;		//!< num_vertex + 1 entries
+	std::vector<int>			indices_;
+	std::vector<int>			opposites_;		//!< 2 per entry of indices_
+	std::vector<unsigned char>	boundary_;
+	int							num_boundary_;
+};
@@ -0,0 +1,716 @@
+#include "MeshRenderer.h"
+#include "HE_mesh/Mesh3D.h"
+
+#include <cstddef>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <thread>
+
+namespace
+{
+	// the fixed-function arrays take signed shorts only, ranges are centered on the offset
+	const float kShortSteps = 32767.f;
+
+	unsigned char ToByte(float c)
+	{
+		return static_cast<unsigned char>((c < 0.f ? 0.f : (c > 1.f ? 1.f : c)) * 255.f + 0.5f);
+	}
+
+	short ToShort(float v, float offset, float scale)
+	{
+		float q = floor((v - offset) / scale + 0.5f);
+		return static_cast<short>(q < -kShortSteps ? -kShortSteps : (q > kShortSteps ? kShortSteps : q));
+	}
+
+	float SignNotZero(float v)
+	{
+		return v < 0.f ? -1.f : 1.f;
+	}
+
+	//! map a unit normal to the square [-1,1]^2 through the octahedron |x|+|y|+|z|=1
+	void EncodeOctahedral(const Vec3f& n, float& u, float& v)
+	{
+		float l1 = fabs(n[0]) + fabs(n[1]) + fabs(n[2]);
+		if (l1 == 0.f)
+		{
+			u = v = 0.f;
+			return;
+		}
+		u = n[0] / l1;
+		v = n[1] / l1;
+		if (n[2] < 0.f)
+		{
+			// the lower half folds over the diagonals
+			float fu = (1.f - fabs(v)) * SignNotZero(u);
+			float fv = (1.f - fabs(u)) * SignNotZero(v);
+			u = fu;
+			v = fv;
+		}
+	}
+
+	Vec3f DecodeOctahedral(float u, float v)
+	{
+		Vec3f n(u, v, 1.f - fabs(u) - fabs(v));
+		if (n[2] < 0.f)
+		{
+			n[0] = (1.f - fabs(v)) * SignNotZero(u);
+			n[1] = (1.f - fabs(u)) * SignNotZero(v);
+		}
+		return n;
+	}
+}
+
+MeshRenderer::MeshRenderer(void)
+	: initialized_(false), vertex_buffer_(0), face_buffer_(0), edge_buffer_(0)
+	, num_vertex_(0), is_corner_texcoords_(false), is_corner_normals_(false), num_face_index_(0), num_edge_index_(0)
+	, mesh_(NULL), topology_version_(0), geometry_version_(0)
+	, format_(VERTEX_FLOAT)
+	, multi_draw_elements_(NULL), is_frustum_culling_(true), is_backface_culling_(false), culled_ratio_(0.f)
+{
+	for (int k = 0; k < 3; k++)
+	{
+		position_offset_[k] = 0.f;
+		position_scale_[k] = 1.f;
+	}
+	for (int k = 0; k < 2; k++)
+	{
+		texcoord_offset_[k] = 0.f;
+		texcoord_scale_[k] = 1.f;
+	}
+	memset(&error_, 0, sizeof(error_));
+}
+
+MeshRenderer::~MeshRenderer(void)
+{
+	// the buffers die with the context if Release was not called
+}
+
+bool MeshRenderer::Initialize(void)
+{
+	QOpenGLContext *context = QOpenGLContext::currentContext();
+	if (context == NULL)
+	{
+		return false;
+	}
+	initializeOpenGLFunctions();
+	if (!hasOpenGLFeature(QOpenGLFunctions::Buffers))
+	{
+		return false;
+	}
+	glGenBuffers(1, &vertex_buffer_);
+	glGenBuffers(1, &face_buffer_);
+	glGenBuffers(1, &edge_buffer_);
+	multi_draw_elements_ = reinterpret_cast<MultiDrawElements>(context->getProcAddress("glMultiDrawElements"));
+	initialized_ = true;
+	mesh_ = NULL;
+	return true;
+}
+
+void MeshRenderer::Release(void)
+{
+	if (!initialized_)
+	{
+		return;
+	}
+	glDeleteBuffers(1, &vertex_buffer_);
+	glDeleteBuffers(1, &face_buffer_);
+	glDeleteBuffers(1, &edge_buffer_);
+	vertex_buffer_ = face_buffer_ = edge_buffer_ = 0;
+	num_vertex_ = num_face_index_ = num_edge_index_ = 0;
+	std::vector<int>().swap(seam_source_);
+	std::vector<HE_edge*>().swap(corners_);
+	meshlets_.Clear();
+	initialized_ = false;
+	mesh_ = NULL;
+}
+
+void MeshRenderer::set_vertex_format(VertexFormat format)
+{
+	if (format != format_)
+	{
+		format_ = format;
+		mesh_ = NULL;
+	}
+}
+
+size_t MeshRenderer::buffer_size(void) const
+{
+	return static_cast<size_t>(num_buffer_vertex()) * vertex_size()
+		+ static_cast<size_t>(num_face_index_ + num_edge_index_) * sizeof(GLuint);
+}
+
+bool MeshRenderer::Update(Mesh3D* mesh)
+{
+	if (!initialized_ || mesh == NULL)
+	{
+		return false;
+	}
+
+	int first, last;
+	bool rebuild = mesh != mesh_ || mesh->topology_version() != topology_version_;
+	is_corner_texcoords_ = !corners_.empty() && mesh->has_file_texcoords() && mesh->tex_mapping() == TEX_FROM_FILE;
+	if (!rebuild && mesh->geometry_version() != geometry_version_)
+	{
+		geometry_version_ = mesh->geometry_version();
+		if (mesh->TakeDirtyRange(first, last))
+		{
+			// the copies of the vertices [first, last) at the seams
+			last = last < num_vertex_ ? last : num_vertex_;
+			int seam_first = num_vertex_ + static_cast<int>(std::lower_bound(seam_source_.begin(), seam_source_.end(), first) - seam_source_.begin());
+			int seam_last = num_vertex_ + static_cast<int>(std::lower_bound(seam_source_.begin(), seam_source_.end(), last) - seam_source_.begin());
+			if (format_ == VERTEX_COMPACT && !(InsideRanges(mesh, first, last) && InsideRanges(mesh, seam_first, seam_last)))
+			{
+				// the moved vertices left the quantization box, all the vertices are encoded again
+				ComputeRanges(mesh);
+				memset(&error_, 0, sizeof(error_));
+				UploadVertices(mesh, 0, num_buffer_vertex());
+			}
+			else
+			{
+				UploadVertices(mesh, first, last);
+				UploadVertices(mesh, seam_first, seam_last);
+			}
+			meshlets_.Refit(mesh, first, last);
+		}
+	}
+	if (rebuild)
+	{
+		// new connectivity, everything is rebuilt
+		mesh->TakeDirtyRange(first, last);
+		mesh_ = mesh;
+		topology_version_ = mesh->topology_version();
+		geometry_version_ = mesh->geometry_version();
+		num_vertex_ = mesh->num_of_vertex_list();
+		std::vector<int> corner_index;
+		BuildSeams(mesh, corner_index);
+		is_corner_texcoords_ = !corners_.empty() && mesh->has_file_texcoords() && mesh->tex_mapping() == TEX_FROM_FILE;
+
+		if (format_ == VERTEX_COMPACT)
+		{
+			ComputeRanges(mesh);
+		}
+		memset(&error_, 0, sizeof(error_));
+		BuildVertices(mesh, 0, num_buffer_vertex());
+		glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
+		glBufferData(GL_ARRAY_BUFFER, staging_.size(), staging_.empty() ? NULL : &staging_[0], GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		BuildIndices(mesh, corner_index);
+	}
+	// the staging copy of a large mesh is not kept between updates
+	std::vector<unsigned char>().swap(staging_);
+	return num_vertex_ > 0;
+}
+
+void MeshRenderer::ComputeRanges(Mesh3D* mesh)
+{
+	mesh->ComputeBoundingBox();
+	Vec3f low = mesh->bounding_box_min();
+	Vec3f high = mesh->bounding_box_max();
+	// a flat axis takes the extent of the largest one, so moving off the plane keeps its precision
+	// until it leaves that range and the ranges are fitted again
+	float extent = 0.f;
+	for (int k = 0; k < 3; k++)
+	{
+		extent = high[k] - low[k] > extent ? high[k] - low[k] : extent;
+	}
+	extent = extent > 0.f ? extent : 1.f;
+	for (int k = 0; k < 3; k++)
+	{
+		position_offset_[k] = 0.5f * (low[k] + high[k]);
+		position_scale_[k] = 0.5f * (high[k] > low[k] ? high[k] - low[k] : extent) / kShortSteps;
+	}
+
+	const std::vector<HE_vert*>& verts = *(mesh->get_vertex_list());
+	float tmin[2] = {0.f, 0.f}, tmax[2] = {0.f, 0.f};
+	for (int i = 0; i < num_buffer_vertex(); ++i)
+	{
+		for (int k = 0; k < 2; k++)
+		{
+			float t = TexCoord(verts, i)[k];
+			if (i == 0 || t < tmin[k])
+			{
+				tmin[k] = t;
+			}
+			if (i == 0 || t > tmax[k])
+			{
+				tmax[k] = t;
+			}
+		}
+	}
+	for (int k = 0; k < 2; k++)
+	{
+		// a constant coordinate is given the range [t - 1, t + 1]
+		texcoord_offset_[k] = 0.5f * (tmin[k] + tmax[k]);
+		texcoord_scale_[k] = (tmax[k] > tmin[k] ? 0.5f * (tmax[k] - tmin[k]) : 1.f) / kShortSteps;
+	}
+}
+
+bool MeshRenderer::InsideRanges(Mesh3D* mesh, int first, int last) const
+{
+	const std::vector<HE_vert*>& verts = *(mesh->get_vertex_list());
+	for (int i = first; i < last; i++)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			float q = (SourceVertex(verts, i)->position_[k] - position_offset_[k]) / position_scale_[k];
+			if (fabs(q) > kShortSteps + 0.5f)
+			{
+				return false;
+			}
+		}
+		for (int k = 0; k < 2; k++)
+		{
+			float q = (TexCoord(verts, i)[k] - texcoord_offset_[k]) / texcoord_scale_[k];
+			if (fabs(q) > kShortSteps + 0.5f)
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+void MeshRenderer::UploadVertices(Mesh3D* mesh, int first, int last)
+{
+	if (first >= last)
+	{
+		return;
+	}
+	BuildVertices(mesh, first, last);
+	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
+	glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(first) * vertex_size(), staging_.size(), &staging_[0]);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void MeshRenderer::BuildVertices(Mesh3D* mesh, int first, int last)
+{
+	const std::vector<HE_vert*>& verts = *(mesh->get_vertex_list());
+	const int stride = vertex_size();
+	staging_.resize(static_cast<size_t>(last - first) * stride);
+	if (format_ == VERTEX_FLOAT)
+	{
+		for (int i = first; i < last; i++)
+		{
+			const HE_vert *vert = SourceVertex(verts, i);
+			const Vec3f& texcoord = TexCoord(verts, i);
+			const Vec3f& normal = Normal(verts, i);
+			float out[8];
+			out[0] = vert->position_[0];
+			out[1] = vert->position_[1];
+			out[2] = vert->position_[2];
+			out[3] = normal[0];
+			out[4] = normal[1];
+			out[5] = normal[2];
+			out[6] = texcoord[0];
+			out[7] = texcoord[1];
+
+			unsigned char *dst = &staging_[static_cast<size_t>(i - first) * stride];
+			memcpy(dst, out, sizeof(out));
+			for (int k = 0; k < 4; k++)
+			{
+				dst[sizeof(out) + k] = ToByte(vert->color_[k]);
+			}
+		}
+		return;
+	}
+
+	// small ranges are not worth the threads
+	int count = last - first;
+	int num_threads = static_cast<int>(std::thread::hardware_concurrency());
+	if (num_threads <= 0 || count < (1 << 16))
+	{
+		num_threads = 1;
+	}
+	int chunk = (count + num_threads - 1) / num_threads;
+
+	std::vector<QuantizationError> errors(num_threads);
+	memset(&errors[0], 0, errors.size() * sizeof(QuantizationError));
+	std::vector<std::thread> workers;
+	for (int t = 0; t < num_threads; t++)
+	{
+		workers.push_back(std::thread([&, t]()
+		{
+			int begin = first + t * chunk;
+			int end = begin + chunk < last ? begin + chunk : last;
+			if (begin < end)
+			{
+				EncodeVertices(mesh, begin, end, &staging_[static_cast<size_t>(begin - first) * stride], errors[t]);
+			}
+		}));
+	}
+	for (size_t t = 0; t < workers.size(); t++)
+	{
+		workers[t].join();
+	}
+	for (int t = 0; t < num_threads; t++)
+	{
+		error_.position_ = errors[t].position_ > error_.position_ ? errors[t].position_ : error_.position_;
+		error_.normal_ = errors[t].normal_ > error_.normal_ ? errors[t].normal_ : error_.normal_;
+		error_.texcoord_ = errors[t].texcoord_ > error_.texcoord_ ? errors[t].texcoord_ : error_.texcoord_;
+		error_.color_ = errors[t].color_ > error_.color_ ? errors[t].color_ : error_.color_;
+	}
+}
+
+void MeshRenderer::EncodeVertices(Mesh3D* mesh, int first, int last, unsigned char* out, QuantizationError& error) const
+{
+	const std::vector<HE_vert*>& verts = *(mesh->get_vertex_list());
+	for (int i = first; i < last; i++, out += 20)
+	{
+		const HE_vert *vert = SourceVertex(verts, i);
+		const Vec3f& t = TexCoord(verts, i);
+
+		// position, 3 x 16 bits and padding to keep the normal aligned
+		short position[4];
+		Vec3f decoded;
+		for (int k = 0; k < 3; k++)
+		{
+			position[k] = ToShort(vert->position_[k], position_offset_[k], position_scale_[k]);
+			decoded[k] = position_offset_[k] + position[k] * position_scale_[k];
+		}
+		position[3] = 0;
+		float d = dist(decoded, vert->position_);
+		error.position_ = d > error.position_ ? d : error.position_;
+
+		// normal, 2 x 16 bits
+		short normal[2];
+		float u, v;
+		Vec3f n = Normal(verts, i);
+		EncodeOctahedral(n, u, v);
+		normal[0] = ToShort(u, 0.f, 1.f / kShortSteps);
+		normal[1] = ToShort(v, 0.f, 1.f / kShortSteps);
+		if (len(n) > 0.f)
+		{
+			Vec3f m = DecodeOctahedral(normal[0] / kShortSteps, normal[1] / kShortSteps);
+			float c = n.dot(m) / (len(n) * len(m));
+			c = c > 1.f ? 1.f : (c < -1.f ? -1.f : c);
+			float angle = static_cast<float>(acos(c) * 180.0 / 3.14159265358979);
+			error.normal_ = angle > error.normal_ ? angle : error.normal_;
+		}
+
+		// texture coordinate, 2 x 16 bits
+		short texcoord[2];
+		for (int k = 0; k < 2; k++)
+		{
+			texcoord[k] = ToShort(t[k], texcoord_offset_[k], texcoord_scale_[k]);
+			float e = fabs(texcoord_offset_[k] + texcoord[k] * texcoord_scale_[k] - t[k]);
+			error.texcoord_ = e > error.texcoord_ ? e : error.texcoord_;
+		}
+
+		memcpy(out, position, 8);
+		memcpy(out + 8, normal, 4);
+		memcpy(out + 12, texcoord, 4);
+		for (int k = 0; k < 4; k++)
+		{
+			float c = vert->color_[k];
+			c = c < 0.f ? 0.f : (c > 1.f ? 1.f : c);
+			out[16 + k] = ToByte(c);
+			float e = fabs(out[16 + k] / 255.f - c);
+			error.color_ = e > error.color_ ? e : error.color_;
+		}
+	}
+}
+
+void MeshRenderer::BuildSeams(Mesh3D* mesh, std::vector<int>& corner_index)
+{
+	std::vector<int>().swap(seam_source_);
+	std::vector<HE_edge*>().swap(corners_);
+	corner_index.clear();
+	is_corner_normals_ = false;
+	bool texcoords = mesh->has_file_texcoords(), normals = mesh->has_file_normals();
+	if (!(texcoords || normals) || mesh->num_of_half_edges_list() == 0)
+	{
+		return;
+	}
+	is_corner_normals_ = normals;
+
+	// the corners of a vertex with the same attributes from the file share a group, the first group is the vertex
+	const std::vector<HE_edge*>& edge_list = *(mesh->get_edges_list());
+	std::vector<int> head(num_vertex_, -1), group(edge_list.size(), -1);
+	std::vector<HE_edge*> nodes;
+	std::vector<int> next;
+	for (size_t i = 0; i != edge_list.size(); i++)
+	{
+		HE_edge *edge = edge_list[i];
+		if (edge->pface_ == NULL)
+		{
+			continue;
+		}
+		int v = edge->pvert_->id_;
+		int g = head[v];
+		while (g >= 0 && ((texcoords && (nodes[g]->texCoord_[0] != edge->texCoord_[0] || nodes[g]->texCoord_[1] != edge->texCoord_[1]))
+			|| (normals && !(nodes[g]->normal_ == edge->normal_))))
+		{
+			g = next[g];
+		}
+		if (g < 0)
+		{
+			g = static_cast<int>(nodes.size());
+			nodes.push_back(edge);
+			next.push_back(head[v]);
+			head[v] = g;
+		}
+		group[i] = g;
+	}
+	// the copies are numbered vertex after vertex, so those of a range of vertices are a range too
+	std::vector<int> slot(nodes.size());
+	corners_.assign(num_vertex_, NULL);
+	for (int v = 0; v < num_vertex_; v++)
+	{
+		for (int g = head[v]; g >= 0; g = next[g])
+		{
+			if (next[g] < 0)
+			{
+				slot[g] = v;
+				corners_[v] = nodes[g];
+			}
+			else
+			{
+				slot[g] = num_buffer_vertex();
+				seam_source_.push_back(v);
+				corners_.push_back(nodes[g]);
+			}
+		}
+	}
+	if (seam_source_.empty())
+	{
+		// no vertex has two sets of attributes, the faces index the vertices as they are
+		return;
+	}
+	corner_index.resize(edge_list.size());
+	for (size_t i = 0; i != edge_list.size(); i++)
+	{
+		corner_index[i] = group[i] >= 0 ? slot[group[i]] : edge_list[i]->pvert_->id_;
+	}
+}
+
+void MeshRenderer::BuildIndices(Mesh3D* mesh, const std::vector<int>& corner_index)
+{
+	// polygons are drawn as fans, grouped in meshlets for culling
+	std::vector<GLuint> faces, edges;
+	meshlets_.Build(mesh, faces, 128, corner_index.empty() ? NULL : &corner_index);
+	if (mesh->num_of_face_list() > 0)
+	{
+		// each edge once, shared edges are not drawn twice
+		const std::vector<HE_edge*>& edge_list = mesh->get_unique_edges();
+		edges.resize(edge_list.size() * 2);
+		for (size_t i = 0; i != edge_list.size(); ++i)
+		{
+			edges[2 * i] = edge_list[i]->ppair_->pvert_->id_;
+			edges[2 * i + 1] = edge_list[i]->pvert_->id_;
+		}
+	}
+	num_face_index_ = static_cast<int>(faces.size());
+	num_edge_index_ = static_cast<int>(edges.size());
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, face_buffer_);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, faces.size() * sizeof(GLuint), faces.empty() ? NULL : &faces[0], GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, edge_buffer_);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, edges.size() * sizeof(GLuint), edges.empty() ? NULL : &edges[0], GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void MeshRenderer::BindVertices(bool normals, bool texcoords, bool colors)
+{
+	const GLsizei stride = vertex_size();
+	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	if (format_ == VERTEX_COMPACT)
+	{
+		glVertexPointer(3, GL_SHORT, stride, reinterpret_cast<const GLvoid*>(0));
+		if (normals)
+		{
+			// octahedral normals have no fixed-function array, the shader decodes them
+			glEnableVertexAttribArray(kNormalAttribute);
+			glVertexAttribPointer(kNormalAttribute, 2, GL_SHORT, GL_TRUE, stride, reinterpret_cast<const GLvoid*>(8));
+		}
+		if (texcoords)
+		{
+			glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+			glTexCoordPointer(2, GL_SHORT, stride, reinterpret_cast<const GLvoid*>(12));
+		}
+		if (colors)
+		{
+			glEnableClientState(GL_COLOR_ARRAY);
+			glColorPointer(4, GL_UNSIGNED_BYTE, stride, reinterpret_cast<const GLvoid*>(16));
+		}
+		return;
+	}
+
+	glVertexPointer(3, GL_FLOAT, stride, reinterpret_cast<const GLvoid*>(0));
+	if (normals)
+	{
+		glEnableClientState(GL_NORMAL_ARRAY);
+		glNormalPointer(GL_FLOAT, stride, reinterpret_cast<const GLvoid*>(3 * sizeof(float)));
+	}
+	if (texcoords)
+	{
+		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+		glTexCoordPointer(2, GL_FLOAT, stride, reinterpret_cast<const GLvoid*>(6 * sizeof(float)));
+	}
+	if (colors)
+	{
+		glEnableClientState(GL_COLOR_ARRAY);
+		glColorPointer(4, GL_UNSIGNED_BYTE, stride, reinterpret_cast<const GLvoid*>(8 * sizeof(float)));
+	}
+}
+
+void MeshRenderer::UnbindVertices(void)
+{
+	if (format_ == VERTEX_COMPACT)
+	{
+		glDisableVertexAttribArray(kNormalAttribute);
+	}
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void MeshRenderer::PushDecodeMatrix(void)
+{
+	if (format_ == VERTEX_COMPACT)
+	{
+		glMatrixMode(GL_MODELVIEW);
+		glPushMatrix();
+		glTranslatef(position_offset_[0], position_offset_[1], position_offset_[2]);
+		glScalef(position_scale_[0], position_scale_[1], position_scale_[2]);
+	}
+}
+
+void MeshRenderer::PopDecodeMatrix(void)
+{
+	if (format_ == VERTEX_COMPACT)
+	{
+		glMatrixMode(GL_MODELVIEW);
+		glPopMatrix();
+	}
+}
+
+void MeshRenderer::DrawPoints(void)
+{
+	if (num_vertex_ == 0)
+	{
+		return;
+	}
+	PushDecodeMatrix();
+	BindVertices(format_ == VERTEX_FLOAT, false, false);
+	glDrawArrays(GL_POINTS, 0, num_vertex_);
+	UnbindVertices();
+	PopDecodeMatrix();
+}
+
+void MeshRenderer::DrawEdges(void)
+{
+	if (num_edge_index_ == 0)
+	{
+		return;
+	}
+	PushDecodeMatrix();
+	BindVertices(format_ == VERTEX_FLOAT, false, false);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, edge_buffer_);
+	glDrawElements(GL_LINES, num_edge_index_, GL_UNSIGNED_INT, reinterpret_cast<const GLvoid*>(0));
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	UnbindVertices();
+	PopDecodeMatrix();
+}
+
+void MeshRenderer::CullMeshlets(void)
+{
+	draw_counts_.clear();
+	draw_offsets_.clear();
+	culled_ratio_ = 0.f;
+	if (!(is_frustum_culling_ || is_backface_culling_) || meshlets_.num_meshlets() < 2)
+	{
+		draw_counts_.push_back(num_face_index_);
+		draw_offsets_.push_back(reinterpret_cast<const GLvoid*>(0));
+		return;
+	}
+
+	// the meshlets are bounded in the space of the mesh, so is the frustum
+	GLfloat modelview[16], projection[16], mvp[16];
+	glGetFloatv(GL_MODELVIEW_MATRIX, modelview);
+	glGetFloatv(GL_PROJECTION_MATRIX, projection);
+	for (int c = 0; c < 4; c++)
+	{
+		for (int r = 0; r < 4; r++)
+		{
+			float sum = 0.f;
+			for (int k = 0; k < 4; k++)
+			{
+				sum += projection[k * 4 + r] * modelview[c * 4 + k];
+			}
+			mvp[c * 4 + r] = sum;
+		}
+	}
+
+	// the eye is where the modelview maps to the origin, -A^-1 t for the affine part A, t
+	const GLfloat *m = modelview;
+	float a[9] = {m[0], m[4], m[8], m[1], m[5], m[9], m[2], m[6], m[10]};
+	float inverse[9] = {a[4] * a[8] - a[5] * a[7], a[2] * a[7] - a[1] * a[8], a[1] * a[5] - a[2] * a[4],
+		a[5] * a[6] - a[3] * a[8], a[0] * a[8] - a[2] * a[6], a[2] * a[3] - a[0] * a[5],
+		a[3] * a[7] - a[4] * a[6], a[1] * a[6] - a[0] * a[7], a[0] * a[4] - a[1] * a[3]};
+	float det = a[0] * inverse[0] + a[1] * inverse[3] + a[2] * inverse[6];
+	Vec3f eye;
+	if (det != 0.f)
+	{
+		for (int r = 0; r < 3; r++)
+		{
+			eye[r] = -(inverse[r * 3] * m[12] + inverse[r * 3 + 1] * m[13] + inverse[r * 3 + 2] * m[14]) / det;
+		}
+	}
+
+	meshlets_.Cull(mvp, eye, is_frustum_culling_, is_backface_culling_ && det != 0.f, visible_);
+
+	// neighboring visible meshlets are merged into one range
+	const std::vector<Meshlet>& meshlets = meshlets_.meshlets();
+	int drawn = 0;
+	for (size_t i = 0; i != meshlets.size(); i++)
+	{
+		if (!visible_[i])
+		{
+			continue;
+		}
+		const GLvoid *offset = reinterpret_cast<const GLvoid*>(meshlets[i].first_index_ * sizeof(GLuint));
+		if (i > 0 && visible_[i - 1])
+		{
+			draw_counts_.back() += meshlets[i].num_index_;
+		}
+		else
+		{
+			draw_counts_.push_back(meshlets[i].num_index_);
+			draw_offsets_.push_back(offset);
+		}
+		drawn += meshlets[i].num_index_;
+	}
+	culled_ratio_ = 1.f - static_cast<float>(drawn) / num_face_index_;
+}
+
+void MeshRenderer::DrawFaces(bool textured, bool colored)
+{
+	if (num_face_index_ == 0)
+	{
+		return;
+	}
+	CullMeshlets();
+	if (draw_counts_.empty())
+	{
+		return;
+	}
+	BindVertices(true, textured, colored);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, face_buffer_);
+	if (multi_draw_elements_ != NULL)
+	{
+		multi_draw_elements_(GL_TRIANGLES, &draw_counts_[0], GL_UNSIGNED_INT, &draw_offsets_[0], static_cast<GLsizei>(draw_counts_.size()));
+	}
+	else
+	{
+		for (size_t i = 0; i != draw_counts_.size(); i++)
+		{
+			glDrawElements(GL_TRIANGLES, draw_counts_[i], GL_UNSIGNED_INT, draw_offsets_[i]);
+		}
+	}
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	UnbindVertices();
+}
@@ -0,0 +1,179 @@
+#ifndef MESHRENDERER_H
+#define MESHRENDERER_H
+
+#include <vector>
+#include <QOpenGLFunctions>
+#include "HE_mesh/Meshlet.h"
+
+class Mesh3D;
+
+//! the largest errors of the compact vertex format, measured against the float data
+struct QuantizationError
+{
+	float	position_;		//!< distance
+	float	normal_;		//!< angle, in degrees
+	float	texcoord_;
+	float	color_;
+};
+
+/*!
+*	Retained rendering of a Mesh3D with vertex buffer objects.
+*	The vertices are stored interleaved (position, normal, texture coordinate, color) in one
+*	buffer, and the triangles and the edges in two index buffers. The buffers are rebuilt when
+*	the topology version of the mesh changes; when only the geometry changes, just the range of
+*	vertices reported by Mesh3D::MarkGeometryChanged is uploaded again, and the meshlets holding
+*	them are refitted.
+*	A vertex whose corners have different texture coordinates or normals in the file (a seam
+*	of the texture atlas, a hard edge) is split: the vertices of the mesh come first in the
+*	buffer, then one copy per extra set of attributes, grouped by vertex. The normals of the
+*	file are drawn where it has them, the computed vertex normals elsewhere.
+*
+*	Two vertex formats are available. VERTEX_FLOAT takes 36 bytes per vertex: floats and the
+*	color as four bytes. VERTEX_COMPACT takes 20: the position as 16-bit integers within the
+*	bounding box, the normal octahedral-encoded in two 16-bit integers, the texture coordinate
+*	as 16-bit integers within its range and the color in 8 bits per channel. Compact faces are
+*	decoded by the vertex shader of MeshShader, see the decode parameters. Points and edges
+*	are drawn through the fixed-function pipeline, which cannot decode the normals: in the
+*	compact format they are drawn with the current normal.
+*
+*	The triangles are stored meshlet after meshlet (see MeshletSet). DrawFaces culls the
+*	meshlets against the frustum of the current projection and modelview matrices, and
+*	optionally by their normal cones, and draws the visible ones with one multi-draw call.
+*	All the methods need the GL context of the widget to be current.
+*/
+class MeshRenderer : protected QOpenGLFunctions
+{
+public:
+	enum VertexFormat
+	{
+		VERTEX_FLOAT,
+		VERTEX_COMPACT
+	};
+
+	MeshRenderer(void);
+	~MeshRenderer(void);
+
+	//! resolve the buffer functions, false if the context has no vertex buffer objects
+	bool Initialize(void);
+	//! delete the buffers
+	void Release(void);
+	bool isValid(void) const {return initialized_;}
+
+	//! choose the vertex format, the buffers are rebuilt by the next Update
+	void set_vertex_format(VertexFormat format);
+	VertexFormat vertex_format(void) const {return format_;}
+	//! size of a vertex in the vertex buffer, in bytes
+	int vertex_size(void) const {return format_ == VERTEX_COMPACT ? 20 : 36;}
+	//! the memory held by the buffers, in bytes
+	size_t buffer_size(void) const;
+	//! largest errors of the compact encoding since the buffers were last built
+	const QuantizationError& quantization_error(void) const {return error_;}
+
+	//! drop the meshlets outside the view frustum, on by default
+	void set_frustum_culling(bool b) {is_frustum_culling_ = b;}
+	bool is_frustum_culling(void) const {return is_frustum_culling_;}
+	//! drop the meshlets facing away from the eye, for closed meshes drawn with GL_CULL_FACE
+	void set_backface_culling(bool b) {is_backface_culling_ = b;}
+	bool is_backface_culling(void) const {return is_backface_culling_;}
+	int num_meshlets(void) const {return meshlets_.num_meshlets();}
+	//! the fraction of the triangles culled by the last DrawFaces
+	float culled_ratio(void) const {return culled_ratio_;}
+
+	// decode parameters of the compact format: value = offset + integer * scale
+	const float* position_offset(void) const {return position_offset_;}
+	const float* position_scale(void) const {return position_scale_;}
+	const float* texcoord_offset(void) const {return texcoord_offset_;}
+	const float* texcoord_scale(void) const {return texcoord_scale_;}
+
+	//! bring the buffers up to date with the mesh
+	/*!
+	*	\return false if nothing can be drawn
+	*/
+	bool Update(Mesh3D* mesh);
+
+	void DrawPoints(void);
+	void DrawEdges(void);
+	//! draw the triangles, with texture coordinates if textured and vertex colors if colored
+	/*!
+	*	in the compact format the program of MeshShader has to be bound
+	*/
+	void DrawFaces(bool textured, bool colored = false);
+
+	//! generic attribute of the octahedral normals of the compact format
+	static const GLuint kNormalAttribute = 6;
+
+private:
+	//! fit the quantization ranges to the whole mesh
+	void ComputeRanges(Mesh3D* mesh);
+	//! whether the vertices [first, last) fit in the quantization ranges
+	bool InsideRanges(Mesh3D* mesh, int first, int last) const;
+	//! build the buffer vertices [first, last) into staging_ and upload them
+	void UploadVertices(Mesh3D* mesh, int first, int last);
+	void BuildVertices(Mesh3D* mesh, int first, int last);
+	//! encode the vertices [first, last) into out, accumulating the errors in error
+	void EncodeVertices(Mesh3D* mesh, int first, int last, unsigned char* out, QuantizationError& error) const;
+	//! split the vertices at the texture seams, corner_index receives the buffer vertex of each half-edge
+	void BuildSeams(Mesh3D* mesh, std::vector<int>& corner_index);
+	void BuildIndices(Mesh3D* mesh, const std::vector<int>& corner_index);
+	//! vertices in the buffer, those of the mesh then the copies at the seams
+	int num_buffer_vertex(void) const {return num_vertex_ + static_cast<int>(seam_source_.size());}
+	const HE_vert* SourceVertex(const std::vector<HE_vert*>& verts, int i) const
+	{
+		return verts[i < num_vertex_ ? i : seam_source_[i - num_vertex_]];
+	}
+	const Vec3f& TexCoord(const std::vector<HE_vert*>& verts, int i) const
+	{
+		// a vertex without faces has no corner and keeps its own coordinate
+		return is_corner_texcoords_ && corners_[i] != NULL ? corners_[i]->texCoord_ : SourceVertex(verts, i)->texCoord_;
+	}
+	const Vec3f& Normal(const std::vector<HE_vert*>& verts, int i) const
+	{
+		// a corner the file gave no normal is zero
+		return is_corner_normals_ && corners_[i] != NULL && !(corners_[i]->normal_ == Vec3f(0.f, 0.f, 0.f))
+			? corners_[i]->normal_ : SourceVertex(verts, i)->normal_;
+	}
+	//! cull the meshlets and collect the index ranges of the visible ones into draw_counts_ and draw_offsets_
+	void CullMeshlets(void);
+	void BindVertices(bool normals, bool texcoords, bool colors);
+	void UnbindVertices(void);
+	//! map the integer positions of the compact format to the mesh, for fixed-function drawing
+	void PushDecodeMatrix(void);
+	void PopDecodeMatrix(void);
+
+private:
+	bool				initialized_;
+	GLuint				vertex_buffer_;
+	GLuint				face_buffer_;		//!< triangle indices
+	GLuint				edge_buffer_;		//!< line indices, one pair per undirected edge
+	int					num_vertex_;		//!< of the mesh, the seam copies follow
+	std::vector<int>	seam_source_;		//!< vertex of the mesh behind each copy, increasing
+	std::vector<HE_edge*>	corners_;		//!< a corner of each buffer vertex, empty without attributes from the file
+	bool				is_corner_texcoords_;	//!< the texture coordinates are taken from corners_
+	bool				is_corner_normals_;		//!< so are the normals
+	int					num_face_index_;
+	int					num_edge_index_;
+
+	const Mesh3D		*mesh_;				//!< the mesh the buffers were built from
+	unsigned int		topology_version_;
+	unsigned int		geometry_version_;
+	std::vector<unsigned char>	staging_;
+
+	VertexFormat		format_;
+	float				position_offset_[3], position_scale_[3];
+	float				texcoord_offset_[2], texcoord_scale_[2];
+	QuantizationError	error_;
+
+	// meshlet culling
+	typedef void (QOPENGLF_APIENTRYP MultiDrawElements)(GLenum mode, const GLsizei* count, GLenum type,
+		const GLvoid* const* indices, GLsizei drawcount);
+	MultiDrawElements			multi_draw_elements_;	//!< NULL before OpenGL 1.4
+	MeshletSet					meshlets_;
+	bool						is_frustum_culling_;
+	bool						is_backface_culling_;
+	float						culled_ratio_;
+	std::vector<unsigned char>	visible_;
+	std::vector<GLsizei>		draw_counts_;
+	std::vector<const GLvoid*>	draw_offsets_;
+};
+
+#endif // MESHRENDERER_H
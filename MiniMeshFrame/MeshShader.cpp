@@ -0,0 +1,286 @@
+#include "MeshShader.h"
+#include "MeshRenderer.h"
+#include "globalFunctions.h"
+
+#include <QOpenGLShaderProgram>
+
+namespace
+{
+	// the stages are written once, the header selects GLSL 1.20 or 1.50 with a geometry shader
+	const char *kHeader120 =
+		"#version 120\n"
+		"#define VERTEX_IN attribute\n"
+		"#define VERTEX_OUT varying\n"
+		"#define FRAGMENT_IN varying\n";
+
+	const char *kHeader150 =
+		"#version 150 compatibility\n"
+		"#define VERTEX_IN in\n"
+		"#define VERTEX_OUT out\n"
+		"#define FRAGMENT_IN in\n"
+		"#define WIREFRAME 1\n";
+
+	// compact vertices (see MeshRenderer) hold integers, decoded as offset + integer * scale
+	const char *kVertexShader =
+		"VERTEX_IN vec2 oct_normal;\n"
+		"VERTEX_OUT vec3 v_position;\n"
+		"VERTEX_OUT vec3 v_normal;\n"
+		"VERTEX_OUT vec4 v_color;\n"
+		"VERTEX_OUT vec2 v_texcoord;\n"
+		"uniform bool compact;\n"
+		"uniform vec3 position_offset;\n"
+		"uniform vec3 position_scale;\n"
+		"uniform vec2 texcoord_offset;\n"
+		"uniform vec2 texcoord_scale;\n"
+		"vec3 DecodeOctahedral(vec2 e)\n"
+		"{\n"
+		"	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));\n"
+		"	if (n.z < 0.0)\n"
+		"		n.xy = (1.0 - abs(e.yx)) * vec2(e.x < 0.0 ? -1.0 : 1.0, e.y < 0.0 ? -1.0 : 1.0);\n"
+		"	return n;\n"
+		"}\n"
+		"void main()\n"
+		"{\n"
+		"	vec4 position = gl_Vertex;\n"
+		"	vec3 normal = gl_Normal;\n"
+		"	v_texcoord = gl_MultiTexCoord0.xy;\n"
+		"	if (compact)\n"
+		"	{\n"
+		"		position = vec4(position_offset + gl_Vertex.xyz * position_scale, 1.0);\n"
+		"		normal = DecodeOctahedral(clamp(oct_normal, -1.0, 1.0));\n"
+		"		v_texcoord = texcoord_offset + v_texcoord * texcoord_scale;\n"
+		"	}\n"
+		"	vec4 eye = gl_ModelViewMatrix * position;\n"
+		"	v_position = eye.xyz;\n"
+		"	v_normal = gl_NormalMatrix * normal;\n"
+		"	v_color = gl_Color;\n"
+		"	gl_Position = gl_ProjectionMatrix * eye;\n"
+		"}\n";
+
+	// passes the triangle on, adding the distances of each corner to the opposite edge in pixels
+	const char *kGeometryShader =
+		"layout(triangles) in;\n"
+		"layout(triangle_strip, max_vertices = 3) out;\n"
+		"in vec3 v_position[];\n"
+		"in vec3 v_normal[];\n"
+		"in vec4 v_color[];\n"
+		"in vec2 v_texcoord[];\n"
+		"out vec3 f_position;\n"
+		"out vec3 f_normal;\n"
+		"out vec4 f_color;\n"
+		"out vec2 f_texcoord;\n"
+		"noperspective out vec3 f_edge;\n"
+		"uniform vec2 viewport;\n"
+		"void main()\n"
+		"{\n"
+		"	vec2 p[3];\n"
+		"	for (int i = 0; i < 3; i++)\n"
+		"		p[i] = 0.5 * viewport * gl_in[i].gl_Position.xy / gl_in[i].gl_Position.w;\n"
+		"	float area = abs((p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[1].y - p[0].y) * (p[2].x - p[0].x));\n"
+		"	vec3 height = area / max(vec3(length(p[2] - p[1]), length(p[2] - p[0]), length(p[1] - p[0])), 1e-6);\n"
+		"	for (int i = 0; i < 3; i++)\n"
+		"	{\n"
+		"		f_position = v_position[i];\n"
+		"		f_normal = v_normal[i];\n"
+		"		f_color = v_color[i];\n"
+		"		f_texcoord = v_texcoord[i];\n"
+		"		f_edge = vec3(0.0);\n"
+		"		f_edge[i] = height[i];\n"
+		"		gl_Position = gl_in[i].gl_Position;\n"
+		"		EmitVertex();\n"
+		"	}\n"
+		"	EndPrimitive();\n"
+		"}\n";
+
+	const char *kFragmentShader =
+		"#ifdef WIREFRAME\n"
+		"#define v_position f_position\n"
+		"#define v_normal f_normal\n"
+		"#define v_color f_color\n"
+		"#define v_texcoord f_texcoord\n"
+		"noperspective in vec3 f_edge;\n"
+		"#endif\n"
+		"FRAGMENT_IN vec3 v_position;\n"
+		"FRAGMENT_IN vec3 v_normal;\n"
+		"FRAGMENT_IN vec4 v_color;\n"
+		"FRAGMENT_IN vec2 v_texcoord;\n"
+		"uniform bool draw_faces;\n"
+		"uniform bool draw_wireframe;\n"
+		"uniform bool lighting;\n"
+		"uniform bool textured;\n"
+		"uniform bool flat_shading;\n"
+		"uniform vec4 wire_color;\n"
+		"uniform sampler2D texture0;\n"
+		"void main()\n"
+		"{\n"
+		"	vec4 color = textured ? texture2D(texture0, v_texcoord) : v_color;\n"
+		"	if (lighting)\n"
+		"	{\n"
+		"		vec3 n = flat_shading ? cross(dFdx(v_position), dFdy(v_position)) : v_normal;\n"
+		"		n = normalize(n);\n"
+		"		if (dot(n, v_position) > 0.0)\n"
+		"			n = -n;\n"
+		"		vec3 l = normalize(gl_LightSource[0].position.xyz);\n"
+		"		float diffuse = max(dot(n, l), 0.0);\n"
+		"		float specular = 0.0;\n"
+		"		if (diffuse > 0.0)\n"
+		"			specular = pow(max(dot(reflect(-l, n), normalize(-v_position)), 0.0), gl_FrontMaterial.shininess);\n"
+		"		color.rgb = color.rgb * (gl_LightModel.ambient.rgb + diffuse * gl_LightSource[0].diffuse.rgb)\n"
+		"			+ specular * gl_LightSource[0].specular.rgb * gl_FrontMaterial.specular.rgb;\n"
+		"	}\n"
+		"#ifdef WIREFRAME\n"
+		"	if (draw_wireframe)\n"
+		"	{\n"
+		"		float d = min(f_edge.x, min(f_edge.y, f_edge.z));\n"
+		"		float w = exp2(-2.0 * d * d);\n"
+		"		if (!draw_faces)\n"
+		"		{\n"
+		"			if (w < 0.5)\n"
+		"				discard;\n"
+		"			color = wire_color;\n"
+		"		}\n"
+		"		else\n"
+		"			color.rgb = mix(color.rgb, wire_color.rgb, w);\n"
+		"	}\n"
+		"#endif\n"
+		"	gl_FragColor = color;\n"
+		"}\n";
+
+	QOpenGLShaderProgram* BuildProgram(const char* header, bool geometry)
+	{
+		QOpenGLShaderProgram *program = new QOpenGLShaderProgram();
+		bool ok = program->addShaderFromSourceCode(QOpenGLShader::Vertex, QByteArray(header) + kVertexShader)
+			&& program->addShaderFromSourceCode(QOpenGLShader::Fragment, QByteArray(header) + kFragmentShader);
+		if (ok && geometry)
+		{
+			ok = program->addShaderFromSourceCode(QOpenGLShader::Geometry, QByteArray(header) + kGeometryShader);
+		}
+		// the renderer feeds the octahedral normals to this attribute
+		program->bindAttributeLocation("oct_normal", MeshRenderer::kNormalAttribute);
+		if (!ok || !program->link())
+		{
+			SafeDelete(program);
+			return NULL;
+		}
+		return program;
+	}
+}
+
+MeshShader::MeshShader(void)
+	: program_(NULL), has_geometry_shader_(false), is_flat_shading_(false)
+{
+}
+
+MeshShader::~MeshShader(void)
+{
+	SafeDelete(program_);
+}
+
+bool MeshShader::Initialize(void)
+{
+	Release();
+	if (!QOpenGLShaderProgram::hasOpenGLShaderPrograms())
+	{
+		return false;
+	}
+	if (QOpenGLShader::hasOpenGLShaders(QOpenGLShader::Geometry))
+	{
+		program_ = BuildProgram(kHeader150, true);
+		has_geometry_shader_ = program_ != NULL;
+	}
+	if (program_ == NULL)
+	{
+		program_ = BuildProgram(kHeader120, false);
+	}
+	return program_ != NULL;
+}
+
+void MeshShader::Release(void)
+{
+	SafeDelete(program_);
+	program_ = NULL;
+	has_geometry_shader_ = false;
+}
+
+void MeshShader::Bind(MeshRenderer* renderer, bool faces, bool wireframe, bool lighting, bool textured)
+{
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+
+	program_->bind();
+	program_->setUniformValue("draw_faces", static_cast<GLint>(faces));
+	program_->setUniformValue("draw_wireframe", static_cast<GLint>(wireframe));
+	program_->setUniformValue("lighting", static_cast<GLint>(lighting));
+	program_->setUniformValue("textured", static_cast<GLint>(textured));
+	program_->setUniformValue("flat_shading", static_cast<GLint>(is_flat_shading_));
+	program_->setUniformValue("texture0", 0);
+	bool compact = renderer->vertex_format() == MeshRenderer::VERTEX_COMPACT;
+	program_->setUniformValue("compact", static_cast<GLint>(compact));
+	if (compact)
+	{
+		const float *offset = renderer->position_offset(), *scale = renderer->position_scale();
+		program_->setUniformValue("position_offset", QVector3D(offset[0], offset[1], offset[2]));
+		program_->setUniformValue("position_scale", QVector3D(scale[0], scale[1], scale[2]));
+		offset = renderer->texcoord_offset();
+		scale = renderer->texcoord_scale();
+		program_->setUniformValue("texcoord_offset", QVector2D(offset[0], offset[1]));
+		program_->setUniformValue("texcoord_scale", QVector2D(scale[0], scale[1]));
+	}
+	// dark lines over the faces, white ones alone as the fixed-function wireframe
+	program_->setUniformValue("wire_color", faces ? QVector4D(0.1f, 0.1f, 0.1f, 1.f) : QVector4D(1.f, 1.f, 1.f, 1.f));
+	if (has_geometry_shader_)
+	{
+		program_->setUniformValue("viewport", QVector2D(viewport[2], viewport[3]));
+	}
+}
+
+void MeshShader::Draw(MeshRenderer* renderer, bool faces, bool wireframe, bool lighting, bool textured)
+{
+	if (program_ == NULL || renderer == NULL || !(faces || wireframe))
+	{
+		return;
+	}
+
+	// the shader antialiases the edges itself, polygon smoothing would only slow it down
+	GLboolean polygon_smooth = glIsEnabled(GL_POLYGON_SMOOTH);
+	glDisable(GL_POLYGON_SMOOTH);
+
+	if (has_geometry_shader_)
+	{
+		Bind(renderer, faces, wireframe, lighting, textured);
+		renderer->DrawFaces(textured, true);
+		program_->release();
+	}
+	else
+	{
+		if (faces)
+		{
+			// push the faces back so the lines drawn over them are not hidden
+			glEnable(GL_POLYGON_OFFSET_FILL);
+			glPolygonOffset(1.f, 1.f);
+			Bind(renderer, true, false, lighting, textured);
+			renderer->DrawFaces(textured, true);
+			program_->release();
+			glDisable(GL_POLYGON_OFFSET_FILL);
+		}
+		if (wireframe)
+		{
+			if (faces)
+			{
+				glColor3f(0.1f, 0.1f, 0.1f);
+			}
+			else
+			{
+				glColor3f(1.f, 1.f, 1.f);
+			}
+			renderer->DrawEdges();
+		}
+	}
+	// the color array leaves the current color undefined
+	glColor3f(1.f, 1.f, 1.f);
+
+	if (polygon_smooth)
+	{
+		glEnable(GL_POLYGON_SMOOTH);
+	}
+}
@@ -0,0 +1,49 @@
+#ifndef MESHSHADER_H
+#define MESHSHADER_H
+
+class QOpenGLShaderProgram;
+class MeshRenderer;
+
+/*!
+*	GLSL pipeline drawing the buffers of a MeshRenderer.
+*	Faces are colored by HE_vert::color_ or by the texture, and lit like the fixed-function
+*	light 0; flat shading takes the normal of the triangle from the derivatives of the
+*	position, so flat and smooth shading use the same buffers. When the context has geometry
+*	shaders the wireframe is drawn in the same pass as the faces: every fragment knows its
+*	distance in pixels to the edges of its triangle. Otherwise the edges are drawn with lines
+*	after the faces. Vertices in the compact format of MeshRenderer are decoded by the vertex
+*	shader.
+*	All the methods need the GL context of the widget to be current.
+*/
+class MeshShader
+{
+public:
+	MeshShader(void);
+	~MeshShader(void);
+
+	//! compile the programs, false if the context has no GLSL support
+	bool Initialize(void);
+	void Release(void);
+	bool isValid(void) const {return program_ != 0;}
+	//! whether the wireframe is drawn in the pass of the faces
+	bool hasSinglePassWireframe(void) const {return has_geometry_shader_;}
+
+	void set_flat_shading(bool b) {is_flat_shading_ = b;}
+	bool is_flat_shading(void) const {return is_flat_shading_;}
+
+	//! draw the faces and the wireframe held by renderer
+	/*!
+	*	\param textured color the faces with the texture bound to unit 0 instead of the vertex colors
+	*/
+	void Draw(MeshRenderer* renderer, bool faces, bool wireframe, bool lighting, bool textured);
+
+private:
+	void Bind(MeshRenderer* renderer, bool faces, bool wireframe, bool lighting, bool textured);
+
+private:
+	QOpenGLShaderProgram	*program_;
+	bool					has_geometry_shader_;
+	bool					is_flat_shading_;
+};
+
+#endif // MESHSHADER_H
@@ -0,0 +1,235 @@
+#include "OffscreenRenderer.h"
+#include "MeshRenderer.h"
+#include "MeshShader.h"
+#include "RenderState.h"
+#include "globalFunctions.h"
+#include "HE_mesh/Mesh3D.h"
+
+#include <QOpenGLContext>
+#include <QOffscreenSurface>
+#include <QOpenGLFramebufferObject>
+#include <QSurfaceFormat>
+#include <QElapsedTimer>
+#include <QImage>
+#include <algorithm>
+#include <vector>
+#include <cmath>
+
+OffscreenRenderer::OffscreenRenderer(void)
+	: context_(NULL), surface_(NULL), framebuffer_(NULL), renderer_(NULL), shader_(NULL)
+	, width_(0), height_(0), eye_distance_(5.f), yaw_(0.f), pitch_(0.f)
+	, is_draw_point_(false), is_draw_edge_(false), is_draw_face_(true), has_lighting_(true)
+{
+}
+
+OffscreenRenderer::~OffscreenRenderer(void)
+{
+	Release();
+}
+
+bool OffscreenRenderer::Initialize(int width, int height)
+{
+	Release();
+
+	// the draw paths need the fixed-function pipeline next to the shaders
+	QSurfaceFormat format;
+	format.setDepthBufferSize(24);
+	format.setProfile(QSurfaceFormat::CompatibilityProfile);
+	context_ = new QOpenGLContext();
+	context_->setFormat(format);
+	if (!context_->create())
+	{
+		Release();
+		return false;
+	}
+	surface_ = new QOffscreenSurface();
+	surface_->setFormat(context_->format());
+	surface_->create();
+	if (!context_->makeCurrent(surface_))
+	{
+		Release();
+		return false;
+	}
+
+	framebuffer_ = new QOpenGLFramebufferObject(width, height, QOpenGLFramebufferObject::CombinedDepthStencil);
+	if (!framebuffer_->isValid())
+	{
+		Release();
+		return false;
+	}
+	framebuffer_->bind();
+	width_ = width;
+	height_ = height;
+	renderer_name_ = QString(reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+
+	InitializeRenderState();
+
+	renderer_ = new MeshRenderer();
+	if (!renderer_->Initialize())
+	{
+		Release();
+		return false;
+	}
+	shader_ = new MeshShader();
+	if (shader_->Initialize())
+	{
+		renderer_->set_vertex_format(MeshRenderer::VERTEX_COMPACT);
+	}
+	else
+	{
+		SafeDelete(shader_);
+		shader_ = NULL;
+	}
+	return true;
+}
+
+void OffscreenRenderer::Release(void)
+{
+	if (context_ != NULL && surface_ != NULL && context_->makeCurrent(surface_))
+	{
+		if (renderer_ != NULL)
+		{
+			renderer_->Release();
+		}
+		if (shader_ != NULL)
+		{
+			shader_->Release();
+		}
+		SafeDelete(framebuffer_);
+		framebuffer_ = NULL;
+		context_->doneCurrent();
+	}
+	SafeDelete(renderer_);
+	SafeDelete(shader_);
+	SafeDelete(framebuffer_);
+	SafeDelete(context_);
+	SafeDelete(surface_);
+	renderer_ = NULL;
+	shader_ = NULL;
+	framebuffer_ = NULL;
+	context_ = NULL;
+	surface_ = NULL;
+	width_ = height_ = 0;
+}
+
+void OffscreenRenderer::set_camera(float distance, float yaw, float pitch)
+{
+	eye_distance_ = distance;
+	yaw_ = yaw;
+	pitch_ = pitch;
+}
+
+void OffscreenRenderer::DrawFrame(Mesh3D* mesh)
+{
+	// gluPerspective(45, aspect, 0.001, 1000) as in RenderingWidget::resizeGL
+	const double z_near = 0.001, z_far = 1000.0;
+	double top = z_near * tan(45.0 * 3.14159265358979 / 360.0);
+	double right = top * width_ / height_;
+	glViewport(0, 0, width_, height_);
+	glMatrixMode(GL_PROJECTION);
+	glLoadIdentity();
+	glFrustum(-right, right, -top, top, z_near, z_far);
+
+	// gluLookAt from (0, 0, distance) to the origin; the light is placed in it, as the widget
+	// does, before the rotation of the mesh
+	glMatrixMode(GL_MODELVIEW);
+	glLoadIdentity();
+	glTranslatef(0.f, 0.f, -eye_distance_);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	if (has_lighting_)
+	{
+		SetDefaultLight();
+	}
+	else
+	{
+		glDisable(GL_LIGHTING);
+		glDisable(GL_LIGHT0);
+	}
+	glRotatef(pitch_, 1.f, 0.f, 0.f);
+	glRotatef(yaw_, 0.f, 1.f, 0.f);
+
+	if (mesh == NULL || !renderer_->Update(mesh))
+	{
+		return;
+	}
+	if (is_draw_point_)
+	{
+		renderer_->DrawPoints();
+	}
+	if (shader_ != NULL)
+	{
+		shader_->Draw(renderer_, is_draw_face_, is_draw_edge_, has_lighting_, false);
+		return;
+	}
+	if (is_draw_edge_)
+	{
+		renderer_->DrawEdges();
+	}
+	if (is_draw_face_)
+	{
+		renderer_->DrawFaces(false);
+	}
+}
+
+bool OffscreenRenderer::Render(Mesh3D* mesh)
+{
+	if (renderer_ == NULL || !context_->makeCurrent(surface_))
+	{
+		return false;
+	}
+	framebuffer_->bind();
+	DrawFrame(mesh);
+	glFinish();
+	return true;
+}
+
+bool OffscreenRenderer::SaveImage(const QString& filename)
+{
+	if (framebuffer_ == NULL || !context_->makeCurrent(surface_))
+	{
+		return false;
+	}
+	return framebuffer_->toImage().save(filename);
+}
+
+bool OffscreenRenderer::Benchmark(Mesh3D* mesh, int frames, FrameStatistics& statistics)
+{
+	if (frames <= 0)
+	{
+		return false;
+	}
+
+	std::vector<double> times;
+	QElapsedTimer timer;
+	for (int i = 0; i < frames; i++)
+	{
+		timer.start();
+		if (!Render(mesh))
+		{
+			return false;
+		}
+		times.push_back(timer.nsecsElapsed() * 1e-6);
+	}
+	ComputeFrameStatistics(times, statistics);
+	return true;
+}
+
+void ComputeFrameStatistics(std::vector<double>& times, FrameStatistics& statistics)
+{
+	statistics.frames_ = static_cast<int>(times.size());
+	statistics.first_ms_ = times[0];
+	if (times.size() > 1)
+	{
+		times.erase(times.begin());
+	}
+	double sum = 0.0;
+	for (size_t i = 0; i < times.size(); i++)
+	{
+		sum += times[i];
+	}
+	statistics.mean_ms_ = sum / times.size();
+	std::sort(times.begin(), times.end());
+	statistics.min_ms_ = times.front();
+	statistics.max_ms_ = times.back();
+	statistics.median_ms_ = times[times.size() / 2];
+}
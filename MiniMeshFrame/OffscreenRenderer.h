@@ -0,0 +1,86 @@
+#ifndef OFFSCREENRENDERER_H
+#define OFFSCREENRENDERER_H
+
+#include <QString>
+#include <vector>
+
+class QOpenGLContext;
+class QOffscreenSurface;
+class QOpenGLFramebufferObject;
+class Mesh3D;
+class MeshRenderer;
+class MeshShader;
+
+//! timings of OffscreenRenderer::Benchmark, in milliseconds
+struct FrameStatistics
+{
+	int		frames_;
+	double	first_ms_;			//!< the first frame, which uploads the buffers
+	double	min_ms_;			//!< the other frames
+	double	median_ms_;
+	double	mean_ms_;
+	double	max_ms_;
+};
+
+//! fill statistics from the frame times in milliseconds, which are left sorted without the first
+void ComputeFrameStatistics(std::vector<double>& times, FrameStatistics& statistics);
+
+/*!
+*	Rendering into a framebuffer object without a window, for image output and frame
+*	benchmarks on machines without a display or a GPU.
+*	The mesh is drawn by the MeshRenderer and MeshShader of the rendering widget with the
+*	state of RenderState, and the camera of the widget: a 45 degree perspective, the eye on
+*	the z axis looking at the origin, and a rotation of the mesh in place of the ArcBall.
+*	With a software context (Qt::AA_UseSoftwareOpenGL on Windows, Mesa llvmpipe elsewhere)
+*	images can be compared across machines.
+*/
+class OffscreenRenderer
+{
+public:
+	OffscreenRenderer(void);
+	~OffscreenRenderer(void);
+
+	//! create the context and a width x height framebuffer
+	/*!
+	*	\return false if no OpenGL context could be created
+	*/
+	bool Initialize(int width, int height);
+	void Release(void);
+	//! GL_RENDERER of the context, tells a software rasterizer from a GPU
+	const QString& renderer_name(void) const {return renderer_name_;}
+
+	//! place the eye at distance from the origin, the mesh turned by yaw then pitch degrees
+	void set_camera(float distance, float yaw, float pitch);
+	void set_draw_points(bool b) {is_draw_point_ = b;}
+	void set_draw_edges(bool b) {is_draw_edge_ = b;}
+	void set_draw_faces(bool b) {is_draw_face_ = b;}
+	void set_lighting(bool b) {has_lighting_ = b;}
+
+	//! draw one frame and wait for it
+	bool Render(Mesh3D* mesh);
+	//! write the last frame, the format follows the extension of filename
+	bool SaveImage(const QString& filename);
+	//! draw frames and time each one up to its completion
+	bool Benchmark(Mesh3D* mesh, int frames, FrameStatistics& statistics);
+
+private:
+	void DrawFrame(Mesh3D* mesh);
+
+private:
+	QOpenGLContext				*context_;
+	QOffscreenSurface			*surface_;
+	QOpenGLFramebufferObject	*framebuffer_;
+	MeshRenderer				*renderer_;
+	MeshShader					*shader_;		//!< NULL without GLSL
+	QString						renderer_name_;
+	int							width_, height_;
+
+	float						eye_distance_;
+	float						yaw_, pitch_;
+	bool						is_draw_point_;
+	bool						is_draw_edge_;
+	bool						is_draw_face_;
+	bool						has_lighting_;
+};
+
+#endif // OFFSCREENRENDERER_H
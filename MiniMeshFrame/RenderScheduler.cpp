@@ -0,0 +1,107 @@
+#include "RenderScheduler.h"
+#include "globalFunctions.h"
+
+#include <QOpenGLTimerQuery>
+
+RenderScheduler::RenderScheduler(void)
+	: dirty_(RENDER_CLEAN), max_fps_(60), frame_start_ns_(0), last_frame_start_ns_(-1)
+	, gpu_current_(0), cpu_frame_ms_(0.0), gpu_frame_ms_(-1.0), last_cpu_ms_(0.0), last_gpu_ms_(0.0)
+	, num_frames_(0)
+{
+	gpu_timer_[0] = gpu_timer_[1] = NULL;
+	gpu_pending_[0] = gpu_pending_[1] = false;
+	clock_.start();
+}
+
+RenderScheduler::~RenderScheduler(void)
+{
+	// normally freed by Release, while the context is still current
+	SafeDelete(gpu_timer_[0]);
+	SafeDelete(gpu_timer_[1]);
+}
+
+void RenderScheduler::Initialize(void)
+{
+	for (int i = 0; i < 2; i++)
+	{
+		gpu_timer_[i] = new QOpenGLTimerQuery();
+		if (!gpu_timer_[i]->create())
+		{
+			SafeDelete(gpu_timer_[0]);
+			SafeDelete(gpu_timer_[1]);
+			gpu_timer_[0] = gpu_timer_[1] = NULL;
+			return;
+		}
+		gpu_pending_[i] = false;
+	}
+}
+
+void RenderScheduler::Release(void)
+{
+	for (int i = 0; i < 2; i++)
+	{
+		if (gpu_timer_[i] != NULL)
+		{
+			gpu_timer_[i]->destroy();
+			SafeDelete(gpu_timer_[i]);
+			gpu_timer_[i] = NULL;
+		}
+	}
+	gpu_frame_ms_ = -1.0;
+}
+
+int RenderScheduler::TimeToNextFrame(void) const
+{
+	if (max_fps_ == 0 || last_frame_start_ns_ < 0)
+	{
+		return 0;
+	}
+	qint64 interval_ns = 1000000000LL / max_fps_;
+	qint64 wait_ns = last_frame_start_ns_ + interval_ns - clock_.nsecsElapsed();
+	return wait_ns > 0 ? static_cast<int>((wait_ns + 999999) / 1000000) : 0;
+}
+
+void RenderScheduler::BeginFrame(void)
+{
+	dirty_ = RENDER_CLEAN;
+	last_frame_start_ns_ = frame_start_ns_ = clock_.nsecsElapsed();
+
+	if (gpu_timer_[0] != NULL)
+	{
+		// collect the frames the GPU is done with, without waiting for the others
+		for (int i = 0; i < 2; i++)
+		{
+			if (gpu_pending_[i] && gpu_timer_[i]->isResultAvailable())
+			{
+				last_gpu_ms_ = gpu_timer_[i]->waitForResult() * 1e-6;
+				Accumulate(gpu_frame_ms_, last_gpu_ms_);
+				gpu_pending_[i] = false;
+			}
+		}
+		// both queries busy: this frame is not timed
+		if (!gpu_pending_[gpu_current_])
+		{
+			gpu_timer_[gpu_current_]->begin();
+		}
+	}
+}
+
+void RenderScheduler::EndFrame(void)
+{
+	if (gpu_timer_[0] != NULL && !gpu_pending_[gpu_current_])
+	{
+		gpu_timer_[gpu_current_]->end();
+		gpu_pending_[gpu_current_] = true;
+		gpu_current_ = 1 - gpu_current_;
+	}
+
+	last_cpu_ms_ = (clock_.nsecsElapsed() - frame_start_ns_) * 1e-6;
+	Accumulate(cpu_frame_ms_, last_cpu_ms_);
+	num_frames_++;
+}
+
+void RenderScheduler::Accumulate(double& average, double sample)
+{
+	// exponential moving average, the first sample is taken as is
+	average = average < 0.0 || num_frames_ == 0 ? sample : 0.9 * average + 0.1 * sample;
+}
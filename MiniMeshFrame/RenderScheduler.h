@@ -0,0 +1,87 @@
+#ifndef RENDERSCHEDULER_H
+#define RENDERSCHEDULER_H
+
+#include <QElapsedTimer>
+
+class QOpenGLTimerQuery;
+
+//! reasons for a redraw, combined in RenderScheduler::Invalidate
+enum RenderDirty
+{
+	RENDER_CLEAN	= 0,
+	RENDER_CAMERA	= 1,		//!< the view moved
+	RENDER_MESH		= 2,		//!< the mesh or its attributes changed
+	RENDER_SETTINGS	= 4			//!< a render option or the background changed
+};
+
+/*!
+*	Decides when the rendering widget repaints.
+*	Invalidations from the camera, the mesh and the settings are accumulated and served by one
+*	frame, no earlier than the frame interval allowed by the fps cap; nothing is drawn while
+*	the view is clean. The scheduler also measures the frames: the CPU time spent in paintGL
+*	and, when the context supports timer queries, the GPU time of the draw calls. The GPU time
+*	is read one frame late so that the measure never stalls the pipeline.
+*/
+class RenderScheduler
+{
+public:
+	RenderScheduler(void);
+	~RenderScheduler(void);
+
+	//! create the GPU timers, the GL context must be current
+	void Initialize(void);
+	//! delete the GPU timers, the GL context must be current
+	void Release(void);
+
+	//! request a frame for the given RenderDirty reasons
+	void Invalidate(int reasons) {dirty_ |= reasons;}
+	bool isDirty(void) const {return dirty_ != RENDER_CLEAN;}
+	int dirty(void) const {return dirty_;}
+
+	//! limit the frame rate, 0 for no limit
+	void set_max_fps(int fps) {max_fps_ = fps > 0 ? fps : 0;}
+	int max_fps(void) const {return max_fps_;}
+
+	//! milliseconds to wait before the next frame respects the fps cap
+	int TimeToNextFrame(void) const;
+
+	//! call at the start of paintGL, clears the invalidations
+	void BeginFrame(void);
+	//! call at the end of paintGL
+	void EndFrame(void);
+
+	//! smoothed CPU time of a frame, in milliseconds
+	double cpu_frame_ms(void) const {return cpu_frame_ms_;}
+	//! smoothed GPU time of a frame in milliseconds, negative if it cannot be measured
+	double gpu_frame_ms(void) const {return gpu_frame_ms_;}
+	//! the cost of the last measured frame in milliseconds, the larger of its CPU and GPU times
+	double last_frame_ms(void) const {return last_cpu_ms_ > last_gpu_ms_ ? last_cpu_ms_ : last_gpu_ms_;}
+	//! the frame time the fps cap allows, in milliseconds
+	double target_frame_ms(void) const {return max_fps_ > 0 ? 1000.0 / max_fps_ : 1000.0 / 60;}
+	//! the number of frames drawn
+	unsigned int num_frames(void) const {return num_frames_;}
+
+private:
+	void Accumulate(double& average, double sample);
+
+private:
+	int					dirty_;
+	int					max_fps_;
+
+	QElapsedTimer		clock_;
+	qint64				frame_start_ns_;
+	qint64				last_frame_start_ns_;	//!< -1 before the first frame
+
+	//! two queries used alternately, one records while the other is read
+	QOpenGLTimerQuery	*gpu_timer_[2];
+	int					gpu_current_;
+	bool				gpu_pending_[2];
+
+	double				cpu_frame_ms_;
+	double				gpu_frame_ms_;
+	double				last_cpu_ms_;
+	double				last_gpu_ms_;
+	unsigned int		num_frames_;
+};
+
+#endif // RENDERSCHEDULER_H
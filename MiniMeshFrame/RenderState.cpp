@@ -0,0 +1,38 @@
+#include "RenderState.h"
+
+#include <qopengl.h>
+
+void InitializeRenderState(void)
+{
+	glClearColor(0.3, 0.3, 0.3, 0.0);
+	glShadeModel(GL_SMOOTH);
+
+	glEnable(GL_DOUBLEBUFFER);
+	glEnable(GL_POINT_SMOOTH);
+	glEnable(GL_LINE_SMOOTH);
+	glEnable(GL_POLYGON_SMOOTH);
+	glHint(GL_POINT_SMOOTH_HINT, GL_NICEST);
+	glHint(GL_LINE_SMOOTH_HINT, GL_NICEST);
+	glHint(GL_POLYGON_SMOOTH_HINT, GL_NICEST);
+	glEnable(GL_DEPTH_TEST);
+	glClearDepth(1);
+}
+
+void SetDefaultLight(void)
+{
+	static GLfloat mat_specular[] = { 1.0, 1.0, 1.0, 1.0 };
+	static GLfloat mat_shininess[] = { 50.0 };
+	static GLfloat light_position[] = { 1.0, 1.0, 1.0, 0.0 };
+	static GLfloat white_light[] = { 0.8, 0.8, 0.8, 1.0 };
+	static GLfloat lmodel_ambient[] = { 0.3, 0.3, 0.3, 1.0 };
+
+	glMaterialfv(GL_FRONT, GL_SPECULAR, mat_specular);
+	glMaterialfv(GL_FRONT, GL_SHININESS, mat_shininess);
+	glLightfv(GL_LIGHT0, GL_POSITION, light_position);
+	glLightfv(GL_LIGHT0, GL_DIFFUSE, white_light);
+	glLightfv(GL_LIGHT0, GL_SPECULAR, white_light);
+	glLightModelfv(GL_LIGHT_MODEL_AMBIENT, lmodel_ambient);
+
+	glEnable(GL_LIGHTING);
+	glEnable(GL_LIGHT0);
+}
@@ -0,0 +1,14 @@
+#ifndef RENDERSTATE_H
+#define RENDERSTATE_H
+
+/*!
+*	Fixed-function state shared by the rendering widget and the offscreen renderer, so that
+*	both draw the same images. The GL context must be current.
+*/
+
+//! background, smoothing and depth test set once after the context is created
+void InitializeRenderState(void);
+//! material of the faces and light 0, a white directional light
+void SetDefaultLight(void);
+
+#endif // RENDERSTATE_H
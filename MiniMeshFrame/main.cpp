@@ -1,8 +1,187 @@
 #include "mainwindow.h"
+#include "OffscreenRenderer.h"
+#include "HE_mesh/Mesh3D.h"
+#include "HE_mesh/SoftRasterizer.h"
 #include <QtWidgets/QApplication>
+#include <QtGui/QGuiApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QMatrix4x4>
+#include <QImage>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	//! name alone or name=value, as QCommandLineParser takes it
+	bool HasArgument(int argc, char *argv[], const char* name)
+	{
+		size_t length = strlen(name);
+		for (int i = 1; i < argc; i++)
+		{
+			if (strncmp(argv[i], name, length) == 0 && (argv[i][length] == '\0' || argv[i][length] == '='))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void PrintFrameStatistics(const FrameStatistics& statistics)
+	{
+		printf("frames: %d, first %.3f ms, min %.3f ms, median %.3f ms, mean %.3f ms, max %.3f ms\n",
+			statistics.frames_, statistics.first_ms_, statistics.min_ms_, statistics.median_ms_,
+			statistics.mean_ms_, statistics.max_ms_);
+	}
+
+	//! the --render options drawn with SoftRasterizer
+	int RenderCpu(const QCommandLineParser& parser, Mesh3D& mesh, int width, int height, int frames)
+	{
+		// the rotations of OffscreenRenderer::DrawFrame
+		QMatrix4x4 ball;
+		ball.rotate(parser.value("pitch").toFloat(), 1.f, 0.f, 0.f);
+		ball.rotate(parser.value("yaw").toFloat(), 0.f, 1.f, 0.f);
+
+		SoftRasterizer rasterizer;
+		rasterizer.Resize(width, height);
+		rasterizer.SetCamera(Vec3f(0.f, 0.f, parser.value("distance").toFloat()), Vec3f(0.f, 0.f, 0.f), ball.constData());
+		rasterizer.set_lighting(!parser.isSet("no-lighting"));
+		if (parser.isSet("points") || parser.isSet("edges") || parser.isSet("no-faces"))
+		{
+			fprintf(stderr, "--cpu draws the faces only\n");
+		}
+
+		printf("renderer: SoftRasterizer\n");
+		printf("mesh: %d vertices, %d faces\n", mesh.num_of_vertex_list(), mesh.num_of_face_list());
+		std::vector<double> times;
+		QElapsedTimer timer;
+		for (int i = 0; i < frames; i++)
+		{
+			timer.start();
+			rasterizer.Render(&mesh);
+			times.push_back(timer.nsecsElapsed() * 1e-6);
+		}
+		FrameStatistics statistics;
+		ComputeFrameStatistics(times, statistics);
+		PrintFrameStatistics(statistics);
+		printf("triangles: %d, %.1f M/s at the median\n", rasterizer.num_triangles(),
+			rasterizer.num_triangles() / statistics.median_ms_ * 1e-3);
+
+		QString output = parser.value("output");
+		QImage image(reinterpret_cast<const uchar*>(rasterizer.pixels().data()), width, height,
+			rasterizer.stride() * 4, QImage::Format_RGBA8888);
+		if (!output.isEmpty() && !image.save(output))
+		{
+			fprintf(stderr, "cannot write %s\n", output.toLocal8Bit().data());
+			return 1;
+		}
+		return 0;
+	}
+
+	//! draw a mesh without a window, write the image and the frame times
+	int RenderOffscreen(const QStringList& arguments)
+	{
+		QCommandLineParser parser;
+		parser.setApplicationDescription("Render a mesh offscreen. Without a display, add -platform offscreen.");
+		parser.addHelpOption();
+		QCommandLineOption render_option("render", "The OBJ mesh to draw.", "mesh");
+		QCommandLineOption output_option("output", "Write the last frame to an image (PNG, BMP, ...).", "image");
+		QCommandLineOption size_option("size", "Image size, 800x600 by default.", "WxH", "800x600");
+		QCommandLineOption frames_option("frames", "Draw and time this many frames.", "n", "1");
+		QCommandLineOption distance_option("distance", "Distance of the eye to the origin.", "d", "5");
+		QCommandLineOption yaw_option("yaw", "Rotation of the mesh around y, in degrees.", "degrees", "0");
+		QCommandLineOption pitch_option("pitch", "Rotation of the mesh around x, in degrees.", "degrees", "0");
+		QCommandLineOption points_option("points", "Draw the vertices.");
+		QCommandLineOption edges_option("edges", "Draw the wireframe.");
+		QCommandLineOption no_faces_option("no-faces", "Do not draw the faces.");
+		QCommandLineOption no_lighting_option("no-lighting", "Draw without lighting.");
+		QCommandLineOption software_option("software", "Use a software OpenGL rasterizer.");
+		QCommandLineOption cpu_option("cpu", "Draw with the multithreaded rasterizer of HE_mesh, without OpenGL.");
+		parser.addOption(render_option);
+		parser.addOption(output_option);
+		parser.addOption(size_option);
+		parser.addOption(frames_option);
+		parser.addOption(distance_option);
+		parser.addOption(yaw_option);
+		parser.addOption(pitch_option);
+		parser.addOption(points_option);
+		parser.addOption(edges_option);
+		parser.addOption(no_faces_option);
+		parser.addOption(no_lighting_option);
+		parser.addOption(software_option);
+		parser.addOption(cpu_option);
+		parser.process(arguments);
+
+		QStringList size = parser.value(size_option).split('x');
+		int width = size.size() == 2 ? size[0].toInt() : 0;
+		int height = size.size() == 2 ? size[1].toInt() : 0;
+		int frames = parser.value(frames_option).toInt();
+		if (width <= 0 || height <= 0 || frames <= 0)
+		{
+			fprintf(stderr, "invalid --size or --frames\n");
+			return 1;
+		}
+
+		Mesh3D mesh;
+		QByteArray filename = parser.value(render_option).toLocal8Bit();
+		if (!mesh.LoadFromOBJFile(filename.data()))
+		{
+			fprintf(stderr, "cannot read %s\n", filename.data());
+			return 1;
+		}
+
+		if (parser.isSet(cpu_option))
+		{
+			return RenderCpu(parser, mesh, width, height, frames);
+		}
+
+		OffscreenRenderer renderer;
+		if (!renderer.Initialize(width, height))
+		{
+			fprintf(stderr, "cannot create an OpenGL context\n");
+			return 1;
+		}
+		renderer.set_camera(parser.value(distance_option).toFloat(),
+			parser.value(yaw_option).toFloat(), parser.value(pitch_option).toFloat());
+		renderer.set_draw_points(parser.isSet(points_option));
+		renderer.set_draw_edges(parser.isSet(edges_option));
+		renderer.set_draw_faces(!parser.isSet(no_faces_option));
+		renderer.set_lighting(!parser.isSet(no_lighting_option));
+
+		printf("renderer: %s\n", renderer.renderer_name().toLocal8Bit().data());
+		printf("mesh: %d vertices, %d faces\n", mesh.num_of_vertex_list(), mesh.num_of_face_list());
+		FrameStatistics statistics;
+		if (!renderer.Benchmark(&mesh, frames, statistics))
+		{
+			fprintf(stderr, "rendering failed\n");
+			return 1;
+		}
+		PrintFrameStatistics(statistics);
+
+		if (parser.isSet(output_option) && !renderer.SaveImage(parser.value(output_option)))
+		{
+			fprintf(stderr, "cannot write %s\n", parser.value(output_option).toLocal8Bit().data());
+			return 1;
+		}
+		return 0;
+	}
+}
 
 int main(int argc, char *argv[])
 {
+	// --render draws offscreen and exits, for headless benchmarks and image comparisons
+	if (HasArgument(argc, argv, "--render"))
+	{
+		if (HasArgument(argc, argv, "--software"))
+		{
+			// llvmpipe: opengl32sw.dll on Windows, Mesa elsewhere
+			QCoreApplication::setAttribute(Qt::AA_UseSoftwareOpenGL);
+			qputenv("LIBGL_ALWAYS_SOFTWARE", "1");
+		}
+		QGuiApplication a(argc, argv);
+		return RenderOffscreen(a.arguments());
+	}
+
 	QApplication a(argc, argv);
 	MainWindow w;
 	w.show();
@@ -3,6 +3,8 @@
 #include <QtWidgets/QLabel>
 #include <QtWidgets/QPushButton>
 #include <QtWidgets/QCheckBox>
+#include <QtWidgets/QSpinBox>
+#include <QtWidgets/QComboBox>
 #include <QtWidgets/QLayout>
 #include <QtWidgets/QGroupBox>
 #include <QtWidgets/QRadioButton>
@@ -69,10 +71,13 @@ void MainWindow::CreateActions()
 	action_loadmesh_ = new QAction(tr("readOBJ"), this);
 	action_loadtexture_ = new QAction(tr("LoadTexture"), this);
 	action_background_ = new QAction(tr("ChangeBackground"), this);
+	action_optimize_ = new QAction(tr("OptimizeOrder"), this);
+	action_optimize_->setStatusTip(tr("Reorder the faces and vertices for the GPU vertex cache"));
 
 	connect(action_loadmesh_, SIGNAL(triggered()), renderingwidget_, SLOT(ReadMesh()));
 	connect(action_loadtexture_, SIGNAL(triggered()), renderingwidget_, SLOT(LoadTexture()));
 	connect(action_background_, SIGNAL(triggered()), renderingwidget_, SLOT(SetBackground()));
+	connect(action_optimize_, SIGNAL(triggered()), renderingwidget_, SLOT(OptimizeMesh()));
 
 	action_create_model_ = new QAction(tr("Create a Model"), this);
 	connect(action_create_model_, &QAction::triggered, renderingwidget_, &RenderingWidget::CreateSubdiv2D);
@@ -100,6 +105,7 @@ void MainWindow::CreateToolBars()
 	toolbar_basic_->addAction(action_loadmesh_);
 	toolbar_basic_->addAction(action_loadtexture_);
 	toolbar_basic_->addAction(action_background_);
+	toolbar_basic_->addAction(action_optimize_);
 	toolbar_basic_->addAction(action_create_model_);
 }
 
@@ -135,9 +141,20 @@ void MainWindow::CreateRenderGroup()
 	checkbox_light_ = new QCheckBox(tr("Light"), this);
 	connect(checkbox_light_, SIGNAL(clicked(bool)), renderingwidget_, SLOT(CheckLight(bool)));
 
+	checkbox_flat_ = new QCheckBox(tr("Flat"), this);
+	connect(checkbox_flat_, SIGNAL(clicked(bool)), renderingwidget_, SLOT(CheckFlatShading(bool)));
+
 	checkbox_texture_ = new QCheckBox(tr("Texture"), this);
 	connect(checkbox_texture_, SIGNAL(clicked(bool)), renderingwidget_, SLOT(CheckDrawTexture(bool)));
 
+	// in the order of TexMapping
+	combobox_mapping_ = new QComboBox(this);
+	combobox_mapping_->addItem(tr("File UV"));
+	combobox_mapping_->addItem(tr("Spherical"));
+	combobox_mapping_->addItem(tr("Planar"));
+	combobox_mapping_->addItem(tr("Cylindrical"));
+	connect(combobox_mapping_, SIGNAL(currentIndexChanged(int)), renderingwidget_, SLOT(SetTexMapping(int)));
+
 	checkbox_axes_ = new QCheckBox(tr("Axes"), this);
 	connect(checkbox_axes_, SIGNAL(clicked(bool)), renderingwidget_, SLOT(CheckDrawAxes(bool)));
 
@@ -147,6 +164,28 @@ void MainWindow::CreateRenderGroup()
 	checkbox_global_ = new QCheckBox(tr("Global"), this);
 	connect(checkbox_global_, SIGNAL(clicked(bool)), renderingwidget_, SLOT(CheckDrawMinimalSurfaceGlobal(bool)));
 
+	checkbox_cotangent_ = new QCheckBox(tr("Cotangent"), this);
+	connect(checkbox_cotangent_, SIGNAL(clicked(bool)), renderingwidget_, SLOT(CheckDrawMinimalSurfaceCotangent(bool)));
+
+	// the minimal surface of the vertices selected by a Ctrl drag, the rest of the mesh stays
+	checkbox_region_ = new QCheckBox(tr("Region"), this);
+	connect(checkbox_region_, SIGNAL(clicked(bool)), renderingwidget_, SLOT(CheckDrawMinimalSurfaceRegion(bool)));
+
+	// hold or stop the local solve in the background and the cotangent steps
+	pushbutton_pause_ = new QPushButton(tr("Pause"), this);
+	pushbutton_pause_->setCheckable(true);
+	connect(pushbutton_pause_, SIGNAL(toggled(bool)), renderingwidget_, SLOT(PauseSolver(bool)));
+
+	pushbutton_cancel_ = new QPushButton(tr("Cancel"), this);
+	connect(pushbutton_cancel_, SIGNAL(clicked()), renderingwidget_, SLOT(CancelSolver()));
+
+	spinbox_budget_ = new QSpinBox(this);
+	spinbox_budget_->setPrefix(tr("Triangles "));
+	spinbox_budget_->setRange(100, 100000000);
+	spinbox_budget_->setSingleStep(10000);
+	spinbox_budget_->setValue(10000000);
+	connect(spinbox_budget_, SIGNAL(valueChanged(int)), renderingwidget_, SLOT(SetTriangleBudget(int)));
+
 	groupbox_render_ = new QGroupBox(tr("Render"), this);
 
 	QVBoxLayout* render_layout = new QVBoxLayout(groupbox_render_);
@@ -154,10 +193,19 @@ void MainWindow::CreateRenderGroup()
 	render_layout->addWidget(checkbox_edge_);
 	render_layout->addWidget(checkbox_face_);
 	render_layout->addWidget(checkbox_texture_);
+	render_layout->addWidget(combobox_mapping_);
 	render_layout->addWidget(checkbox_light_);
+	render_layout->addWidget(checkbox_flat_);
 	render_layout->addWidget(checkbox_axes_);
 	render_layout->addWidget(checkbox_local_);
 	render_layout->addWidget(checkbox_global_);
+	render_layout->addWidget(checkbox_cotangent_);
+	render_layout->addWidget(checkbox_region_);
+	QHBoxLayout* solver_layout = new QHBoxLayout();
+	solver_layout->addWidget(pushbutton_pause_);
+	solver_layout->addWidget(pushbutton_cancel_);
+	render_layout->addLayout(solver_layout);
+	render_layout->addWidget(spinbox_budget_);
 }
 
 void MainWindow::keyPressEvent(QKeyEvent *e)
@@ -7,6 +7,8 @@
 class QLabel;
 class QPushButton;
 class QCheckBox;
+class QSpinBox;
+class QComboBox;
 class QGroupBox;
 class RenderingWidget;
 
@@ -57,16 +59,24 @@ private:
 	QAction							*action_loadmesh_;
 	QAction							*action_loadtexture_;
 	QAction							*action_background_;
+	QAction							*action_optimize_;
 
 	// Render RadioButtons
 	QCheckBox						*checkbox_point_;
 	QCheckBox						*checkbox_edge_;
 	QCheckBox						*checkbox_face_;
 	QCheckBox						*checkbox_light_;
+	QCheckBox						*checkbox_flat_;
 	QCheckBox						*checkbox_texture_;
+	QComboBox						*combobox_mapping_;
 	QCheckBox						*checkbox_axes_;
 	QCheckBox						*checkbox_local_;
 	QCheckBox						*checkbox_global_;
+	QCheckBox						*checkbox_cotangent_;
+	QCheckBox						*checkbox_region_;
+	QPushButton						*pushbutton_pause_;
+	QPushButton						*pushbutton_cancel_;
+	QSpinBox						*spinbox_budget_;
 
 	QGroupBox						*groupbox_render_;
 
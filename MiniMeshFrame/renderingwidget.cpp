@@ -7,25 +7,65 @@
 #include <QtWidgets/QMenu>
 #include <QtWidgets/QAction>
 #include <QTextCodec>
+#include <QFileInfo>
 #include <gl/GLU.h>
 #include <gl/glut.h>
 #include <algorithm>
 #include "mainwindow.h"
 #include "ArcBall.h"
+#include "MeshRenderer.h"
+#include "RenderScheduler.h"
+#include "MeshShader.h"
+#include "RenderState.h"
 #include "globalFunctions.h"
-#include <Eigen/Dense>
-#include<Eigen/Sparse>
+#include "HE_mesh/ProgressiveMesh.h"
+#include "HE_mesh/StreamSimplifier.h"
+#include "HE_mesh/MeshLOD.h"
+#include "HE_mesh/MeshOptimizer.h"
+#include "HE_mesh/SolverThread.h"
+#include "HE_mesh/LaplacianSmoother.h"
+#include "HE_mesh/LaplaceSolver.h"
+#include "HE_mesh/MinimalSurfaceFlow.h"
+#include "HE_mesh/RegionSolver.h"
 #include <stdlib.h> 
 #include <ctime>
-using namespace Eigen;
+#include <climits>
 using namespace std;
 
+//! OBJ and PLY files larger than this are simplified while they are read instead of loaded
+static const qint64 kSimplifyFileSize = qint64(256) << 20;
+//! the largest number of vertices of a mesh simplified while read
+static const int kSimplifyMaxVertices = 1 << 20;
+//! a progressive mesh written from the widget keeps this fraction of the faces in its base mesh
+static const int kProgressiveBaseRatio = 1000;
+//! and at least this many faces
+static const int kProgressiveMinBaseFaces = 200;
+//! iterations of a background solve between two snapshots shown
+static const int kSolverPublishInterval = 10;
+//! milliseconds between two looks for a new snapshot
+static const int kSolverPollInterval = 15;
+//! pixels around the cursor selected by a Ctrl drag
+static const int kSelectionRadius = 12;
+//! milliseconds without a change of the mesh before its proxies are built again
+static const int kLodSettleInterval = 500;
+
 RenderingWidget::RenderingWidget(QWidget *parent, MainWindow* mainwindow)
 	: QGLWidget(parent), ptr_mainwindow_(mainwindow), eye_distance_(5.0),
 	has_lighting_(false), is_draw_point_(true), is_draw_edge_(false), is_draw_face_(false), is_draw_texture_(false)
 {
 	ptr_arcball_ = new CArcBall(width(), height());
 	ptr_mesh_ = new Mesh3D();
+	ptr_renderer_ = NULL;
+	ptr_shader_ = NULL;
+	ptr_scheduler_ = new RenderScheduler();
+	render_timer_id_ = 0;
+	is_show_frame_time_ = false;
+	is_backface_culling_ = false;
+
+	ptr_lod_ = new MeshLOD();
+	lod_level_ = -1;
+	is_interacting_ = false;
+	lod_timer_id_ = 0;
 
 	is_load_texture_ = false;
 	is_draw_axes_ = false;
@@ -34,33 +74,79 @@ RenderingWidget::RenderingWidget(QWidget *parent, MainWindow* mainwindow)
 	eye_direction_[0] = eye_direction_[1] = 0.0;
 	eye_direction_[2] = 1.0;
 
-	is_draw_minimal_surface_local_ = false;
-	is_draw_minimal_surface_global_ = false;
+	ptr_solver_ = new SolverThread();
+	ptr_laplace_ = new LaplaceSolver();
+	ptr_laplace_->set_mixed_precision(true);
+	ptr_flow_ = new MinimalSurfaceFlow();
+	flow_timer_id_ = 0;
+	ptr_region_ = new RegionSolver();
+	solver_timer_id_ = 0;
+	selection_version_ = 0;
+	is_selecting_ = false;
+
+	ptr_pm_stream_ = NULL;
+	pm_face_budget_ = 10000000;
+	pm_timer_id_ = 0;
 }
 
 RenderingWidget::~RenderingWidget()
 {
+	SafeDelete(ptr_solver_);
+	SafeDelete(ptr_laplace_);
+	SafeDelete(ptr_flow_);
+	SafeDelete(ptr_region_);
+	makeCurrent();
+	if (ptr_shader_ != NULL)
+	{
+		ptr_shader_->Release();
+		SafeDelete(ptr_shader_);
+		ptr_shader_ = NULL;
+	}
+	if (ptr_renderer_ != NULL)
+	{
+		ptr_renderer_->Release();
+		SafeDelete(ptr_renderer_);
+		ptr_renderer_ = NULL;
+	}
+	ptr_scheduler_->Release();
+	SafeDelete(ptr_scheduler_);
+	for (size_t i = 0; i < lod_renderers_.size(); i++)
+	{
+		lod_renderers_[i]->Release();
+		SafeDelete(lod_renderers_[i]);
+	}
+	lod_renderers_.clear();
+	SafeDelete(ptr_lod_);
 	SafeDelete(ptr_arcball_);
 	SafeDelete(ptr_mesh_);
+	SafeDelete(ptr_pm_stream_);
 }
 
 void RenderingWidget::initializeGL()
 {
-	glClearColor(0.3, 0.3, 0.3, 0.0);
-	glShadeModel(GL_SMOOTH);
+	InitializeRenderState();
+	SetLight();
 
-	glEnable(GL_DOUBLEBUFFER);
-	glEnable(GL_POINT_SMOOTH);
-	glEnable(GL_LINE_SMOOTH);
-	glEnable(GL_POLYGON_SMOOTH);
-	glHint(GL_POINT_SMOOTH_HINT, GL_NICEST);
-	glHint(GL_LINE_SMOOTH_HINT, GL_NICEST);
-	glHint(GL_POLYGON_SMOOTH_HINT, GL_NICEST);
-	glEnable(GL_DEPTH_TEST);
-	glClearDepth(1);
+	ptr_scheduler_->Initialize();
 
-	SetLight();
+	ptr_renderer_ = new MeshRenderer();
+	if (!ptr_renderer_->Initialize())
+	{
+		SafeDelete(ptr_renderer_);
+		ptr_renderer_ = NULL;
+		return;
+	}
 
+	// the shaders read the vertex buffers, so they need the renderer
+	ptr_shader_ = new MeshShader();
+	if (!ptr_shader_->Initialize())
+	{
+		SafeDelete(ptr_shader_);
+		ptr_shader_ = NULL;
+		return;
+	}
+	// the vertex shader decodes the compact vertices
+	ptr_renderer_->set_vertex_format(MeshRenderer::VERTEX_COMPACT);
 }
 
 void RenderingWidget::resizeGL(int w, int h)
@@ -81,7 +167,16 @@ void RenderingWidget::resizeGL(int w, int h)
 
 void RenderingWidget::paintGL()
 {
+	ptr_scheduler_->BeginFrame();
 	glShadeModel(GL_SMOOTH);
+	if (is_backface_culling_)
+	{
+		glEnable(GL_CULL_FACE);
+	}
+	else
+	{
+		glDisable(GL_CULL_FACE);
+	}
 
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -108,11 +203,81 @@ void RenderingWidget::paintGL()
 
 	Render();
 	glPopMatrix();
+
+	ptr_scheduler_->EndFrame();
+	if (is_show_frame_time_)
+	{
+		QString info = QString("Frame: CPU %1 ms, GPU %2 ms")
+			.arg(ptr_scheduler_->cpu_frame_ms(), 0, 'f', 2)
+			.arg(ptr_scheduler_->gpu_frame_ms() < 0 ? QString("n/a") : QString::number(ptr_scheduler_->gpu_frame_ms(), 'f', 2));
+		if (ptr_renderer_ != NULL)
+		{
+			info += QString(", buffers %1 MB").arg(ptr_renderer_->buffer_size() / 1048576.0, 0, 'f', 1);
+			info += QString(", culled %1% of %2 meshlets").arg(ptr_renderer_->culled_ratio() * 100.f, 0, 'f', 1)
+				.arg(ptr_renderer_->num_meshlets());
+			if (ptr_renderer_->vertex_format() == MeshRenderer::VERTEX_COMPACT)
+			{
+				const QuantizationError& error = ptr_renderer_->quantization_error();
+				info += QString(", quantization error: position %1, normal %2 deg, uv %3")
+					.arg(error.position_, 0, 'g', 2).arg(error.normal_, 0, 'f', 3).arg(error.texcoord_, 0, 'g', 2);
+			}
+		}
+		emit(operatorInfo(info));
+	}
 }
 
 void RenderingWidget::timerEvent(QTimerEvent * e)
 {
-	updateGL();
+	if (e->timerId() == pm_timer_id_)
+	{
+		RefineProgressiveMesh();
+	}
+	else if (e->timerId() == solver_timer_id_)
+	{
+		ApplySolverSnapshot();
+	}
+	else if (e->timerId() == flow_timer_id_)
+	{
+		StepMinimalSurfaceFlow();
+	}
+	else if (e->timerId() == lod_timer_id_)
+	{
+		// not in the middle of a drag, the build would stall it
+		if (!is_interacting_)
+		{
+			killTimer(lod_timer_id_);
+			lod_timer_id_ = 0;
+			UpdateLod();
+		}
+	}
+	else if (e->timerId() == render_timer_id_)
+	{
+		killTimer(render_timer_id_);
+		render_timer_id_ = 0;
+		// a paint requested by Qt in the meantime may have served the invalidations
+		if (ptr_scheduler_->isDirty())
+		{
+			updateGL();
+		}
+	}
+}
+
+void RenderingWidget::ScheduleRender(int reasons)
+{
+	ptr_scheduler_->Invalidate(reasons);
+	if (render_timer_id_ == 0)
+	{
+		render_timer_id_ = startTimer(ptr_scheduler_->TimeToNextFrame());
+	}
+	// a solve or a flow changes the mesh every few frames, the proxies wait for it to settle
+	if ((reasons & RENDER_MESH) != 0)
+	{
+		if (lod_timer_id_ != 0)
+		{
+			killTimer(lod_timer_id_);
+		}
+		lod_timer_id_ = startTimer(kLodSettleInterval);
+	}
 }
 
 void RenderingWidget::mousePressEvent(QMouseEvent *e)
@@ -120,16 +285,24 @@ void RenderingWidget::mousePressEvent(QMouseEvent *e)
 	switch (e->button())
 	{
 	case Qt::LeftButton:
+		if (e->modifiers() & Qt::ControlModifier)
+		{
+			is_selecting_ = true;
+			SelectVertices(e->pos());
+			return;
+		}
 		ptr_arcball_->MouseDown(e->pos());
+		is_interacting_ = true;
 		break;
 	case Qt::MidButton:
 		current_position_ = e->pos();
+		is_interacting_ = true;
 		break;
 	default:
 		break;
 	}
 
-	updateGL();
+	ScheduleRender(RENDER_CAMERA);
 }
 void RenderingWidget::mouseMoveEvent(QMouseEvent *e)
 {
@@ -137,6 +310,11 @@ void RenderingWidget::mouseMoveEvent(QMouseEvent *e)
 	{
 		setCursor(Qt::ClosedHandCursor);
 	case Qt::LeftButton:
+		if (is_selecting_)
+		{
+			SelectVertices(e->pos());
+			return;
+		}
 		ptr_arcball_->MouseMove(e->pos());
 		break;
 	case Qt::MidButton:
@@ -148,7 +326,7 @@ void RenderingWidget::mouseMoveEvent(QMouseEvent *e)
 		break;
 	}
 
-	updateGL();
+	ScheduleRender(RENDER_CAMERA);
 }
 void RenderingWidget::mouseDoubleClickEvent(QMouseEvent *e)
 {
@@ -159,13 +337,18 @@ void RenderingWidget::mouseDoubleClickEvent(QMouseEvent *e)
 	default:
 		break;
 	}
-	updateGL();
+	ScheduleRender(RENDER_CAMERA);
 }
 void RenderingWidget::mouseReleaseEvent(QMouseEvent *e)
 {
 	switch (e->button())
 	{
 	case Qt::LeftButton:
+		if (is_selecting_)
+		{
+			is_selecting_ = false;
+			return;
+		}
 		ptr_arcball_->MouseUp(e->pos());
 		setCursor(Qt::ArrowCursor);
 		break;
@@ -175,6 +358,13 @@ void RenderingWidget::mouseReleaseEvent(QMouseEvent *e)
 	default:
 		break;
 	}
+
+	// the next frame is drawn at full detail again
+	if (is_interacting_ && e->buttons() == Qt::NoButton)
+	{
+		is_interacting_ = false;
+		ScheduleRender(RENDER_CAMERA);
+	}
 }
 
 void RenderingWidget::wheelEvent(QWheelEvent *e)
@@ -182,7 +372,7 @@ void RenderingWidget::wheelEvent(QWheelEvent *e)
 	eye_distance_ += e->delta()*0.001;
 	eye_distance_ = eye_distance_ < 0 ? 0 : eye_distance_;
 
-	updateGL();
+	ScheduleRender(RENDER_CAMERA);
 }
 
 void RenderingWidget::keyPressEvent(QKeyEvent *e)
@@ -191,6 +381,32 @@ void RenderingWidget::keyPressEvent(QKeyEvent *e)
 	{
 	case Qt::Key_A:
 		break;
+	case Qt::Key_F:
+		// toggle the frame time report in the status bar
+		is_show_frame_time_ = !is_show_frame_time_;
+		ScheduleRender(RENDER_SETTINGS);
+		break;
+	case Qt::Key_B:
+		// back faces of open meshes are visible, so backface culling is left to the user
+		is_backface_culling_ = !is_backface_culling_;
+		if (ptr_renderer_ != NULL)
+		{
+			ptr_renderer_->set_backface_culling(is_backface_culling_);
+		}
+		for (size_t i = 0; i < lod_renderers_.size(); i++)
+		{
+			lod_renderers_[i]->set_backface_culling(is_backface_culling_);
+		}
+		emit(operatorInfo(QString("Backface culling ") + (is_backface_culling_ ? "on" : "off")));
+		ScheduleRender(RENDER_SETTINGS);
+		break;
+	case Qt::Key_S:
+		// one implicit smoothing of the selection, the rest of the mesh stays
+		SolveRegion(true);
+		break;
+	case Qt::Key_C:
+		ClearSelection();
+		break;
 	default:
 		break;
 	}
@@ -211,32 +427,119 @@ void RenderingWidget::Render()
 {
 	DrawAxes(is_draw_axes_);
 
-	DrawPoints(is_draw_point_);
-	DrawEdge(is_draw_edge_);
-	DrawFace(is_draw_face_);
-	DrawTexture(is_draw_texture_);
+	// while the view is dragged, a proxy that fits the frame time stands in for the mesh
+	int level = SelectLodLevel();
+	if (level >= 0)
+	{
+		DrawLodProxy(level);
+	}
+	else
+	{
+		DrawPoints(is_draw_point_);
+		if (!DrawShaded(ptr_renderer_, ptr_mesh_))
+		{
+			DrawEdge(is_draw_edge_);
+			DrawFace(is_draw_face_);
+			DrawTexture(is_draw_texture_);
+		}
+		DrawSelection();
+	}
+}
 
-	DrawMinimalSurface_Local(is_draw_minimal_surface_local_);
-	DrawMinimalSurface_Global(is_draw_minimal_surface_global_);
+void RenderingWidget::UpdateLod()
+{
+	// proxies are only drawn through vertex buffers
+	if (ptr_renderer_ == NULL || ptr_lod_->isBuiltFor(ptr_mesh_))
+	{
+		return;
+	}
+	ptr_lod_->Build(ptr_mesh_);
+	lod_level_ = -1;
 }
 
-void RenderingWidget::SetLight()
+int RenderingWidget::SelectLodLevel()
+{
+	int full = ptr_lod_->num_levels() - 1;
+	if (!is_interacting_ || ptr_renderer_ == NULL || full == 0 || !ptr_lod_->isBuiltFor(ptr_mesh_))
+	{
+		lod_level_ = -1;
+		return -1;
+	}
+	int drawn = lod_level_ < 0 ? full : lod_level_;
+	int level = ptr_lod_->SelectLevel(drawn, ptr_scheduler_->last_frame_ms(), ptr_scheduler_->target_frame_ms());
+	lod_level_ = level == full ? -1 : level;
+	return lod_level_;
+}
+
+void RenderingWidget::DrawLodProxy(int level)
 {
-	static GLfloat mat_specular[] = { 1.0, 1.0, 1.0, 1.0 };
-	static GLfloat mat_shininess[] = { 50.0 };
-	static GLfloat light_position[] = { 1.0, 1.0, 1.0, 0.0 };
-	static GLfloat white_light[] = { 0.8, 0.8, 0.8, 1.0 };
-	static GLfloat lmodel_ambient[] = { 0.3, 0.3, 0.3, 1.0 };
+	while (static_cast<int>(lod_renderers_.size()) <= level)
+	{
+		lod_renderers_.push_back(new MeshRenderer());
+		lod_renderers_.back()->Initialize();
+		lod_renderers_.back()->set_vertex_format(ptr_renderer_->vertex_format());
+		lod_renderers_.back()->set_backface_culling(is_backface_culling_);
+	}
+	Mesh3D *proxy = ptr_lod_->level(level);
+	MeshRenderer *renderer = lod_renderers_[level];
+	if (is_draw_texture_ && is_load_texture_)
+	{
+		// proxies follow the mapping of the mesh
+		proxy->set_tex_mapping(ptr_mesh_->tex_mapping());
+		proxy->UpdateTexCoords();
+	}
+	if (!renderer->Update(proxy))
+	{
+		return;
+	}
+
+	if (is_draw_point_)
+	{
+		renderer->DrawPoints();
+	}
+	if (DrawShaded(renderer, proxy))
+	{
+		return;
+	}
+	if (is_draw_edge_)
+	{
+		renderer->DrawEdges();
+	}
+	if (is_draw_face_)
+	{
+		renderer->DrawFaces(false);
+	}
+	if (is_draw_texture_ && is_load_texture_)
+	{
+		glBindTexture(GL_TEXTURE_2D, texture_[0]);
+		renderer->DrawFaces(true);
+	}
+}
 
-	glMaterialfv(GL_FRONT, GL_SPECULAR, mat_specular);
-	glMaterialfv(GL_FRONT, GL_SHININESS, mat_shininess);
-	glLightfv(GL_LIGHT0, GL_POSITION, light_position);
-	glLightfv(GL_LIGHT0, GL_DIFFUSE, white_light);
-	glLightfv(GL_LIGHT0, GL_SPECULAR, white_light);
-	glLightModelfv(GL_LIGHT_MODEL_AMBIENT, lmodel_ambient);
+bool RenderingWidget::DrawShaded(MeshRenderer* renderer, Mesh3D* mesh)
+{
+	if (ptr_shader_ == NULL || renderer == NULL)
+	{
+		return false;
+	}
+	bool textured = is_draw_texture_ && is_load_texture_ && mesh->num_of_face_list() > 0;
+	if (textured)
+	{
+		mesh->set_tex_mapping(ptr_mesh_->tex_mapping());
+		mesh->UpdateTexCoords();
+		glBindTexture(GL_TEXTURE_2D, texture_[0]);
+	}
+	if (!renderer->Update(mesh))
+	{
+		return true;
+	}
+	ptr_shader_->Draw(renderer, is_draw_face_ || textured, is_draw_edge_, has_lighting_, textured);
+	return true;
+}
 
-	glEnable(GL_LIGHTING);
-	glEnable(GL_LIGHT0);
+void RenderingWidget::SetLight()
+{
+	SetDefaultLight();
 }
 
 void RenderingWidget::SetBackground()
@@ -247,14 +550,14 @@ void RenderingWidget::SetBackground()
 	GLfloat b = (color.blue()) / 255.0f;
 	GLfloat alpha = color.alpha() / 255.0f;
 	glClearColor(r, g, b, alpha);
-	updateGL();
+	ScheduleRender(RENDER_SETTINGS);
 }
 
 void RenderingWidget::ReadMesh()
 {
 	QString filename = QFileDialog::
 		getOpenFileName(this, tr("Read Mesh"),
-			"..", tr("Meshes (*.obj)"));
+			"..", tr("Meshes (*.obj *.ply *.pm)"));
 
 	if (filename.isEmpty())
 	{
@@ -266,12 +569,26 @@ void RenderingWidget::ReadMesh()
 	QTextCodec::setCodecForLocale(code);
 
 	QByteArray byfilename = filename.toLocal8Bit();
-	ptr_mesh_->LoadFromOBJFile(byfilename.data());
+	StopSolver();
+	StopProgressiveMesh();
+	if (filename.endsWith(".pm", Qt::CaseInsensitive))
+	{
+		LoadProgressiveMesh(byfilename.data());
+		return;
+	}
+	if (QFileInfo(filename).size() > kSimplifyFileSize)
+	{
+		LoadSimplifiedMesh(byfilename.data());
+		return;
+	}
+	bool is_loaded = filename.endsWith(".ply", Qt::CaseInsensitive) ? ptr_mesh_->LoadFromPLYFile(byfilename.data())
+		: ptr_mesh_->LoadFromOBJFile(byfilename.data());
 
 	//	m_pMesh->LoadFromOBJFile(filename.toLatin1().data());
-	emit(operatorInfo(QString("Read Mesh from") + filename + QString(" Done")));
+	UpdateLod();
+	emit(operatorInfo(is_loaded ? QString("Read Mesh from") + filename + QString(" Done") : QString("Read Mesh Failed!")));
 	emit(meshInfo(ptr_mesh_->num_of_vertex_list(), ptr_mesh_->num_of_edge_list(), ptr_mesh_->num_of_face_list()));
-	updateGL();
+	ScheduleRender(RENDER_MESH);
 }
 
 void RenderingWidget::WriteMesh()
@@ -283,16 +600,50 @@ void RenderingWidget::WriteMesh()
 	}
 	QString filename = QFileDialog::
 		getSaveFileName(this, tr("Write Mesh"),
-			"..", tr("Meshes (*.obj)"));
+			"..", tr("Meshes (*.obj);;Progressive Meshes (*.pm)"));
 
 	if (filename.isEmpty())
 		return;
 
+	if (filename.endsWith(".pm", Qt::CaseInsensitive))
+	{
+		ProgressiveMesh pm;
+		int base_faces = std::max(kProgressiveMinBaseFaces, ptr_mesh_->num_of_face_list() / kProgressiveBaseRatio);
+		if (!pm.Build(ptr_mesh_, base_faces) || !pm.Save(filename.toLocal8Bit().data()))
+		{
+			emit(operatorInfo(QString("Write Progressive Mesh Failed!")));
+			return;
+		}
+		emit(operatorInfo(QString("Write Progressive Mesh to ") + filename + QString(" Done")));
+		return;
+	}
+
 	ptr_mesh_->WriteToOBJFile(filename.toLatin1().data());
 
 	emit(operatorInfo(QString("Write Mesh to ") + filename + QString(" Done")));
 }
 
+void RenderingWidget::OptimizeMesh()
+{
+	// the stream would rebuild the mesh in its own order, the solver would write the old ids
+	StopSolver();
+	StopProgressiveMesh();
+
+	MeshOptimizer optimizer;
+	if (!optimizer.Optimize(ptr_mesh_))
+	{
+		emit(operatorInfo(QString("Optimize Mesh Failed!")));
+		return;
+	}
+	UpdateLod();
+	emit(operatorInfo(QString("Vertex cache %1: ACMR %2 -> %3, ATVR %4 -> %5, %6 overdraw clusters")
+		.arg(optimizer.cache_size())
+		.arg(optimizer.acmr_before(), 0, 'f', 3).arg(optimizer.acmr_after(), 0, 'f', 3)
+		.arg(optimizer.atvr_before(), 0, 'f', 3).arg(optimizer.atvr_after(), 0, 'f', 3)
+		.arg(optimizer.num_clusters())));
+	ScheduleRender(RENDER_MESH);
+}
+
 void RenderingWidget::LoadTexture()
 {
 	QString filename = QFileDialog::getOpenFileName(this, tr("Load Texture"),
@@ -326,28 +677,113 @@ void RenderingWidget::LoadTexture()
 		GL_RGBA, GL_UNSIGNED_BYTE, tex1.bits());
 
 	is_load_texture_ = true;
+	ScheduleRender(RENDER_SETTINGS);
 	emit(operatorInfo(QString("Load Texture from ") + filename + QString(" Done")));
 }
 
+void RenderingWidget::LoadProgressiveMesh(const char* fins)
+{
+	ptr_pm_stream_ = new ProgressiveMeshStream;
+	if (!ptr_pm_stream_->Open(fins))
+	{
+		SafeDelete(ptr_pm_stream_);
+		ptr_pm_stream_ = NULL;
+		emit(operatorInfo(QString("Read Progressive Mesh Failed!")));
+		return;
+	}
+
+	// show the base mesh at once, the splits are applied from timerEvent
+	ptr_mesh_->CreateMesh(ptr_pm_stream_->verts(), ptr_pm_stream_->faces());
+	emit(meshInfo(ptr_mesh_->num_of_vertex_list(), ptr_mesh_->num_of_edge_list(), ptr_mesh_->num_of_face_list()));
+	if (!ptr_pm_stream_->finished() && ptr_pm_stream_->num_face() < pm_face_budget_)
+	{
+		pm_timer_id_ = startTimer(0);
+	}
+	ScheduleRender(RENDER_MESH);
+}
+
+void RenderingWidget::LoadSimplifiedMesh(const char* fins)
+{
+	StreamSimplifier simplifier;
+	simplifier.set_max_vertices(kSimplifyMaxVertices);
+	if (!simplifier.Run(fins))
+	{
+		emit(operatorInfo(QString("Read Mesh Failed!")));
+		return;
+	}
+
+	ptr_mesh_->CreateMesh(simplifier.vertices(), simplifier.triangles());
+	UpdateLod();
+	emit(operatorInfo(QString("Read Mesh from %1 simplified, the file is over %2 MB: %3 faces clustered to %4")
+		.arg(QString::fromLocal8Bit(fins)).arg(kSimplifyFileSize >> 20)
+		.arg(simplifier.num_input_face()).arg(ptr_mesh_->num_of_face_list())));
+	emit(meshInfo(ptr_mesh_->num_of_vertex_list(), ptr_mesh_->num_of_edge_list(), ptr_mesh_->num_of_face_list()));
+	ScheduleRender(RENDER_MESH);
+}
+
+void RenderingWidget::RefineProgressiveMesh()
+{
+	if (ptr_pm_stream_ == NULL || ptr_pm_stream_->finished() || ptr_pm_stream_->num_face() >= pm_face_budget_)
+	{
+		killTimer(pm_timer_id_);
+		pm_timer_id_ = 0;
+		return;
+	}
+
+	// double the face count per step, so rebuilding the half-edge mesh stays O(n log n) overall
+	int target = ptr_pm_stream_->num_face() * 2 + 64;
+	target = target < pm_face_budget_ ? target : pm_face_budget_;
+	if (ptr_pm_stream_->Refine(target, INT_MAX) == 0)
+	{
+		return;
+	}
+
+	ptr_mesh_->CreateMesh(ptr_pm_stream_->verts(), ptr_pm_stream_->faces());
+	ScheduleRender(RENDER_MESH);
+	emit(meshInfo(ptr_mesh_->num_of_vertex_list(), ptr_mesh_->num_of_edge_list(), ptr_mesh_->num_of_face_list()));
+	emit(operatorInfo(QString("Progressive Mesh: %1 / %2 faces").arg(ptr_pm_stream_->num_face()).arg(ptr_pm_stream_->num_full_face())));
+}
+
+void RenderingWidget::StopProgressiveMesh()
+{
+	if (pm_timer_id_ != 0)
+	{
+		killTimer(pm_timer_id_);
+		pm_timer_id_ = 0;
+	}
+	SafeDelete(ptr_pm_stream_);
+	ptr_pm_stream_ = NULL;
+}
+
+void RenderingWidget::SetTriangleBudget(int n)
+{
+	pm_face_budget_ = n;
+	if (ptr_pm_stream_ != NULL && pm_timer_id_ == 0
+		&& !ptr_pm_stream_->finished() && ptr_pm_stream_->num_face() < pm_face_budget_)
+	{
+		pm_timer_id_ = startTimer(0);
+	}
+}
+
 void RenderingWidget::CheckDrawPoint(bool bv)
 {
 	is_draw_point_ = bv;
-	updateGL();
+	ScheduleRender(RENDER_SETTINGS);
 }
 void RenderingWidget::CheckDrawEdge(bool bv)
 {
 	is_draw_edge_ = bv;
-	updateGL();
+	ScheduleRender(RENDER_SETTINGS);
 }
 void RenderingWidget::CheckDrawFace(bool bv)
 {
 	is_draw_face_ = bv;
-	updateGL();
+	ScheduleRender(RENDER_SETTINGS);
 }
 void RenderingWidget::CheckLight(bool bv)
 {
 	has_lighting_ = bv;
-	updateGL();
+	ScheduleRender(RENDER_SETTINGS);
 }
 void RenderingWidget::CheckDrawTexture(bool bv)
 {
@@ -357,24 +793,71 @@ void RenderingWidget::CheckDrawTexture(bool bv)
 	else
 		glDisable(GL_TEXTURE_2D);
 
-	updateGL();
+	ScheduleRender(RENDER_SETTINGS);
+}
+
+void RenderingWidget::SetTexMapping(int mapping)
+{
+	ptr_mesh_->set_tex_mapping(static_cast<TexMapping>(mapping));
+	ScheduleRender(RENDER_MESH);
+}
+
+void RenderingWidget::CheckFlatShading(bool bv)
+{
+	if (ptr_shader_ != NULL)
+	{
+		ptr_shader_->set_flat_shading(bv);
+	}
+	ScheduleRender(RENDER_SETTINGS);
 }
+
 void RenderingWidget::CheckDrawAxes(bool bV)
 {
 	is_draw_axes_ = bV;
-	updateGL();
+	ScheduleRender(RENDER_SETTINGS);
 }
 
 void RenderingWidget::CheckDrawMinimalSurfaceLocal(bool bv)
 {
-	is_draw_minimal_surface_local_ = bv;
-	updateGL();
+	if (bv)
+	{
+		SolveMinimalSurface_Local();
+	}
+	else
+	{
+		CancelSolver();
+	}
 }
 
 void RenderingWidget::CheckDrawMinimalSurfaceGlobal(bool bv)
 {
-	is_draw_minimal_surface_global_ = bv;
-	updateGL();
+	// both would write the positions
+	StopSolver();
+	if (bv)
+	{
+		SolveMinimalSurface_Global();
+	}
+	ScheduleRender(RENDER_MESH);
+}
+
+void RenderingWidget::CheckDrawMinimalSurfaceCotangent(bool bv)
+{
+	if (bv)
+	{
+		SolveMinimalSurface_Cotangent();
+	}
+	else
+	{
+		CancelSolver();
+	}
+}
+
+void RenderingWidget::CheckDrawMinimalSurfaceRegion(bool bv)
+{
+	if (bv)
+	{
+		SolveRegion(false);
+	}
 }
 
 void RenderingWidget::DrawAxes(bool bV)
@@ -429,6 +912,12 @@ void RenderingWidget::DrawPoints(bool bv)
 		return;
 	}
 
+	if (ptr_renderer_ != NULL && ptr_renderer_->Update(ptr_mesh_))
+	{
+		ptr_renderer_->DrawPoints();
+		return;
+	}
+
 	const std::vector<HE_vert*>& verts = *(ptr_mesh_->get_vertex_list());
 	glBegin(GL_POINTS);
 	for (size_t i = 0; i != ptr_mesh_->num_of_vertex_list(); ++i)
@@ -449,6 +938,12 @@ void RenderingWidget::DrawEdge(bool bv)
 		return;
 	}
 
+	if (ptr_renderer_ != NULL && ptr_renderer_->Update(ptr_mesh_))
+	{
+		ptr_renderer_->DrawEdges();
+		return;
+	}
+
 	const std::vector<HE_face *>& faces = *(ptr_mesh_->get_faces_list());
 	for (size_t i = 0; i != faces.size(); ++i)
 	{
@@ -476,6 +971,12 @@ void RenderingWidget::DrawFace(bool bv)
 		return;
 	}
 
+	if (ptr_renderer_ != NULL && ptr_renderer_->Update(ptr_mesh_))
+	{
+		ptr_renderer_->DrawFaces(false);
+		return;
+	}
+
 	const std::vector<HE_face *>& faces = *(ptr_mesh_->get_faces_list());
 
 	glBegin(GL_TRIANGLES);
@@ -504,11 +1005,16 @@ void RenderingWidget::DrawTexture(bool bv)
 		return;
 
 	//Ĭʹӳ䣬Ч
-	ptr_mesh_->SphereTex();
-
-	const std::vector<HE_face *>& faces = *(ptr_mesh_->get_faces_list());
+	ptr_mesh_->UpdateTexCoords();
 
 	glBindTexture(GL_TEXTURE_2D, texture_[0]);
+	if (ptr_renderer_ != NULL && ptr_renderer_->Update(ptr_mesh_))
+	{
+		ptr_renderer_->DrawFaces(true);
+		return;
+	}
+
+	const std::vector<HE_face *>& faces = *(ptr_mesh_->get_faces_list());
 	glBegin(GL_TRIANGLES);
 	for (size_t i = 0; i != faces.size(); ++i)
 	{
@@ -528,120 +1034,249 @@ void RenderingWidget::DrawTexture(bool bv)
 	glEnd();
 }
 
-void RenderingWidget::DrawMinimalSurface_Local(bool bv)
+void RenderingWidget::SolveMinimalSurface_Local()
 {
-	if (!bv || ptr_mesh_ == NULL)
+	StopSolver();
+	if (ptr_mesh_ == NULL || ptr_mesh_->num_of_face_list() == 0)
+		return;
+
+	// SOR converges to the same surface as the damped Jacobi steps, in far fewer sweeps
+	LaplacianSmoother *solver = new LaplacianSmoother();
+	solver->set_method(LaplacianSmoother::GAUSS_SEIDEL);
+	solver->set_relaxation(1.8f);
+	if (!solver->Initialize(ptr_mesh_))
+	{
+		SafeDelete(solver);
+		emit(operatorInfo(QString("Minimal Surface: the mesh has no boundary")));
 		return;
-	if (ptr_mesh_->num_of_face_list() == 0 || !is_draw_minimal_surface_local_)
+	}
+	// the iterations run on a copy, the snapshots are applied from timerEvent
+	ptr_solver_->Start(solver, kSolverPublishInterval);
+	solver_timer_id_ = startTimer(kSolverPollInterval);
+}
+
+void RenderingWidget::ApplySolverSnapshot()
+{
+	if (!ptr_solver_->AcquireSnapshot())
 		return;
+	const SolverSnapshot& snapshot = ptr_solver_->snapshot();
 	const std::vector<HE_vert*>& verts = *(ptr_mesh_->get_vertex_list());
-	Vec3f t, vi;
-	int count;
-	std::vector<Vec3f> newVertsPosition;
-	std::vector<int> change;
-	for (int times = 0; times < 3000; times++) {
-		newVertsPosition.clear();
-		change.clear();
-		for (size_t i = 0; i != ptr_mesh_->num_of_vertex_list(); ++i)
-		{
-			if (!verts[i]->isOnBoundary()) {
-				change.push_back(i);
-				HE_edge* edge = verts[i]->pedge_;
-				count = 0;
-				t.fill(0.0);
-				do {
-					count++;
-					vi = edge->pvert_->position();
-					t += (verts[i]->position() - vi);
-					// do something with edge, edge->pair or edge->face
-					edge = edge->ppair_->pnext_;
-				} while (edge != verts[i]->pedge_);
-				t /= count;
-				t *= 0.3;
-				newVertsPosition.push_back(verts[i]->position() - t);
-			}
-		}
-		bool closed_surface = verts.size() == newVertsPosition.size();
+	if (snapshot.positions_.size() != verts.size())
+	{
+		StopSolver();
+		return;
+	}
+	for (size_t i = 0; i != verts.size(); i++)
+	{
+		verts[i]->set_position(snapshot.positions_[i]);
+	}
+	ptr_mesh_->MarkGeometryChanged();
+	ScheduleRender(RENDER_MESH);
 
-		if (closed_surface) {
-			is_draw_minimal_surface_global_ = false;
-			return;
-		}
+	emit(operatorInfo(QString("Minimal Surface: iteration %1, residual %2%3").arg(snapshot.iteration_)
+		.arg(snapshot.residual_, 0, 'g', 3).arg(snapshot.is_finished_ ? QString(" Done") : QString())));
+	if (snapshot.is_finished_)
+	{
+		StopSolver();
+	}
+}
 
-		for (size_t i = 0; i < change.size(); ++i) {
-			verts[change[i]]->set_position(newVertsPosition[i]);
-		}
+void RenderingWidget::StopSolver()
+{
+	if (solver_timer_id_ != 0)
+	{
+		killTimer(solver_timer_id_);
+		solver_timer_id_ = 0;
 	}
+	if (flow_timer_id_ != 0)
+	{
+		killTimer(flow_timer_id_);
+		flow_timer_id_ = 0;
+	}
+	ptr_solver_->Cancel();
+}
 
-	is_draw_minimal_surface_local_ = false;
+void RenderingWidget::PauseSolver(bool paused)
+{
+	ptr_solver_->Pause(paused);
 }
 
-void RenderingWidget::DrawMinimalSurface_Global(bool bv)
+void RenderingWidget::CancelSolver()
 {
-	if (!bv || ptr_mesh_ == NULL)
+	if (!ptr_solver_->isRunning() && flow_timer_id_ == 0)
 		return;
-	if (ptr_mesh_->num_of_face_list() == 0 || !is_draw_minimal_surface_global_)
-		return;
-
+	StopSolver();
+	emit(operatorInfo(QString("Minimal Surface: Canceled")));
+}
 
-	const std::vector<HE_vert*>& verts = *(ptr_mesh_->get_vertex_list());
-	int m = verts.size();
-	SparseMatrix<double>  A(m, m);
-	std::vector<Triplet<double>> coef;
-	VectorXd conX(m), conY(m), conZ(m);
-	Vec3f vert;
-	int boundary_verts = 0;
+void RenderingWidget::SolveMinimalSurface_Global()
+{
+	if (ptr_mesh_ == NULL || ptr_mesh_->num_of_face_list() == 0)
+		return;
 
-	for (size_t i = 0; i != ptr_mesh_->num_of_vertex_list(); ++i)
+	// the factors are kept while the connectivity stays the same
+	if (!ptr_laplace_->Solve(ptr_mesh_))
 	{
-		vert = verts[i]->position();
-		if (verts[i]->isOnBoundary()) {
-			coef.push_back(Triplet<double>(i, i, 1));
-			conX(i) = vert.x();
-			conY(i) = vert.y();
-			conZ(i) = vert.z();
-		}
-		else {
-			int count = 0, id;
-			boundary_verts++;
-			conX(i) = conY(i) = conZ(i) = 0;
-			HE_edge* edge = verts[i]->pedge_;
-			do {
-				count++;
-				id = edge->pvert_->id();
-				coef.push_back(Triplet<double>(i, id, -1));
-				// do something with edge, edge->pair or edge->face
-				edge = edge->ppair_->pnext_;
-			} while (edge != verts[i]->pedge_);
-			coef.push_back(Triplet<double>(i, i, count));
+		emit(operatorInfo(QString("Minimal Surface: the mesh has no boundary or a part that does not reach it")));
+		return;
+	}
+	QString setup = ptr_laplace_->isFactorReused() ? QString("reused") : QString("%1 ms").arg(ptr_laplace_->factor_ms(), 0, 'f', 1);
+	if (ptr_laplace_->isIterative())
+	{
+		bool is_multigrid = ptr_laplace_->used_backend() == LaplaceSolver::MULTIGRID;
+		emit(operatorInfo(QString("Minimal Surface: %1 unknowns, %2 %3, %4 %5%6 in %7 ms")
+			.arg(ptr_laplace_->num_unknowns()).arg(is_multigrid ? QString("hierarchy") : QString("preconditioner"))
+			.arg(setup).arg(ptr_laplace_->iterations()).arg(is_multigrid ? QString("V-cycles") : QString("iterations"))
+			.arg(ptr_laplace_->isConverged() ? QString("") : QString(" (residual %1)").arg(ptr_laplace_->residual()))
+			.arg(ptr_laplace_->solve_ms(), 0, 'f', 1)));
+	}
+	else
+	{
+		// the residual after each refinement of the float solution
+		QString refinement;
+		const std::vector<double>& history = ptr_laplace_->refinement_history();
+		for (size_t k = 0; k != history.size(); k++)
+		{
+			refinement += QString(k == 0 ? " (refined %1" : ", %1").arg(history[k], 0, 'e', 1);
 		}
+		refinement += history.empty() ? QString("") : QString(ptr_laplace_->isPrecisionFallback() ? ", stalled, double)" : ")");
+		emit(operatorInfo(QString("Minimal Surface: %1 unknowns, factorization %2, solve %3 ms%4")
+			.arg(ptr_laplace_->num_unknowns()).arg(setup).arg(ptr_laplace_->solve_ms(), 0, 'f', 1).arg(refinement)));
 	}
-	A.setFromTriplets(coef.begin(), coef.end());
-	//A.makeCompressed();
-	VectorXd x, y, z;
+	ScheduleRender(RENDER_MESH);
+}
+
+void RenderingWidget::SolveMinimalSurface_Cotangent()
+{
+	StopSolver();
+	if (!ptr_flow_->Initialize(ptr_mesh_))
+		return;
+	emit(operatorInfo(QString("Minimal Surface (cotangent): area %1").arg(ptr_flow_->area(), 0, 'g', 8)));
+	flow_timer_id_ = startTimer(0);
+}
 
-	// 
-	SparseLU<SparseMatrix<double>> chol(A);  // ִA LUֽ
-	x = chol.solve(conX);         // ʹACholeskyֽȺұߵ
-	y = chol.solve(conY);
-	z = chol.solve(conZ);
+void RenderingWidget::StepMinimalSurfaceFlow()
+{
+	// the Pause button holds the flow as it holds the local solve
+	if (ptr_solver_->isPaused())
+		return;
+	ptr_flow_->Step();
+	ScheduleRender(RENDER_MESH);
+	const LaplaceSolver& solver = ptr_flow_->solver();
+	emit(operatorInfo(QString("Minimal Surface (cotangent): iteration %1, area %2, refactorization %3 ms, solve %4 ms%5")
+		.arg(ptr_flow_->iteration()).arg(ptr_flow_->area(), 0, 'g', 8)
+		.arg(solver.factor_ms(), 0, 'f', 1).arg(solver.solve_ms(), 0, 'f', 1)
+		.arg(ptr_flow_->isFinished() ? QString(" Done") : QString())));
+	if (ptr_flow_->isFinished())
+	{
+		killTimer(flow_timer_id_);
+		flow_timer_id_ = 0;
+	}
+}
 
+void RenderingWidget::SolveRegion(bool is_smoothing)
+{
+	UpdateSelection();
+	if (selection_.empty())
+	{
+		emit(operatorInfo(QString("Region: select vertices by dragging with Ctrl held")));
+		return;
+	}
+	// the local solve and the cotangent flow write the positions too, StopSolver kills the
+	// timer of the flow and joins the solver thread
+	StopSolver();
+	ptr_region_->set_operation(is_smoothing ? RegionSolver::SMOOTH : RegionSolver::MINIMAL_SURFACE);
+	if (!ptr_region_->Solve(ptr_mesh_, selection_))
+	{
+		emit(operatorInfo(QString("Region: no selected vertex can move, or a selected part reaches no fixed vertex")));
+		return;
+	}
+	QString setup = ptr_region_->isFactorReused() ? QString("reused") : QString("%1 ms").arg(ptr_region_->factor_ms(), 0, 'f', 1);
+	emit(operatorInfo(QString("Region %1: %2 unknowns, %3 fixed, factorization %4, solve %5 ms")
+		.arg(is_smoothing ? QString("smoothing") : QString("minimal surface"))
+		.arg(ptr_region_->num_unknowns()).arg(ptr_region_->num_fixed()).arg(setup)
+		.arg(ptr_region_->solve_ms(), 0, 'f', 1)));
+	ScheduleRender(RENDER_MESH);
+}
 
-	bool closed_surface = verts.size() == boundary_verts;
-	if (closed_surface) {
-		is_draw_minimal_surface_global_ = false;
+void RenderingWidget::SelectVertices(const QPoint& pos)
+{
+	if (ptr_mesh_ == NULL || ptr_mesh_->num_of_vertex_list() == 0)
 		return;
+	UpdateSelection();
+
+	// the transformation of paintGL, the vertices behind the surface are selected too
+	makeCurrent();
+	glMatrixMode(GL_MODELVIEW);
+	glLoadIdentity();
+	vec eyepos = eye_distance_*eye_direction_;
+	gluLookAt(eyepos[0], eyepos[1], eyepos[2],
+		eye_goal_[0], eye_goal_[1], eye_goal_[2],
+		0.0, 1.0, 0.0);
+	glMultMatrixf(ptr_arcball_->GetBallMatrix());
+	GLdouble modelview[16], projection[16];
+	GLint viewport[4];
+	glGetDoublev(GL_MODELVIEW_MATRIX, modelview);
+	glGetDoublev(GL_PROJECTION_MATRIX, projection);
+	glGetIntegerv(GL_VIEWPORT, viewport);
+
+	double x = pos.x(), y = viewport[3] - pos.y();
+	const std::vector<HE_vert*>& verts = *(ptr_mesh_->get_vertex_list());
+	for (size_t i = 0; i != verts.size(); i++)
+	{
+		if (verts[i]->selected() == SELECTED)
+			continue;
+		const Vec3f& p = verts[i]->position_;
+		GLdouble wx, wy, wz;
+		if (gluProject(p[0], p[1], p[2], modelview, projection, viewport, &wx, &wy, &wz) == GL_TRUE
+			&& wz >= 0.0 && wz <= 1.0 && (wx - x) * (wx - x) + (wy - y) * (wy - y) <= kSelectionRadius * kSelectionRadius)
+		{
+			verts[i]->set_seleted(SELECTED);
+			selection_.push_back(static_cast<int>(i));
+		}
+	}
+	emit(operatorInfo(QString("Selection: %1 vertices, Region to solve, S to smooth, C to clear").arg(selection_.size())));
+	ScheduleRender(RENDER_MESH);
+}
+
+void RenderingWidget::ClearSelection()
+{
+	UpdateSelection();
+	const std::vector<HE_vert*>& verts = *(ptr_mesh_->get_vertex_list());
+	for (size_t i = 0; i != selection_.size(); i++)
+	{
+		verts[selection_[i]]->set_seleted(UNSELECTED);
 	}
+	selection_.clear();
+	ScheduleRender(RENDER_MESH);
+}
 
-	for (size_t i = 0; i < m; ++i) {
-		vert.x() = x(i);
-		vert.y() = y(i);
-		vert.z() = z(i);
-		//std::cout << verts[i]->position() << "\n" << vert << "\n\n";
-		verts[i]->set_position(vert);
+void RenderingWidget::UpdateSelection()
+{
+	if (ptr_mesh_->topology_version() != selection_version_)
+	{
+		RegionSolver::CollectSelection(ptr_mesh_, selection_);
+		selection_version_ = ptr_mesh_->topology_version();
 	}
+}
 
-	is_draw_minimal_surface_global_ = false;
+void RenderingWidget::DrawSelection()
+{
+	UpdateSelection();
+	if (selection_.empty())
+		return;
+	const std::vector<HE_vert*>& verts = *(ptr_mesh_->get_vertex_list());
+	glPushAttrib(GL_ENABLE_BIT | GL_POINT_BIT | GL_CURRENT_BIT);
+	glDisable(GL_LIGHTING);
+	glPointSize(4.0);
+	glColor3f(1.0, 0.0, 0.0);
+	glBegin(GL_POINTS);
+	for (size_t i = 0; i != selection_.size(); i++)
+	{
+		glVertex3fv(verts[selection_[i]]->position().data());
+	}
+	glEnd();
+	glPopAttrib();
 }
 
 int RenderingWidget::findVertId(std::vector<Vec3f> verts, Vec3f point)
@@ -737,6 +1372,8 @@ void RenderingWidget::CreateSubdiv2D()
 		}
 	}
 
+	StopSolver();
+	StopProgressiveMesh();
 	ptr_mesh_->CreateMesh(verts, faces);
-	updateGL();
+	ScheduleRender(RENDER_MESH);
 }
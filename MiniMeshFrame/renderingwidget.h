@@ -13,6 +13,15 @@ using trimesh::point;
 class MainWindow;
 class CArcBall;
 class Mesh3D;
+class ProgressiveMeshStream;
+class MeshRenderer;
+class RenderScheduler;
+class MeshLOD;
+class MeshShader;
+class SolverThread;
+class LaplaceSolver;
+class MinimalSurfaceFlow;
+class RegionSolver;
 
 class RenderingWidget : public QGLWidget
 {
@@ -46,6 +55,20 @@ signals:
 private:
 	void Render();
 	void SetLight();
+	//! request a repaint for the RenderDirty reasons, served by the next frame the scheduler allows
+	void ScheduleRender(int reasons);
+
+	// level of detail while the view is dragged
+	//! build the proxies if the mesh changed, after a load and once the edits settle, never on a press
+	void UpdateLod();
+	//! the proxy level to draw this frame, -1 for the full mesh
+	int SelectLodLevel();
+	void DrawLodProxy(int level);
+	//! draw the faces, edges and texture of a mesh through the shader pipeline
+	/*!
+	*	\return false if there is no shader pipeline, nothing was drawn
+	*/
+	bool DrawShaded(MeshRenderer* renderer, Mesh3D* mesh);
 
 	public slots:
 	void SetBackground();
@@ -58,11 +81,23 @@ private:
 	void CheckDrawFace(bool bv);
 	void CheckLight(bool bv);
 	void CheckDrawTexture(bool bv);
+	void SetTexMapping(int mapping);
+	void CheckFlatShading(bool bv);
 	void CheckDrawAxes(bool bv);
 	void CheckDrawMinimalSurfaceLocal(bool bv);
 	void CheckDrawMinimalSurfaceGlobal(bool bv);
+	void CheckDrawMinimalSurfaceCotangent(bool bv);
+	void CheckDrawMinimalSurfaceRegion(bool bv);
 
 	void CreateSubdiv2D();
+	//! reorder the mesh for the vertex cache and overdraw, see MeshOptimizer
+	void OptimizeMesh();
+
+	void SetTriangleBudget(int n);
+
+	// background solver
+	void PauseSolver(bool paused);
+	void CancelSolver();
 
 private:
 	void DrawAxes(bool bv);
@@ -70,15 +105,54 @@ private:
 	void DrawEdge(bool);
 	void DrawFace(bool);
 	void DrawTexture(bool);
-	void DrawMinimalSurface_Local(bool bv);
-	void DrawMinimalSurface_Global(bool bv);
+	//! start the local minimal surface on the solver thread
+	void SolveMinimalSurface_Local();
+	//! show the newest snapshot of the solver thread
+	void ApplySolverSnapshot();
+	void StopSolver();
+	//! solve the global minimal surface at once, with the factors of the last solve if they fit
+	void SolveMinimalSurface_Global();
+	//! start the cotangent minimal surface, one step per timer event
+	void SolveMinimalSurface_Cotangent();
+	void StepMinimalSurfaceFlow();
+	//! solve the minimal surface of the selected patch, or take implicit smoothing steps of it
+	void SolveRegion(bool is_smoothing);
+
+	// vertex selection
+	//! select the vertices drawn within kSelectionRadius pixels of a point of the view
+	void SelectVertices(const QPoint& pos);
+	void ClearSelection();
+	//! collect the ids again from the tags if the connectivity of the mesh changed
+	void UpdateSelection();
+	void DrawSelection();
 	int findVertId(std::vector<Vec3f> verts, Vec3f point);
 
+	// progressive mesh streaming
+	void LoadProgressiveMesh(const char* fins);
+	void RefineProgressiveMesh();
+	void StopProgressiveMesh();
+
+	// out-of-core simplification of the files over kSimplifyFileSize, the others are loaded whole
+	void LoadSimplifiedMesh(const char* fins);
+
 
 public:
 	MainWindow					*ptr_mainwindow_;
 	CArcBall					*ptr_arcball_;
 	Mesh3D						*ptr_mesh_;
+	MeshRenderer				*ptr_renderer_;			//!< vertex buffers of ptr_mesh_, NULL without GL buffer support
+	MeshShader					*ptr_shader_;			//!< NULL without GLSL, the fixed-function path is used
+	RenderScheduler				*ptr_scheduler_;
+	int							render_timer_id_;		//!< pending repaint, 0 if none
+	bool						is_show_frame_time_;
+	bool						is_backface_culling_;	//!< closed meshes: skip back faces and their meshlets
+
+	// Level of detail
+	MeshLOD						*ptr_lod_;
+	std::vector<MeshRenderer*>	lod_renderers_;			//!< buffers of the proxies, one per level
+	int							lod_level_;				//!< proxy drawn by the last frame, -1 for the full mesh
+	bool						is_interacting_;		//!< a mouse drag is moving the view
+	int							lod_timer_id_;			//!< rebuilds the proxies once the mesh settles, 0 if none
 
 	// Texture
 	GLuint						texture_[1];
@@ -97,8 +171,24 @@ public:
 	bool						is_draw_texture_;
 	bool						has_lighting_;
 	bool						is_draw_axes_;
-	bool						is_draw_minimal_surface_local_;
-	bool						is_draw_minimal_surface_global_;
+
+	// Progressive mesh
+	ProgressiveMeshStream		*ptr_pm_stream_;
+	int							pm_face_budget_;		//!< refinement stops at this number of faces
+	int							pm_timer_id_;
+
+	// Background solver
+	SolverThread				*ptr_solver_;
+	int							solver_timer_id_;		//!< polls the snapshots, 0 if no solve runs
+	LaplaceSolver				*ptr_laplace_;			//!< global minimal surface, keeps its factors
+	MinimalSurfaceFlow			*ptr_flow_;				//!< cotangent minimal surface
+	int							flow_timer_id_;			//!< runs the steps, 0 if no flow runs
+	RegionSolver				*ptr_region_;			//!< solves on the selection only
+
+	// Selection
+	std::vector<int>			selection_;				//!< ids of the vertices tagged SELECTED
+	unsigned int				selection_version_;		//!< topology_version of the mesh for selection_
+	bool						is_selecting_;			//!< a Ctrl drag is selecting vertices
 
 private:
 